@@ -0,0 +1,107 @@
+#include "headers/RB_Main.h"
+#include "headers/RB_PixelMap.h"
+#include "headers/RB_Clock.h"
+#include "headers/RB_FixedConfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+
+/*
+Times whole headless generations of one config, so that a build specialized for its map dimensions (see
+RB_FixedConfig.h) can be compared against the runtime-configured build. `make fixedBench` builds and runs both.
+
+Usage: fixedConfigBenchmark [r] [g] [b] [width] [height] [runs]
+
+Each run uses the next seed (starting from 1), and prints one row with the build it was run by, the time it took, and
+a checksum of the finished image, which has to be the same for both builds.
+*/
+
+// The library prints its progress to stdout, so the results are written to a copy of the original stdout instead.
+FILE* results;
+
+// An FNV-1a hash of every pixel's color, one column after another.
+uint64_t getImageChecksum(RB_Data* data) {
+	RB_Color* column = (RB_Color*) malloc(sizeof(RB_Color) * data->config.height);
+	uint64_t hash = 0xcbf29ce484222325;
+
+	if(column == NULL) {
+		return 0;
+	}
+
+	for(RB_Size x = 0; x < data->config.width; x++) {
+		RB_readPixelMapColumn(data->pixelMap, x, 0, data->config.height, column);
+		for(RB_Size y = 0; y < data->config.height; y++) {
+			uint8_t channels[3] = { column[y].r, column[y].g, column[y].b };
+			for(int i = 0; i < 3; i++) {
+				hash = (hash ^ channels[i]) * 0x100000001b3;
+			}
+		}
+	}
+
+	free(column);
+	return hash;
+}
+
+int runFixedConfigBenchmark(RB_Config* config, unsigned int seed) {
+	RB_setRandomSeed(config, seed);
+	RB_Data* data = RB_init(config);
+
+	if(data == NULL) {
+		return 1;
+	}
+
+	bool isFixed = RB_isFixedMapDimensions(data->config.width, data->config.height);
+	RB_Size numPixels = data->config.width * data->config.height;
+
+	double startTime = RB_getMonotonicSeconds();
+	RB_setCoordColor(data, RB_getRandomCoord(data), RB_getRandomColor(data));
+	RB_generatePixels(data, numPixels);
+	double seconds = RB_getMonotonicSeconds() - startTime;
+
+	fprintf(
+		results,
+		"%-7s | seed %3u | %8.3f s | %10.0f pixels/s | checksum %016llx\n",
+		isFixed? "fixed" : "runtime",
+		seed,
+		seconds,
+		numPixels / seconds,
+		(unsigned long long) getImageChecksum(data)
+	);
+
+	RB_free(data);
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	int rRes = argc > 1? atoi(argv[1]) : 64;
+	int gRes = argc > 2? atoi(argv[2]) : 64;
+	int bRes = argc > 3? atoi(argv[3]) : 64;
+	int width = argc > 4? atoi(argv[4]) : 512;
+	int height = argc > 5? atoi(argv[5]) : 512;
+	int runs = argc > 6? atoi(argv[6]) : 3;
+
+	if(rRes < 1 || gRes < 1 || bRes < 1 || width < 1 || height < 1 || runs < 1) {
+		fprintf(stderr, "Usage: %s [r] [g] [b] [width] [height] [runs]\n", argv[0]);
+		return 1;
+	}
+
+	results = fdopen(dup(STDOUT_FILENO), "w");
+	if(results == NULL || freopen("/dev/null", "w", stdout) == NULL) {
+		fprintf(stderr, "Failed to redirect the library's output!\n");
+		return 1;
+	}
+
+	RB_Config* config = RB_newConfig();
+	RB_setColorResolution(config, rRes, gRes, bRes);
+	RB_setMapDimensions(config, width, height);
+
+	int status = 0;
+	for(int i = 0; i < runs && status == 0; i++) {
+		status = runFixedConfigBenchmark(config, (unsigned int) i + 1);
+	}
+
+	RB_freeConfig(config);
+	fclose(results);
+	return status;
+}
@@ -0,0 +1,340 @@
+#include "headers/RB_Main.h"
+#include "headers/RB_ColorPool.h"
+#include "headers/RB_Stats.h"
+#include "headers/RB_Clock.h"
+#include "headers/RB_Random.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/*
+Reference workloads for catching performance regressions. Every workload is deterministic, and prints one CSV row.
+
+Usage: generationBenchmark [largest channel resolution] [number of seeds]
+
+- "generate" rows are whole headless generations, for every channel resolution from 32 up to the largest one
+  (doubling each time), at aspect ratios of about 1:1, 4:1 and 16:1, with seeds 1, 2, 3 and so on.
+- "find" rows time RB_findIdealAvailableColor on its own, with random desired colors, in pools that have had
+  different fractions of their colors removed (in a random order).
+- "remove" rows time RB_removeColorFromPool on its own, removing the next colors from pools in the same states.
+
+Every workload runs in its own process, so that its peak memory usage can be measured separately.
+
+The library's stats (see RB_Stats.h) add a few clock reads to every generated pixel, so they would slow down the very
+thing being timed. Built without them, the benchmark fills in the timings and the peak memory usage, and leaves the
+breakdown columns empty. Built with them, it runs the same workloads again (apart from the removals, which have no
+breakdown), and only fills in the breakdown: where the time goes, and how much work the searches do.
+*/
+
+// The aspect ratios of the generations, as base-2 logarithms of width / height. Odd numbers of pixels can't be
+// split evenly, so their canvases are twice as wide as these.
+const int benchmarkAspectShifts[] = { 0, 2, 4 };
+#define RB_BENCHMARK_NUM_ASPECTS 3
+
+// The percentages of each pool's colors that are removed before it is measured.
+const int benchmarkOccupancies[] = { 0, 50, 90, 99 };
+#define RB_BENCHMARK_NUM_OCCUPANCIES 4
+
+// How many operations each pool micro-benchmark times.
+#define RB_BENCHMARK_POOL_OPERATIONS 100000
+
+// The library prints its progress to stdout, so the CSV is written to a copy of the original stdout instead.
+FILE* csv;
+
+typedef struct {
+	const char* benchmark;
+	RB_ColorChannelSize resolution;
+	RB_Size width;
+	RB_Size height;
+	unsigned int seed;
+	int occupancyPercent;
+	uint64_t operations;
+	double seconds;
+#ifdef RB_ENABLE_STATS
+	const RB_Stats* stats;
+	double averageNodesVisited;
+#endif
+} BenchmarkRow;
+
+void printBenchmarkHeader() {
+	fprintf(
+		csv,
+		"benchmark,resolution,width,height,seed,occupancy_percent,operations,seconds,operations_per_second,"
+		"choose_seconds,preferred_seconds,find_seconds,set_seconds,"
+		"avg_nodes_visited,avg_search_passes,avg_color_distance,peak_frontier,peak_rss_kib\n"
+	);
+	fflush(csv);
+}
+
+// Prints the row. Without stats, that includes the peak memory usage of this process, and with them, only the
+// breakdown. Fields that don't apply are left empty.
+void printBenchmarkRow(BenchmarkRow* row) {
+	fprintf(csv, "%s,%d,", row->benchmark, (int) row->resolution);
+	if(row->width > 0) {
+		fprintf(csv, "%ld,%ld,", (long) row->width, (long) row->height);
+	} else {
+		fprintf(csv, ",,");
+	}
+	fprintf(csv, "%u,", row->seed);
+	if(row->occupancyPercent >= 0) {
+		fprintf(csv, "%d,", row->occupancyPercent);
+	} else {
+		fprintf(csv, ",");
+	}
+	fprintf(csv, "%llu,", (unsigned long long) row->operations);
+
+#ifdef RB_ENABLE_STATS
+	// The instrumented timings aren't comparable with anything, so they are left out.
+	fprintf(csv, ",,");
+
+	if(row->stats != NULL) {
+		const RB_Stats* stats = row->stats;
+		double numPixels = (stats->numPixels > 0)? (double) stats->numPixels : 1;
+
+		RB_Size peakFrontier = 0;
+		for(size_t i = 0; i < stats->numFrontierSamples; i++) {
+			if(stats->frontierSamples[i] > peakFrontier) {
+				peakFrontier = stats->frontierSamples[i];
+			}
+		}
+
+		fprintf(
+			csv,
+			"%.6f,%.6f,%.6f,%.6f,%.2f,%.3f,%.3f,%ld,",
+			stats->phaseSeconds[RB_STATS_PHASE_CHOOSE_COORD],
+			stats->phaseSeconds[RB_STATS_PHASE_PREFERRED_COLOR],
+			stats->phaseSeconds[RB_STATS_PHASE_FIND_COLOR],
+			stats->phaseSeconds[RB_STATS_PHASE_SET_COLOR],
+			stats->totalNodesVisited / numPixels,
+			stats->totalSearchPasses / numPixels,
+			stats->totalColorDistance / numPixels,
+			(long) peakFrontier
+		);
+	} else {
+		fprintf(csv, ",,,,%.2f,,,,", row->averageNodesVisited);
+	}
+
+	fprintf(csv, "\n");
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	fprintf(
+		csv,
+		"%.6f,%.1f,,,,,,,,,%ld\n",
+		row->seconds,
+		(row->seconds > 0)? (row->operations / row->seconds) : 0,
+		usage.ru_maxrss
+	);
+#endif
+	fflush(csv);
+}
+
+int runGenerationBenchmark(RB_ColorChannelSize resolution, int aspectShift, unsigned int seed) {
+	RB_Size numPixels = resolution * resolution * resolution;
+
+	// Both dimensions are powers of two, since the number of pixels is.
+	int pixelsShift = 0;
+	while(((RB_Size) 1 << pixelsShift) < numPixels) {
+		pixelsShift++;
+	}
+	int widthShift = (pixelsShift + aspectShift + 1) / 2;
+	if(widthShift > pixelsShift) {
+		widthShift = pixelsShift;
+	}
+	RB_Size width = (RB_Size) 1 << widthShift;
+	RB_Size height = numPixels / width;
+
+	RB_Config* config = RB_newConfig();
+	RB_setColorResolution(config, resolution, resolution, resolution);
+	RB_setMapDimensions(config, width, height);
+	RB_setRandomSeed(config, seed);
+
+	RB_Data* rainbow = RB_init(config);
+	if(rainbow == NULL) {
+		fprintf(stderr, "Failed to initialize a %ld x %ld rainbow!\n", (long) width, (long) height);
+		return 1;
+	}
+
+	double startTime = RB_getMonotonicSeconds();
+	RB_setCoordColor(rainbow, RB_getRandomCoord(rainbow), RB_getRandomColor(rainbow));
+	RB_generatePixels(rainbow, numPixels);
+	double seconds = RB_getMonotonicSeconds() - startTime;
+
+	BenchmarkRow row = {
+		.benchmark = "generate",
+		.resolution = resolution,
+		.width = width,
+		.height = height,
+		.seed = seed,
+		.occupancyPercent = -1,
+		.operations = numPixels,
+		.seconds = seconds,
+#ifdef RB_ENABLE_STATS
+		.stats = RB_getStats(rainbow)
+#endif
+	};
+	printBenchmarkRow(&row);
+
+	RB_free(rainbow);
+	RB_freeConfig(config);
+	return 0;
+}
+
+// Fills the array with every color of the resolution, in a random order.
+void shuffleBenchmarkColors(RB_Color* colors, RB_ColorChannelSize resolution, RB_Random* random) {
+	RB_Size numColors = resolution * resolution * resolution;
+	RB_Size i = 0;
+
+	for(RB_ColorChannelSize r = 0; r < resolution; r++) {
+		for(RB_ColorChannelSize g = 0; g < resolution; g++) {
+			for(RB_ColorChannelSize b = 0; b < resolution; b++) {
+				colors[i] = (RB_Color) { .r = r, .g = g, .b = b };
+				i++;
+			}
+		}
+	}
+
+	for(i = numColors - 1; i > 0; i--) {
+		RB_Size j = (RB_Size) RB_getRandomBelow(random, i + 1);
+		RB_Color swap = colors[i];
+		colors[i] = colors[j];
+		colors[j] = swap;
+	}
+}
+
+int runPoolBenchmark(RB_ColorChannelSize resolution, int occupancyPercent, unsigned int seed) {
+	RB_Size numColors = resolution * resolution * resolution;
+	RB_ColorPool* pool = RB_createColorPool(resolution, resolution, resolution);
+	RB_Color* colors = (RB_Color*) malloc(sizeof(RB_Color) * numColors);
+
+	if(pool == NULL || colors == NULL) {
+		fprintf(stderr, "Failed to allocate a pool with a resolution of %d!\n", (int) resolution);
+		return 1;
+	}
+
+	RB_Random random;
+	RB_seedRandom(&random, seed);
+	shuffleBenchmarkColors(colors, resolution, &random);
+
+	RB_Size numRemoved = (RB_Size) (((double) numColors * occupancyPercent) / 100);
+	for(RB_Size i = 0; i < numRemoved; i++) {
+		RB_removeColorFromPool(pool, colors[i]);
+	}
+
+	// Searching never changes the pool, so every search sees the same occupancy.
+#ifdef RB_ENABLE_STATS
+	uint64_t totalNodesVisited = 0;
+#endif
+	double startTime = RB_getMonotonicSeconds();
+	for(int i = 0; i < RB_BENCHMARK_POOL_OPERATIONS; i++) {
+		RB_Color desired = {
+			.r = RB_getRandomBelow(&random, resolution),
+			.g = RB_getRandomBelow(&random, resolution),
+			.b = RB_getRandomBelow(&random, resolution)
+		};
+		RB_Color found;
+		RB_findIdealAvailableColor(pool, desired, &random, &found);
+
+#ifdef RB_ENABLE_STATS
+		uint64_t nodesVisited;
+		uint64_t passes;
+		RB_getLastColorPoolSearchCounts(pool, &nodesVisited, &passes);
+		totalNodesVisited += nodesVisited;
+#endif
+	}
+	double findSeconds = RB_getMonotonicSeconds() - startTime;
+
+	BenchmarkRow row = {
+		.benchmark = "find",
+		.resolution = resolution,
+		.seed = seed,
+		.occupancyPercent = occupancyPercent,
+		.operations = RB_BENCHMARK_POOL_OPERATIONS,
+		.seconds = findSeconds,
+#ifdef RB_ENABLE_STATS
+		.stats = NULL,
+		.averageNodesVisited = (double) totalNodesVisited / RB_BENCHMARK_POOL_OPERATIONS
+#endif
+	};
+	printBenchmarkRow(&row);
+
+#ifndef RB_ENABLE_STATS
+
+	// Removals do change the pool, so the occupancy drifts upwards by up to RB_BENCHMARK_POOL_OPERATIONS colors.
+	RB_Size numToRemove = numColors - numRemoved;
+	if(numToRemove > RB_BENCHMARK_POOL_OPERATIONS) {
+		numToRemove = RB_BENCHMARK_POOL_OPERATIONS;
+	}
+
+	startTime = RB_getMonotonicSeconds();
+	for(RB_Size i = numRemoved; i < numRemoved + numToRemove; i++) {
+		RB_removeColorFromPool(pool, colors[i]);
+	}
+	double removeSeconds = RB_getMonotonicSeconds() - startTime;
+
+	row.benchmark = "remove";
+	row.operations = numToRemove;
+	row.seconds = removeSeconds;
+	printBenchmarkRow(&row);
+#endif
+
+	free(colors);
+	RB_freeColorPool(pool);
+	return 0;
+}
+
+// Runs a workload in a child process. Returns true if it succeeded.
+bool runInChildProcess(int (*workload)(RB_ColorChannelSize, int, unsigned int), RB_ColorChannelSize resolution, int parameter, unsigned int seed) {
+	pid_t pid = fork();
+	if(pid == 0) {
+		exit(workload(resolution, parameter, seed));
+	}
+
+	int status = 1;
+	return pid >= 0 && waitpid(pid, &status, 0) >= 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char** argv) {
+	int maxResolution = argc > 1? atoi(argv[1]) : 256;
+	int numSeeds = argc > 2? atoi(argv[2]) : 3;
+
+	if(maxResolution < 32 || maxResolution > RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION || numSeeds < 1) {
+		fprintf(
+			stderr,
+			"Usage: %s [largest channel resolution (32-%d)] [number of seeds]\n",
+			argv[0], RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION
+		);
+		return 1;
+	}
+
+	csv = fdopen(dup(STDOUT_FILENO), "w");
+	if(csv == NULL || freopen("/dev/null", "w", stdout) == NULL) {
+		fprintf(stderr, "Failed to redirect the library's output!\n");
+		return 1;
+	}
+
+	printBenchmarkHeader();
+	int failures = 0;
+
+	for(int resolution = 32; resolution <= maxResolution; resolution *= 2) {
+		for(int aspect = 0; aspect < RB_BENCHMARK_NUM_ASPECTS; aspect++) {
+			for(int seed = 1; seed <= numSeeds; seed++) {
+				if(!runInChildProcess(runGenerationBenchmark, resolution, benchmarkAspectShifts[aspect], seed)) {
+					failures++;
+				}
+			}
+		}
+
+		for(int occupancy = 0; occupancy < RB_BENCHMARK_NUM_OCCUPANCIES; occupancy++) {
+			if(!runInChildProcess(runPoolBenchmark, resolution, benchmarkOccupancies[occupancy], 1)) {
+				failures++;
+			}
+		}
+	}
+
+	fclose(csv);
+	return failures == 0? 0 : 1;
+}
@@ -0,0 +1,126 @@
+#include "headers/RB_AssignmentQueue.h"
+#include "headers/RB_PixelMap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/*
+Compares the flat and tiled map layouts by growing a frontier across the canvas, exactly like the generator does,
+but without the color pool (which would otherwise dominate the run time and hide the layouts' memory behavior).
+
+Usage: mapLayoutBenchmark [width] [height] [percent of canvas to fill] [seed]
+
+Each layout runs in its own process so that their peak memory usage can be measured separately.
+*/
+
+double getSecondsSince(struct timespec start) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start.tv_sec) + ((now.tv_nsec - start.tv_nsec) / 1e9);
+}
+
+void setBenchmarkPixel(RB_PixelMap* map, RB_AssignmentQueue* queue, RB_Coord coord, RB_Color color) {
+	RB_Pixel* pixel = RB_getPixel(map, coord);
+
+	if(RB_coordIsInQueue(queue, coord)) {
+		RB_removeCoordFromAssignmentQueue(queue, coord);
+	}
+
+	pixel->color = color;
+	pixel->status = RB_PIXEL_SET;
+
+	RB_addResultantCoordsToQueue(map, queue, coord);
+}
+
+int runLayoutBenchmark(RB_MapLayout layout, RB_Size width, RB_Size height, RB_Size pixelsToSet, unsigned int seed) {
+	const char* layoutName = (layout == RB_MAP_LAYOUT_TILED)? "tiled" : "flat";
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	RB_PixelMap* map = RB_createPixelMap(width, height, layout);
+	RB_AssignmentQueue* queue = RB_createAssignmentQueue(width * height, width, height, layout);
+
+	if(map == NULL || queue == NULL) {
+		fprintf(stderr, "Failed to allocate the %s layout!\n", layoutName);
+		return 1;
+	}
+
+	double setupSeconds = getSecondsSince(start);
+
+	RB_Random random;
+	RB_seedRandom(&random, seed);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	setBenchmarkPixel(map, queue, (RB_Coord) { .x = width / 2, .y = height / 2 }, (RB_Color) { .r = 1, .g = 2, .b = 3 });
+	RB_Size pixelsSet = 1;
+
+	while(pixelsSet < pixelsToSet && !RB_isQueueEmpty(queue)) {
+		RB_Coord next = RB_chooseCoordFromAssignmentQueue(queue, &random);
+		RB_Color preferred = RB_determinePreferredCoordColor(map, next);
+		setBenchmarkPixel(map, queue, next, preferred);
+		pixelsSet++;
+	}
+
+	double generationSeconds = getSecondsSince(start);
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	printf(
+		"%-5s | setup %8.3f s | generation %8.3f s | %10.0f pixels/s | peak RSS %8ld KiB\n",
+		layoutName,
+		setupSeconds,
+		generationSeconds,
+		pixelsSet / generationSeconds,
+		usage.ru_maxrss
+	);
+	fflush(stdout);
+
+	// Each layout runs in its own process, so the messages printed while freeing can be silenced.
+	freopen("/dev/null", "w", stdout);
+	RB_freeAssignmentQueue(queue);
+	RB_freePixelMap(map);
+
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	RB_Size width = argc > 1? atoi(argv[1]) : 4096;
+	RB_Size height = argc > 2? atoi(argv[2]) : 4096;
+	int fillPercent = argc > 3? atoi(argv[3]) : 25;
+	unsigned int seed = argc > 4? (unsigned int) atoi(argv[4]) : 1;
+
+	if(width < 1 || height < 1 || fillPercent < 1 || fillPercent > 100) {
+		fprintf(stderr, "Usage: %s [width] [height] [percent of canvas to fill (1-100)] [seed]\n", argv[0]);
+		return 1;
+	}
+
+	RB_Size pixelsToSet = (RB_Size) (((double) width * height * fillPercent) / 100);
+
+	printf(
+		"Map layout benchmark: %ld x %ld canvas, filling %ld pixels (%d%%), seed %u.\n",
+		(long) width, (long) height, (long) pixelsToSet, fillPercent, seed
+	);
+	fflush(stdout);
+
+	RB_MapLayout layouts[] = { RB_MAP_LAYOUT_FLAT, RB_MAP_LAYOUT_TILED };
+	int failures = 0;
+
+	for(int i = 0; i < 2; i++) {
+		pid_t pid = fork();
+		if(pid == 0) {
+			exit(runLayoutBenchmark(layouts[i], width, height, pixelsToSet, seed));
+		}
+
+		int status = 1;
+		if(pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			failures++;
+		}
+	}
+
+	return failures == 0? 0 : 1;
+}
@@ -0,0 +1,173 @@
+#include "headers/RB_Arena.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+// The size of the huge pages used by MAP_HUGETLB. Regions are rounded up to a multiple of it, so that they can be
+// backed by huge pages on their own.
+#define RB_ARENA_HUGE_PAGE_SIZE ((size_t) 2 << 20)
+
+const char* const arenaSubsystemNames[RB_NUM_ARENA_SUBSYSTEMS] = {
+	"assignment queue",
+	"color pool",
+	"pixel map"
+};
+
+const char* const arenaPagesNames[] = {
+	"normal pages",
+	"transparent huge pages",
+	"explicit huge pages"
+};
+
+typedef struct {
+	uint8_t* start;
+	size_t budget;
+	atomic_size_t used;
+} ArenaRegion;
+
+struct RB_Arena_s {
+	void* mapping;
+	size_t mappingSize;
+	// The pages the arena actually got, which may differ from what was asked for.
+	RB_ArenaPages pages;
+
+	ArenaRegion regions[RB_NUM_ARENA_SUBSYSTEMS];
+};
+
+size_t roundUpToMultiple(size_t value, size_t multiple) {
+	return ((value + multiple - 1) / multiple) * multiple;
+}
+
+size_t RB_getArenaAllocationSize(size_t bytes) {
+	return roundUpToMultiple(bytes, RB_ARENA_ALIGNMENT);
+}
+
+RB_Arena* RB_createArena(const size_t budgets[RB_NUM_ARENA_SUBSYSTEMS], RB_ArenaPages pages) {
+	RB_Arena* ret = (RB_Arena*) malloc(sizeof(RB_Arena));
+
+	if(ret == NULL) {
+		fprintf(stderr, "Error creating arena: malloc failed!\n");
+		return NULL;
+	}
+
+	// Every region starts on a huge page boundary (relative to the mapping), whatever the pages are.
+	size_t regionSizes[RB_NUM_ARENA_SUBSYSTEMS];
+	ret->mappingSize = 0;
+	for(int i = 0; i < RB_NUM_ARENA_SUBSYSTEMS; i++) {
+		regionSizes[i] = roundUpToMultiple(budgets[i], RB_ARENA_HUGE_PAGE_SIZE);
+		ret->mappingSize += regionSizes[i];
+	}
+
+	// Nothing is reserved against the budgets up front, since most of them are worst cases that are never reached.
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+	ret->mapping = MAP_FAILED;
+	ret->pages = pages;
+
+	if(pages == RB_ARENA_PAGES_HUGETLB) {
+		// Explicit huge pages are reserved up front even so, since touching one that isn't there kills the process,
+		// whereas failing to reserve them here can be recovered from.
+		ret->mapping = mmap(
+			NULL, ret->mappingSize, PROT_READ | PROT_WRITE, (flags & ~MAP_NORESERVE) | MAP_HUGETLB, -1, 0
+		);
+		if(ret->mapping == MAP_FAILED) {
+			fprintf(stderr, "Not enough explicit huge pages for the arena, using transparent huge pages instead.\n");
+			ret->pages = RB_ARENA_PAGES_TRANSPARENT_HUGE;
+		}
+	}
+
+	if(ret->mapping == MAP_FAILED) {
+		ret->mapping = mmap(NULL, ret->mappingSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+	}
+
+	if(ret->mapping == MAP_FAILED) {
+		fprintf(stderr, "Error creating arena: cannot map %zu bytes!\n", ret->mappingSize);
+		free(ret);
+		return NULL;
+	}
+
+	if(ret->pages == RB_ARENA_PAGES_TRANSPARENT_HUGE) {
+#ifdef MADV_HUGEPAGE
+		// This is only advice, so if the kernel doesn't support it, the arena just keeps its normal pages.
+		if(madvise(ret->mapping, ret->mappingSize, MADV_HUGEPAGE) != 0) {
+			ret->pages = RB_ARENA_PAGES_NORMAL;
+		}
+#else
+		ret->pages = RB_ARENA_PAGES_NORMAL;
+#endif
+	}
+
+	uint8_t* regionStart = (uint8_t*) ret->mapping;
+	for(int i = 0; i < RB_NUM_ARENA_SUBSYSTEMS; i++) {
+		ret->regions[i].start = regionStart;
+		ret->regions[i].budget = budgets[i];
+		atomic_init(&(ret->regions[i].used), 0);
+		regionStart += regionSizes[i];
+	}
+
+	return ret;
+}
+
+void RB_freeArena(RB_Arena* arena) {
+	if(arena == NULL) {
+		return;
+	}
+
+	printf("Freeing RB_Arena!\n");
+	munmap(arena->mapping, arena->mappingSize);
+	free(arena);
+}
+
+void* RB_allocateFromArena(RB_Arena* arena, RB_ArenaSubsystem subsystem, size_t bytes) {
+	ArenaRegion* region = &(arena->regions[subsystem]);
+	size_t size = RB_getArenaAllocationSize(bytes);
+	size_t offset = atomic_load(&(region->used));
+
+	// If another thread allocates first, offset is updated to match, and this tries again after its allocation.
+	do {
+		if(offset + size > region->budget) {
+			fprintf(
+				stderr,
+				"Error allocating %zu bytes from the arena: the %s's budget of %zu bytes is used up!\n",
+				bytes, arenaSubsystemNames[subsystem], region->budget
+			);
+			return NULL;
+		}
+	} while(!atomic_compare_exchange_weak(&(region->used), &offset, offset + size));
+
+	return region->start + offset;
+}
+
+void* RB_allocateZeroed(RB_Arena* arena, RB_ArenaSubsystem subsystem, size_t bytes) {
+	if(arena == NULL) {
+		return calloc(1, bytes);
+	}
+	return RB_allocateFromArena(arena, subsystem, bytes);
+}
+
+void RB_freeZeroed(RB_Arena* arena, void* allocation) {
+	if(arena == NULL) {
+		free(allocation);
+	}
+}
+
+size_t RB_getArenaBytesUsed(RB_Arena* arena, RB_ArenaSubsystem subsystem) {
+	return atomic_load(&(arena->regions[subsystem].used));
+}
+
+size_t RB_getArenaBudget(RB_Arena* arena, RB_ArenaSubsystem subsystem) {
+	return arena->regions[subsystem].budget;
+}
+
+void RB_printArenaUsage(FILE* stream, RB_Arena* arena) {
+	fprintf(stream, "Arena usage (%s, %zu bytes reserved).\n", arenaPagesNames[arena->pages], arena->mappingSize);
+	for(int i = 0; i < RB_NUM_ARENA_SUBSYSTEMS; i++) {
+		fprintf(
+			stream,
+			"| %s: %zu of %zu bytes.\n",
+			arenaSubsystemNames[i],
+			RB_getArenaBytesUsed(arena, i),
+			RB_getArenaBudget(arena, i)
+		);
+	}
+}
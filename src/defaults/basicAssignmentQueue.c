@@ -2,54 +2,151 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-#define RB_QUEUE_INDEX_UNQUEUED -1
+// The membership table stores each queued coord's index plus one, so that zeroed memory means nothing is queued.
+#define RB_QUEUE_INDEX_UNQUEUED 0
 
 struct RB_AssignmentQueue_s {
 	RB_Coord* coords;
 	RB_Size coordLen;
 	RB_Size maxCoordLen;
 
-	RB_Size** coordIndexes;
+	// For flat layouts, a pointer to the start of each column of indexes.
+	// For tiled layouts, a pointer to each tile of indexes, or NULL if nothing in that tile has been queued yet.
+	RB_StoredSize** coordIndexes;
 	RB_Size xRange;
 	RB_Size yRange;
+
+	RB_MapLayout layout;
+	RB_Size tilesPerColumn;
+
+	// Where the queue and its tiles are allocated from, or NULL if they are allocated with calloc.
+	RB_Arena* arena;
 };
 
-// Allocates an assignmentQueue capable of storing the specified number of pixels.
-RB_AssignmentQueue* RB_createAssignmentQueue(RB_Size size, RB_Size xRange, RB_Size yRange) {
-	RB_AssignmentQueue* ret = malloc(
-		sizeof(RB_AssignmentQueue)
+// The size of the allocation that holds the queue itself, along with a flat layout's whole membership table.
+size_t getAssignmentQueueAllocationSize(RB_Size size, RB_Size xRange, RB_Size yRange, RB_MapLayout layout) {
+	RB_Size numPointers = (layout == RB_MAP_LAYOUT_TILED)? RB_getNumTiles(xRange) * RB_getNumTiles(yRange) : xRange;
+	// Tiled layouts allocate their indexes lazily, one tile at a time.
+	RB_Size numIndexes = (layout == RB_MAP_LAYOUT_TILED)? 0 : xRange * yRange;
+
+	return sizeof(RB_AssignmentQueue)
 		+ (sizeof(RB_Coord) * size)
-		+ (sizeof(RB_Size*) * xRange)
-		+ (sizeof(RB_Size) * xRange * yRange)
+		+ (sizeof(RB_StoredSize*) * numPointers)
+		+ (sizeof(RB_StoredSize) * numIndexes);
+}
+
+size_t RB_getAssignmentQueueArenaBudget(RB_Size size, RB_Size xRange, RB_Size yRange, RB_MapLayout layout) {
+	size_t ret = RB_getArenaAllocationSize(getAssignmentQueueAllocationSize(size, xRange, yRange, layout));
+
+	if(layout == RB_MAP_LAYOUT_TILED) {
+		size_t numTiles = (size_t) RB_getNumTiles(xRange) * RB_getNumTiles(yRange);
+		ret += numTiles * RB_getArenaAllocationSize(sizeof(RB_StoredSize) * RB_MAP_TILE_AREA);
+	}
+
+	return ret;
+}
+
+// Allocates an assignmentQueue capable of storing the specified number of pixels.
+RB_AssignmentQueue* RB_createAssignmentQueue(RB_Size size, RB_Size xRange, RB_Size yRange, RB_MapLayout layout) {
+	return RB_createAssignmentQueueInArena(NULL, size, xRange, yRange, layout);
+}
+
+RB_AssignmentQueue* RB_createAssignmentQueueInArena(
+	RB_Arena* arena,
+	RB_Size size,
+	RB_Size xRange,
+	RB_Size yRange,
+	RB_MapLayout layout
+) {
+	// The memory is zeroed, so every coord starts out unqueued, and tiled layouts start out without any tiles.
+	RB_AssignmentQueue* ret = (RB_AssignmentQueue*) RB_allocateZeroed(
+		arena,
+		RB_ARENA_ASSIGNMENT_QUEUE,
+		getAssignmentQueueAllocationSize(size, xRange, yRange, layout)
 	);
 
 	if(ret == NULL) {
 		return NULL;
 	}
 
+	ret->arena = arena;
 	ret->coords = (RB_Coord*) (ret + 1);
 	ret->maxCoordLen = size;
 	ret->coordLen = 0;
 
-	ret->coordIndexes = (RB_Size**) (ret->coords + size);
+	ret->coordIndexes = (RB_StoredSize**) (ret->coords + size);
 	ret->xRange = xRange;
 	ret->yRange = yRange;
-	RB_Size* xyIndexesStart = (RB_Size*) (ret->coordIndexes + xRange);
+	ret->layout = layout;
+	ret->tilesPerColumn = RB_getNumTiles(yRange);
+
+	if(layout == RB_MAP_LAYOUT_TILED) {
+		return ret;
+	}
+
+	RB_StoredSize* xyIndexesStart = (RB_StoredSize*) (ret->coordIndexes + xRange);
 
 	for(RB_Size x = 0; x < xRange; x++) {
 		ret->coordIndexes[x] = xyIndexesStart + (x * yRange);
-		for(RB_Size y = 0; y < yRange; y++) {
-			ret->coordIndexes[x][y] = RB_QUEUE_INDEX_UNQUEUED;
-		}
 	} 
 
 	return ret;
 }
 
+// Returns where the queue index of an in-bounds coord is stored. For tiled layouts, if the coord's tile hasn't been
+// allocated yet, either allocates it or (if allocate is false) returns NULL, since nothing in it can be queued.
+RB_StoredSize* getCoordIndexSlot(RB_AssignmentQueue* queue, RB_Coord coord, bool allocate) {
+	if(queue->layout == RB_MAP_LAYOUT_FLAT) {
+		return &(queue->coordIndexes[coord.x][coord.y]);
+	}
+
+	RB_Size tileIndex = ((coord.x >> RB_MAP_TILE_SHIFT) * queue->tilesPerColumn) + (coord.y >> RB_MAP_TILE_SHIFT);
+	RB_StoredSize* tile = queue->coordIndexes[tileIndex];
+
+	if(tile == NULL) {
+		if(!allocate) {
+			return NULL;
+		}
+
+		tile = (RB_StoredSize*) RB_allocateZeroed(
+			queue->arena,
+			RB_ARENA_ASSIGNMENT_QUEUE,
+			sizeof(RB_StoredSize) * RB_MAP_TILE_AREA
+		);
+		if(tile == NULL) {
+			fprintf(stderr, "Error allocating assignment queue tile for Coord(%d, %d)!\n", coord.x, coord.y);
+			return NULL;
+		}
+
+		queue->coordIndexes[tileIndex] = tile;
+	}
+
+	return tile + RB_getTileOffset(coord.x, coord.y);
+}
+
 // Frees a previously allocated assignmentQueue
 void RB_freeAssignmentQueue(RB_AssignmentQueue* queue) {
+	if(queue == NULL) {
+		return;
+	}
+
 	printf("Freeing RB_AssignmentQueue!\n");
-	free(queue);
+	if(queue->layout == RB_MAP_LAYOUT_TILED) {
+		RB_Size numTiles = RB_getNumTiles(queue->xRange) * queue->tilesPerColumn;
+		for(RB_Size i = 0; i < numTiles; i++) {
+			RB_freeZeroed(queue->arena, queue->coordIndexes[i]);
+		}
+	}
+	RB_freeZeroed(queue->arena, queue);
+}
+
+void RB_clearAssignmentQueue(RB_AssignmentQueue* queue) {
+	// Only queued coords have an index, so only their entries in the membership table need to be reset.
+	for(RB_Size i = 0; i < queue->coordLen; i++) {
+		*getCoordIndexSlot(queue, queue->coords[i], false) = RB_QUEUE_INDEX_UNQUEUED;
+	}
+
+	queue->coordLen = 0;
 }
 
 // Returns true if the queue is empty. Otherwise, returns false.
@@ -69,45 +166,52 @@ RB_Size RB_getQueueCapacity(RB_AssignmentQueue* queue) {
 	return queue->maxCoordLen;
 }
 
+RB_Coord RB_getQueuedCoord(RB_AssignmentQueue* queue, RB_Size index) {
+	return queue->coords[index];
+}
+
 // Chooses (using an implementation-specific method) a coord from the queue and returns it.
-RB_Coord RB_chooseCoordFromAssignmentQueue(RB_AssignmentQueue* queue) {
+RB_Coord RB_chooseCoordFromAssignmentQueue(RB_AssignmentQueue* queue, RB_Random* random) {
 	if(RB_isQueueEmpty(queue)) {
 		fprintf(stderr, "AssignmentQueue is empty!!\n");
 		return (RB_Coord) { .x = -1, .y = -1 };
 	}
 
-	RB_Size retIndex = ((RB_Size) rand()) % queue->coordLen;
+	RB_Size retIndex = (RB_Size) RB_getRandomBelow(random, queue->coordLen);
 	return queue->coords[retIndex];
 }
 
 bool RB_coordIsWithinQueueBounds(RB_AssignmentQueue* queue, RB_Coord coord) {
+	// Negative components wrap around to huge unsigned values, so one comparison per component covers both bounds.
 	return (
-		coord.x >= 0
-		&& coord.x < queue->xRange
-		&& coord.y >= 0
-		&& coord.y < queue->yRange
+		((RB_USize) coord.x < (RB_USize) queue->xRange)
+		& ((RB_USize) coord.y < (RB_USize) queue->yRange)
 	);
 }
 
 bool RB_coordIsInQueue(RB_AssignmentQueue* queue, RB_Coord coord) {
-	return (
-		RB_coordIsWithinQueueBounds(queue, coord)
-		&& queue->coordIndexes[coord.x][coord.y] != -1
-	);
+	if(!RB_coordIsWithinQueueBounds(queue, coord)) {
+		return false;
+	}
+
+	RB_StoredSize* indexSlot = getCoordIndexSlot(queue, coord, false);
+	return indexSlot != NULL && *indexSlot != RB_QUEUE_INDEX_UNQUEUED;
 }
 
 // If the coord is in the Queue, removes it.
 void RB_removeCoordFromAssignmentQueue(RB_AssignmentQueue* queue, RB_Coord coord) {
 	if(RB_coordIsInQueue(queue, coord)) { // If the coord is in the queue, the queue is guaranteed not to be empty
-		RB_Size coordIndex = queue->coordIndexes[coord.x][coord.y];
+		// Both coords are queued, so their slots are guaranteed to already be allocated.
+		RB_StoredSize* coordIndexSlot = getCoordIndexSlot(queue, coord, false);
+		RB_Size coordIndex = *coordIndexSlot - 1;
 
 		RB_Size lastIndex = queue->coordLen - 1;
 		RB_Coord lastCoord = queue->coords[lastIndex];
 
 		queue->coords[coordIndex] = lastCoord;
-		queue->coordIndexes[lastCoord.x][lastCoord.y] = coordIndex;
+		*getCoordIndexSlot(queue, lastCoord, false) = coordIndex + 1;
 
-		queue->coordIndexes[coord.x][coord.y] = RB_QUEUE_INDEX_UNQUEUED;
+		*coordIndexSlot = RB_QUEUE_INDEX_UNQUEUED;
 
 		queue->coordLen--;
 	} else {
@@ -132,10 +236,13 @@ void RB_addCoordToAssignmentQueue(RB_AssignmentQueue* queue, RB_Coord toAdd, RB_
 	}
 
 	if(RB_coordIsWithinQueueBounds(queue, toAdd)) {
-		if(RB_coordIsInQueue(queue, toAdd)) return;
+		// The bounds have already been checked, so the membership table can be read directly.
+		RB_StoredSize* indexSlot = getCoordIndexSlot(queue, toAdd, true);
+		if(indexSlot == NULL) return;
+		if(*indexSlot != RB_QUEUE_INDEX_UNQUEUED) return;
 		queue->coords[queue->coordLen] = toAdd;
-		queue->coordIndexes[toAdd.x][toAdd.y] = queue->coordLen;
 		queue->coordLen++;
+		*indexSlot = queue->coordLen;
 	} else {
 		fprintf(stderr, "Error adding coord to queue: Coord(%d, %d) is out of Bounds(%d, %d)!\n",
 			toAdd.x, toAdd.y, queue->xRange, queue->yRange
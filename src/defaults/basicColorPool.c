@@ -1,7 +1,12 @@
 #include "headers/RB_ColorPool.h"
+#include "headers/RB_Trace.h"
 #include <stdlib.h>
+#include <string.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
 
 typedef enum {
 	POOL_NODE_COLOR,
@@ -38,7 +43,8 @@ typedef struct {
 
 struct ColorPoolColorNode_s {
 	RB_Color color;
-	bool isAvailable;
+	// How many more times the color can be taken. The color is in the tree for as long as this is above zero.
+	RB_StoredSize count;
 
 	ChildNodeParentData parentData;
 };
@@ -57,27 +63,67 @@ struct ColorPoolOctant_s {
 };
 
 typedef struct {
-	// TODO: These first two fields probably don't need to use RB_Size
-	RB_Size index;
-	RB_Size divisor;
+	// There are never more layers than bits in a channel (plus one), so the divisor fits in a channel size too.
+	RB_StoredChannelSize index;
+	RB_StoredChannelSize divisor;
 	// Note that the following sizes are in the coordinates of the layer, not global coordinates.
-	RB_ColorChannelSize rSize;
-	RB_ColorChannelSize gSize;
-	RB_ColorChannelSize bSize;
+	RB_StoredChannelSize rSize;
+	RB_StoredChannelSize gSize;
+	RB_StoredChannelSize bSize;
 	void* dataStart;
 } OctantLayerMetaData;
 
+// The number of nodes that a search's node queue starts out with room for. It grows whenever it needs to.
+#define RB_COLOR_POOL_SEARCH_INITIAL_CAPACITY 1024
+
+struct RB_ColorPoolSearch_s {
+	ColorPoolNode* nodeQueue;
+	RB_Size capacity;
+
+#if defined(RB_ENABLE_STATS) || defined(RB_ENABLE_TRACE)
+	// How many nodes the last search looked at, and how many passes over the node queue it took. These are also
+	// counted for the searches that are traced.
+	uint64_t nodesVisited;
+	uint64_t passes;
+#endif
+};
+
 struct RB_ColorPool_s {
 	ColorPoolNode root;
 
 	ColorPoolColorNode* colorNodes;
 	ColorPoolOctant* octants;
 
-	ColorPoolNode* nodeQueue;
+	// The search used by RB_findIdealAvailableColor.
+	RB_ColorPoolSearch* search;
 
 	RB_ColorChannelSize rSize;
 	RB_ColorChannelSize gSize;
 	RB_ColorChannelSize bSize;
+
+	// True if the pool was built from a palette (see RB_createPaletteColorPool). A palette pool's colors are sorted by
+	// their Morton codes instead of being laid out like a lattice, and its resolutions are all
+	// RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION.
+	bool isPalette;
+
+	// How many times the pool's colors can be taken altogether, when every one of them is available, and the most times
+	// any one color can be. A lattice pool shares its total out among its colors (see getInitialColorCount), while a
+	// palette pool keeps a running total of its colors' counts, so that color i starts out with
+	// (countEnds[i] - countEnds[i - 1]) of them. Only palette pools have countEnds.
+	size_t totalCount;
+	RB_Size maximumCount;
+	RB_StoredSize* countEnds;
+	// How many bits each color's count takes up in an availability array (see getAvailabilityCountBits).
+	int availabilityCountBits;
+
+	size_t numColors;
+	size_t maxOctants;
+	// How many of the octants are actually used by the tree. The rest are never initialized.
+	size_t numOctants;
+
+	// Where the pool, its colors and its octants are allocated from, or NULL if they are allocated with calloc.
+	// The search is always allocated on its own, since it can grow.
+	RB_Arena* arena;
 };
 
 void printEntireTree(FILE* stream, ColorPoolNode node);
@@ -266,51 +312,224 @@ ColorPoolNode getDataFromLayer(
 	}
 }
 
-RB_ColorPool* RB_createColorPool(RB_ColorChannelSize rSize, RB_ColorChannelSize gSize, RB_ColorChannelSize bSize) {
-	RB_ColorPool* ret = (RB_ColorPool*) malloc(sizeof(RB_ColorPool));
+// Every octant of a palette pool's tree has at least two children, so there is always at least one fewer octant than
+// there are distinct colors.
+size_t calculatePaletteMaximumOctants(size_t numColors) {
+	return numColors > 1? numColors - 1 : 1;
+}
+
+size_t getColorPoolArenaBudget(size_t numColors, size_t maxOctants) {
+	return RB_getArenaAllocationSize(sizeof(RB_ColorPool))
+		+ RB_getArenaAllocationSize(sizeof(ColorPoolColorNode) * numColors)
+		+ RB_getArenaAllocationSize(sizeof(ColorPoolOctant) * maxOctants);
+}
+
+size_t RB_getColorPoolArenaBudget(RB_ColorChannelSize rSize, RB_ColorChannelSize gSize, RB_ColorChannelSize bSize) {
+	return getColorPoolArenaBudget((size_t) rSize * gSize * bSize, calculateMaximumOctants(rSize, gSize, bSize));
+}
+
+size_t RB_getPaletteColorPoolArenaBudget(RB_Size length) {
+	// How many distinct colors the palette has isn't known until it's sorted, but it can't have more than either its
+	// length or every possible color.
+	size_t numColors = (length < RB_MAXIMUM_POSSIBLE_NUMBER_OF_COLORS)?
+		(size_t) length
+		: RB_MAXIMUM_POSSIBLE_NUMBER_OF_COLORS;
+
+	return getColorPoolArenaBudget(numColors, calculatePaletteMaximumOctants(numColors))
+		+ RB_getArenaAllocationSize(sizeof(RB_StoredSize) * numColors);
+}
+
+// Allocates a pool with room for the specified numbers of colors and octants, without building its tree. The caller
+// fills in the pool's resolutions.
+RB_ColorPool* allocateColorPool(RB_Arena* arena, size_t numColors, size_t maxOctants) {
+	RB_ColorPool* ret = (RB_ColorPool*) RB_allocateZeroed(arena, RB_ARENA_COLOR_POOL, sizeof(RB_ColorPool));
 	
 	if(ret == NULL) {
 		return NULL;
 	}
 
-	ret->rSize = rSize;
-	ret->gSize = gSize;
-	ret->bSize = bSize;
+	ret->arena = arena;
+	ret->isPalette = false;
+	ret->totalCount = numColors;
+	ret->maximumCount = 1;
+	ret->countEnds = NULL;
+	ret->availabilityCountBits = 1;
+	ret->numColors = numColors;
+	ret->maxOctants = maxOctants;
+	ret->numOctants = 0;
+	ret->root = emptyColorPoolNode;
 	ret->colorNodes = NULL;
 	ret->octants = NULL;
-	ret->nodeQueue = NULL;
+	ret->search = NULL;
 
 
-	// ALLOCATE THE NODE QUEUE
-	// TODO: I know for sure that the nodeQueue will never need to be larger than numPixels,
-	// but I'm pretty sure it's possible to figure out an even smaller upper bound.
-	ret->nodeQueue = (ColorPoolNode*) malloc(sizeof(ColorPoolNode) * rSize * gSize * bSize);
-	if(ret->nodeQueue == NULL) {
+	// ALLOCATE THE SEARCH
+	ret->search = RB_createColorPoolSearch();
+	if(ret->search == NULL) {
 		RB_freeColorPool(ret);
 		return NULL;
 	}
 
-	// DEAL WITH COLORS
-	ret->colorNodes = (ColorPoolColorNode*) malloc(sizeof(ColorPoolColorNode) * rSize * gSize * bSize);
+	// ALLOCATE COLORS AND OCTANTS
+	ret->colorNodes = (ColorPoolColorNode*) RB_allocateZeroed(
+		arena,
+		RB_ARENA_COLOR_POOL,
+		sizeof(ColorPoolColorNode) * ret->numColors
+	);
+	ret->octants = (ColorPoolOctant*) RB_allocateZeroed(
+		arena,
+		RB_ARENA_COLOR_POOL,
+		sizeof(ColorPoolOctant) * ret->maxOctants
+	);
 
-	if(ret->colorNodes == NULL) {
+	if(ret->colorNodes == NULL || ret->octants == NULL) {
 		RB_freeColorPool(ret);
 		return NULL;
 	}
 
+	return ret;
+}
+
+/*
+Sets how many times the pool's colors can be taken altogether, and the most times any one of them can be.
+
+Each color's count takes up the same number of bits of an availability array: a single bit when no color can be taken
+more than once (so that the array is a plain bitmap of the available colors), or else the fewest whole bytes that
+hold the largest count.
+*/
+void setColorPoolCounts(RB_ColorPool* pool, size_t totalCount, RB_Size maximumCount) {
+	pool->totalCount = totalCount;
+	pool->maximumCount = maximumCount;
+
+	if(maximumCount <= 1) {
+		pool->availabilityCountBits = 1;
+	} else if(maximumCount <= UINT8_MAX) {
+		pool->availabilityCountBits = 8;
+	} else if(maximumCount <= UINT16_MAX) {
+		pool->availabilityCountBits = 16;
+	} else {
+		pool->availabilityCountBits = 32;
+	}
+}
+
+// Returns the position in the lattice pool's total count that the color at the specified index starts at.
+size_t getLatticeCountStart(const RB_ColorPool* pool, size_t colorIndex) {
+	return (size_t) (((uint64_t) colorIndex * pool->totalCount) / pool->numColors);
+}
+
+/*
+Returns how many times the color at the specified index can be taken when every color is available.
+
+A lattice pool shares its total count out among its colors as evenly as possible: every color gets either the total
+divided by the number of colors, rounded down, or one more than that. The colors that get one more are spread evenly
+through the lattice, rather than all being at one end of it, so they don't favor any part of the color cube.
+*/
+RB_Size getInitialColorCount(const RB_ColorPool* pool, size_t colorIndex) {
+	if(pool->countEnds != NULL) {
+		return pool->countEnds[colorIndex] - ((colorIndex > 0)? pool->countEnds[colorIndex - 1] : 0);
+	}
+
+	if(pool->totalCount == pool->numColors) {
+		return 1;
+	}
+
+	return (RB_Size) (getLatticeCountStart(pool, colorIndex + 1) - getLatticeCountStart(pool, colorIndex));
+}
+
+// Returns the count of the color at the specified position of the availability array.
+RB_Size loadAvailabilityCount(const RB_ColorPool* pool, const uint8_t* availability, size_t colorIndex) {
+	if(pool->availabilityCountBits == 1) {
+		return (availability[colorIndex >> 3] >> (colorIndex & 7)) & 1;
+	}
+
+	size_t numBytes = (size_t) pool->availabilityCountBits / 8;
+	const uint8_t* bytes = availability + (colorIndex * numBytes);
+	uint32_t count = 0;
+
+	for(size_t i = 0; i < numBytes; i++) {
+		count |= ((uint32_t) bytes[i]) << (8 * i);
+	}
+
+	return (RB_Size) count;
+}
+
+// Writes the count of the color at the specified position of the availability array, which must start out zeroed.
+void storeAvailabilityCount(const RB_ColorPool* pool, uint8_t* availability, size_t colorIndex, RB_Size count) {
+	if(pool->availabilityCountBits == 1) {
+		availability[colorIndex >> 3] |= (uint8_t) ((count > 0) << (colorIndex & 7));
+		return;
+	}
+
+	size_t numBytes = (size_t) pool->availabilityCountBits / 8;
+	uint8_t* bytes = availability + (colorIndex * numBytes);
+
+	for(size_t i = 0; i < numBytes; i++) {
+		bytes[i] = (uint8_t) (((uint32_t) count) >> (8 * i));
+	}
+}
+
+// Returns how many times the color at the specified index can be taken, according to the availability array, or
+// every time it could be when the pool is full if availability is NULL.
+RB_Size getBuildColorCount(const RB_ColorPool* pool, const uint8_t* availability, size_t colorIndex) {
+	return (availability == NULL)?
+		getInitialColorCount(pool, colorIndex)
+		: loadAvailabilityCount(pool, availability, colorIndex);
+}
+
+// Returns true if the node has any colors in it. Only colors that are used up and octants without children can be
+// empty while the tree is being built.
+bool newNodeHasColors(ColorPoolNode node) {
+	switch(node.type) {
+		case POOL_NODE_COLOR:
+			return node.colorNodePtr->count > 0;
+		case POOL_NODE_OCTANT:
+			return node.octantNodePtr->numChildren > 0;
+		case POOL_NODE_EMPTY:
+			return false;
+	}
+	return false;
+}
+
+// Layers with fewer nodes than this are built by a single thread, since starting threads would cost more than it saves.
+#define RB_COLOR_POOL_PARALLEL_BUILD_THRESHOLD 0x8000
+
+// The most threads a layer of the tree is built by.
+#define RB_COLOR_POOL_MAX_BUILD_THREADS 64
+
+// How many threads the calling thread builds layers with (see RB_setColorPoolBuildThreads), or 0 for every processor.
+_Thread_local int colorPoolBuildThreads = 0;
 
-	RB_Size colorIndex = 0;
-	for(RB_ColorChannelSize r = 0; r < rSize; r++) {
-		for(RB_ColorChannelSize g = 0; g < gSize; g++) {
-			for(RB_ColorChannelSize b = 0; b < bSize; b++) {
+// A slab of one layer of the tree (every node whose red component, in the layer's coordinates, is in [rStart, rEnd)),
+// which is built by a single thread.
+typedef struct {
+	// The layer being built, and the layer below it (which is ignored when building the color layer).
+	OctantLayerMetaData layer;
+	OctantLayerMetaData lastLayer;
+	const RB_ColorPool* pool;
+	const uint8_t* availability;
+	// True if no color is missing from the tree. Only pools whose total count is less than their number of colors
+	// have colors that are used up from the start.
+	bool everyColorIsAvailable;
+	RB_ColorChannelSize rStart;
+	RB_ColorChannelSize rEnd;
+} ColorPoolBuildSlab;
+
+void buildColorNodeSlab(const ColorPoolBuildSlab* slab) {
+	OctantLayerMetaData layer = slab->layer;
+	ColorPoolColorNode* colorNodes = (ColorPoolColorNode*) layer.dataStart;
+
+	for(RB_ColorChannelSize r = slab->rStart; r < slab->rEnd; r++) {
+		RB_Size colorIndex = getDataPosition(r, 0, 0, layer.gSize, layer.bSize);
+		for(RB_ColorChannelSize g = 0; g < layer.gSize; g++) {
+			for(RB_ColorChannelSize b = 0; b < layer.bSize; b++) {
 				RB_Color col = {
 					.r = (RB_ColorChannel) r,
 					.g = (RB_ColorChannel) g,
 					.b = (RB_ColorChannel) b
 				};
-				ret->colorNodes[colorIndex] = (ColorPoolColorNode) {
+				colorNodes[colorIndex] = (ColorPoolColorNode) {
 					.color = col,
-					.isAvailable = true,
+					.count = (RB_StoredSize) getBuildColorCount(slab->pool, slab->availability, colorIndex),
 					.parentData = {
 						.octant = NULL
 					}
@@ -319,258 +538,995 @@ RB_ColorPool* RB_createColorPool(RB_ColorChannelSize rSize, RB_ColorChannelSize
 			}
 		}
 	}
+}
 
+// Every node of the last layer has exactly one parent, so slabs never touch each other's children.
+void buildOctantSlab(const ColorPoolBuildSlab* slab) {
+	OctantLayerMetaData layer = slab->layer;
+	OctantLayerMetaData lastLayer = slab->lastLayer;
+
+	for(RB_ColorChannelSize layerR = slab->rStart; layerR < slab->rEnd; layerR++) {
+		ColorPoolOctant* newOct = ((ColorPoolOctant*) layer.dataStart)
+			+ getDataPosition(layerR, 0, 0, layer.gSize, layer.bSize);
+
+		for(RB_ColorChannelSize layerG = 0; layerG < layer.gSize; layerG++) {
+			for(RB_ColorChannelSize layerB = 0; layerB < layer.bSize; layerB++, newOct++) {
+				// The minimum r, g, and b of this octant translated into the global coordinates
+				RB_Color globalColor = {
+					.r = layerR * layer.divisor,
+					.g = layerG * layer.divisor,
+					.b = layerB * layer.divisor
+				};
 
-	// DEAL WITH OCTANTS
-	size_t maxOctants = calculateMaximumOctants(rSize, gSize, bSize);
-	ret->octants = (ColorPoolOctant*) malloc(sizeof(ColorPoolOctant) * maxOctants);
-
-	if(ret->octants == NULL) {
-		RB_freeColorPool(ret);
-		return NULL;
-	}
-
-	RB_Size octantDataIndex = 0;
-
-	OctantLayerMetaData lastLayer = {
-		.index = 0,
-		.divisor = 1,
-		.rSize = rSize,
-		.gSize = gSize,
-		.bSize = bSize,
-		.dataStart = ret->colorNodes
-	};
-
-	do {
-		OctantLayerMetaData layer = {
-			.index = lastLayer.index + 1,
-			.divisor = lastLayer.divisor * 2,
-			.rSize = (lastLayer.rSize + 1) / 2,
-			.gSize = (lastLayer.gSize + 1) / 2,
-			.bSize = (lastLayer.bSize + 1) / 2,
-			.dataStart = (ret->octants + octantDataIndex)
-		};
-
-		for(RB_ColorChannelSize layerR = 0; layerR < layer.rSize; layerR++) {
-			for(RB_ColorChannelSize layerG = 0; layerG < layer.gSize; layerG++) {
-				for(RB_ColorChannelSize layerB = 0; layerB < layer.bSize; layerB++) {
-					if(octantDataIndex >= maxOctants) {
-						fprintf(stderr, "Too many octants are being generated!\n");
-						RB_freeColorPool(ret);
-						return NULL;
-					}
-
-					ColorPoolOctant* newOct = ret->octants + octantDataIndex;
-					octantDataIndex++;
-
-					// The minimum r, g, and b of this octant translated into the global coordinates
-					RB_Color globalColor = {
-						.r = layerR * layer.divisor,
-						.g = layerG * layer.divisor,
-						.b = layerB * layer.divisor
-					};
+				newOct->parentData.octant = NULL;
 
-					newOct->parentData.octant = NULL;
+				newOct->minCorner = globalColor;
+				newOct->maxCorner = newOct->minCorner;
+				newOct->numChildren = 0;
 
-					newOct->minCorner = globalColor;
-					newOct->maxCorner = newOct->minCorner;
-					newOct->numChildren = 0;
+				// The minimum r, g, and b of this octant translated into the coordinates of the previous layer.
+				// minLLay stands for minimum last layer
+				RB_ColorChannelSize minLLayR = layerR * 2;
+				RB_ColorChannelSize minLLayG = layerG * 2;
+				RB_ColorChannelSize minLLayB = layerB * 2;
 
-					// The minimum r, g, and b of this octant translated into the coordinates of the previous layer.
-					// minLLay stands for minimum last layer
-					RB_ColorChannelSize minLLayR = layerR * 2;
-					RB_ColorChannelSize minLLayG = layerG * 2;
-					RB_ColorChannelSize minLLayB = layerB * 2;
+				for(RB_ColorChannelSize lLayR = minLLayR; lLayR < (minLLayR + 2); lLayR++) {
+					for(RB_ColorChannelSize lLayG = minLLayG; lLayG < (minLLayG + 2); lLayG++) {
+						for(RB_ColorChannelSize lLayB = minLLayB; lLayB < (minLLayB + 2); lLayB++) {
+							ColorPoolNode child = getDataFromLayer(lastLayer, lLayR, lLayG, lLayB);
 
-					for(RB_ColorChannelSize lLayR = minLLayR; lLayR < (minLLayR + 2); lLayR++) {
-						for(RB_ColorChannelSize lLayG = minLLayG; lLayG < (minLLayG + 2); lLayG++) {
-							for(RB_ColorChannelSize lLayB = minLLayB; lLayB < (minLLayB + 2); lLayB++) {
-								ColorPoolNode child = getDataFromLayer(lastLayer, lLayR, lLayG, lLayB);
+							// If the node we're looking at isn't valid (for instance if it's out of bounds, or it
+							// has no available colors), skip it.
+							if(!newNodeHasColors(child)) {
+								continue;
+							}
 
-								// If the node we're looking at isn't valid (for instance if it's out of bounds), skip it.
-								if(child.type == POOL_NODE_EMPTY) {
-									continue;
-								}
+							updateNodeParentData(child, newOct, newOct->numChildren);
 
-								updateNodeParentData(child, newOct, newOct->numChildren);
+							newOct->children[newOct->numChildren] = child;
+							newOct->numChildren++;
+						}
+					}		
+				}
 
-								newOct->children[newOct->numChildren] = child;
-								newOct->numChildren++;
-							}
-						}		
+				// calculate newOct's corners. When every color is available, the minimum corner is already known.
+				if(newOct->numChildren > 0) {
+					if(!slab->everyColorIsAvailable) {
+						newOct->minCorner = calculateOctantMinCorner(newOct);
 					}
-
-					// calculate newOct's maximum corner
 					newOct->maxCorner = calculateOctantMaxCorner(newOct);
+				}
 
-					// Make sure the rest of the children are empty nodes.
-					// This step arguably isn't necessary, but I'm doing it anyway.
-					for(NodeChildrenSize i = newOct->numChildren; i < RB_COLOR_POOL_NODE_NUM_CHILDREN; i++) {
-						newOct->children[i] = emptyColorPoolNode;
-					}
+				// Make sure the rest of the children are empty nodes.
+				// This step arguably isn't necessary, but I'm doing it anyway.
+				for(NodeChildrenSize i = newOct->numChildren; i < RB_COLOR_POOL_NODE_NUM_CHILDREN; i++) {
+					newOct->children[i] = emptyColorPoolNode;
 				}
 			}
 		}
+	}
+}
 
-		lastLayer = layer;
-	} while(lastLayer.rSize > 1 || lastLayer.gSize > 1 || lastLayer.bSize > 1);
-
-	// set the root node
-	ret->root = (ColorPoolNode) {
-		.type = POOL_NODE_OCTANT,
-		.octantNodePtr = (ColorPoolOctant*) lastLayer.dataStart
-	};
+void* runColorPoolBuildSlab(void* slab) {
+	ColorPoolBuildSlab* toBuild = (ColorPoolBuildSlab*) slab;
+	RB_TRACE_BEGIN(traceStart);
 
-	//prune the tree
-	pruneNewNodeTree(ret->root);
+	if(toBuild->layer.index == 0) {
+		buildColorNodeSlab(toBuild);
+	} else {
+		buildOctantSlab(toBuild);
+	}
 
-	return ret;
+	RB_TRACE_END_WITH_ARG(traceStart, "buildColorPoolSlab", "layer", toBuild->layer.index);
+	return NULL;
 }
 
-// Frees a previously allocated color pool
-void RB_freeColorPool(RB_ColorPool* pool) {
-	if(pool == NULL) {
-		return;
+/*
+Builds a whole layer of the tree, split into slabs along the red axis, one per thread of the calling thread's budget
+(or a single one for small layers). The calling thread builds the first slab itself.
+*/
+void buildColorPoolLayer(
+	const RB_ColorPool* pool,
+	OctantLayerMetaData layer,
+	OctantLayerMetaData lastLayer,
+	const uint8_t* availability
+) {
+	size_t numNodes = (size_t) layer.rSize * layer.gSize * layer.bSize;
+	long numThreads = 1;
+
+	if(numNodes >= RB_COLOR_POOL_PARALLEL_BUILD_THRESHOLD) {
+		numThreads = (colorPoolBuildThreads > 0)? colorPoolBuildThreads : sysconf(_SC_NPROCESSORS_ONLN);
+		if(numThreads > RB_COLOR_POOL_MAX_BUILD_THREADS) {
+			numThreads = RB_COLOR_POOL_MAX_BUILD_THREADS;
+		}
+		if(numThreads > layer.rSize) {
+			numThreads = layer.rSize;
+		}
+		if(numThreads < 1) {
+			numThreads = 1;
+		}
 	}
 
-	printf("Freeing RB_ColorPool!\n");
+	ColorPoolBuildSlab slabs[RB_COLOR_POOL_MAX_BUILD_THREADS];
+	pthread_t threads[RB_COLOR_POOL_MAX_BUILD_THREADS];
+	bool threadStarted[RB_COLOR_POOL_MAX_BUILD_THREADS];
+
+	for(long i = 0; i < numThreads; i++) {
+		slabs[i] = (ColorPoolBuildSlab) {
+			.layer = layer,
+			.lastLayer = lastLayer,
+			.pool = pool,
+			.availability = availability,
+			.everyColorIsAvailable = availability == NULL && pool->totalCount >= pool->numColors,
+			.rStart = (RB_ColorChannelSize) ((layer.rSize * i) / numThreads),
+			.rEnd = (RB_ColorChannelSize) ((layer.rSize * (i + 1)) / numThreads)
+		};
+		threadStarted[i] = false;
+	}
 
-	free(pool->colorNodes);
-	pool->colorNodes = NULL;
+	for(long i = 1; i < numThreads; i++) {
+		threadStarted[i] = pthread_create(&(threads[i]), NULL, runColorPoolBuildSlab, &(slabs[i])) == 0;
+	}
 
-	free(pool->octants);
-	pool->octants = NULL;
+	runColorPoolBuildSlab(&(slabs[0]));
+
+	for(long i = 1; i < numThreads; i++) {
+		if(threadStarted[i]) {
+			pthread_join(threads[i], NULL);
+		} else {
+			// If the thread couldn't be started, its slab is built here instead.
+			runColorPoolBuildSlab(&(slabs[i]));
+		}
+	}
+}
 
-	free(pool->nodeQueue);
-	pool->nodeQueue = NULL;
+// PALETTE POOLS
 
-	free(pool);
+/*
+A palette pool's colors are sorted by their Morton codes, which interleave the bits of the red, green and blue
+channels, a bit of each at a time, starting from the most significant. Every three bits (a digit) of a Morton code
+pick one of the eight octants of the cube the digits before it narrowed a color down to, so colors that share the
+first digits of their codes share the octants those digits pick, and lie next to each other in the sorted order.
+
+That makes the pool's tree a compressed octree of the sorted colors, which is built in a single pass over them (see
+buildPaletteColorPoolTree): every octant is the deepest one shared by a run of neighboring colors, and octants that
+would only have one child are never made. Each distinct color is stored once, and the number of times it appears in
+the palette is its count.
+*/
+
+// Palette channels are always stored as they are, so there are 8 digits in a Morton code.
+#define RB_PALETTE_COLOR_DIGITS 8
+// The most octants that can be open at once while building a palette pool's tree: one for each digit.
+#define RB_PALETTE_MAX_OPEN_OCTANTS RB_PALETTE_COLOR_DIGITS
+
+// The Morton codes are radix sorted in two passes of this many bits.
+#define RB_PALETTE_SORT_DIGIT_BITS 12
+
+// Spreads the 8 bits of a channel out, so that there are two zero bits between each of them.
+uint32_t spreadChannelBits(uint32_t channel) {
+	uint32_t x = channel & 0xFF;
+	x = (x | (x << 8)) & 0x0000F00F;
+	x = (x | (x << 4)) & 0x000C30C3;
+	x = (x | (x << 2)) & 0x00249249;
+	return x;
 }
 
-RB_ColorChannel getChannelValueWithinBoundaries(RB_ColorChannel minVal, RB_ColorChannel maxVal, RB_ColorChannel toBound) {
-	RB_ColorChannel lowerBounded = toBound < minVal? minVal : toBound;
-	return lowerBounded > maxVal? maxVal : lowerBounded;
+// The reverse of spreadChannelBits.
+uint32_t compactChannelBits(uint32_t spread) {
+	uint32_t x = spread & 0x00249249;
+	x = (x | (x >> 2)) & 0x000C30C3;
+	x = (x | (x >> 4)) & 0x0000F00F;
+	x = (x | (x >> 8)) & 0x000000FF;
+	return x;
 }
 
-RB_ColorSquareDistance getSquareDistance(RB_Color a, RB_Color b) {
-	RB_ColorChannelDifference dR = a.r - b.r;
-	RB_ColorChannelDifference dG = a.g - b.g;
-	RB_ColorChannelDifference dB = a.b - b.b;
+uint32_t getColorMortonCode(RB_Color color) {
+	return (spreadChannelBits(color.r) << 2) | (spreadChannelBits(color.g) << 1) | spreadChannelBits(color.b);
+}
 
-	return (
-		((RB_ColorSquareDistance) dR * dR)
-		+ ((RB_ColorSquareDistance) dG * dG)
-		+ ((RB_ColorSquareDistance) dB * dB)
-	);
+RB_Color getMortonCodeColor(uint32_t code) {
+	return (RB_Color) {
+		.r = (RB_ColorChannel) compactChannelBits(code >> 2),
+		.g = (RB_ColorChannel) compactChannelBits(code >> 1),
+		.b = (RB_ColorChannel) compactChannelBits(code)
+	};
 }
 
-// Using only the bounds of the octant and not the actual elements inside of it, what's the closest color
-// that this octant could possibly contain?
-RB_ColorSquareDistance getBlindClosestDistance(ColorPoolNode node, RB_Color color) {
-	switch(node.type) {
-		case POOL_NODE_EMPTY:
-			fprintf(stderr, "Attemping to get the closest distance to an empty node!\n");
-			return ~((RB_ColorSquareDistance) 0); // This should return the maximum possible value
-		case POOL_NODE_OCTANT: {
-			ColorPoolOctant* octant = node.octantNodePtr;
-			RB_Color closest = (RB_Color) {
-				.r = getChannelValueWithinBoundaries(octant->minCorner.r, octant->maxCorner.r, color.r),
-				.g = getChannelValueWithinBoundaries(octant->minCorner.g, octant->maxCorner.g, color.g),
-				.b = getChannelValueWithinBoundaries(octant->minCorner.b, octant->maxCorner.b, color.b),
-			};
-			return getSquareDistance(color, closest);
+// Sorts the codes with a least significant digit radix sort. The scratch space must have room for as many codes.
+void sortMortonCodes(uint32_t* codes, uint32_t* scratch, size_t numCodes) {
+	size_t digitStarts[1 << RB_PALETTE_SORT_DIGIT_BITS];
+	uint32_t digitMask = (1 << RB_PALETTE_SORT_DIGIT_BITS) - 1;
+	uint32_t* from = codes;
+	uint32_t* to = scratch;
+
+	// There are an even number of passes, so the sorted codes end up back where they started.
+	for(int shift = 0; shift < RB_PALETTE_COLOR_DIGITS * 3; shift += RB_PALETTE_SORT_DIGIT_BITS) {
+		memset(digitStarts, 0, sizeof(digitStarts));
+		for(size_t i = 0; i < numCodes; i++) {
+			digitStarts[(from[i] >> shift) & digitMask]++;
 		}
-		case POOL_NODE_COLOR: {
-			ColorPoolColorNode* colorNodePtr = node.colorNodePtr;
-			return getSquareDistance(color, colorNodePtr->color);
-		}
-	}
-}
 
-RB_ColorSquareDistance getBlindWorstDistance(ColorPoolNode node, RB_Color color) {
-	switch(node.type) {
-		case POOL_NODE_EMPTY:
-			fprintf(stderr, "Attemping to get the worst distance to an empty node!\n");
-			return 0;
-		case POOL_NODE_OCTANT: {
-			ColorPoolOctant* octant = node.octantNodePtr;
-			RB_Color furthestColor = {
-				.r = ((color.r * 2) - (octant->minCorner.r + octant->maxCorner.r)) > 0?
-					octant->minCorner.r : octant->maxCorner.r,
-				.g = ((color.g * 2) - (octant->minCorner.g + octant->maxCorner.g)) > 0?
-					octant->minCorner.g : octant->maxCorner.g,
-				.b = ((color.b * 2) - (octant->minCorner.b + octant->maxCorner.b)) > 0?
-					octant->minCorner.b : octant->maxCorner.b
-			};
-			return getSquareDistance(color, furthestColor);
+		size_t total = 0;
+		for(uint32_t digit = 0; digit <= digitMask; digit++) {
+			size_t count = digitStarts[digit];
+			digitStarts[digit] = total;
+			total += count;
 		}
-		case POOL_NODE_COLOR: {
-			ColorPoolColorNode* colorNodePtr = node.colorNodePtr;
-			return getSquareDistance(color, colorNodePtr->color);
+
+		for(size_t i = 0; i < numCodes; i++) {
+			to[digitStarts[(from[i] >> shift) & digitMask]++] = from[i];
 		}
+
+		uint32_t* swap = from;
+		from = to;
+		to = swap;
 	}
 }
 
+// Returns the level of the deepest octant shared by two different colors of a palette pool, which is the position
+// of the most significant digit their Morton codes differ in.
+int getPaletteSplitLevel(uint32_t previousCode, uint32_t code) {
+	return (31 - __builtin_clz(previousCode ^ code)) / 3;
+}
 
-/*
-Basic algorithm (figured out by me!):
-1) Add the root node to the "node queue." At the start, it will be the only node in the queue.
-2) Initialize minWorstCase to the worst case of the root node, I guess.
-3) Iterate through each node in the node queue.
-	3.1) If the node's best case is greater than minWorstCase, remove it from the queue.
-	3.2) If the node is an octant node, iterate through its children.
-		3.2.1) If the child's best case is greater than minWorstCase, do nothing.
-		3.2.2) If the child's best case is less than or equal to minWorstCase, add it to the node queue.
-		3.2.3) If the child's worst case is less than minWorstCase, set minWorstCase to the child's worst case value.
-	3.3) If the node is an octant node, remove it from the queue.
-4) If, during step 3, minWorstCase was updated or an octant was added to the queue, repeat step 3
-5) At this point, we know that the node queue only contains ideal colors. Choose one and return.
-*/
-RB_Color RB_findIdealAvailableColor(RB_ColorPool* colorPool, RB_Color desired) {
-	ColorPoolNode* nodeQueue = colorPool->nodeQueue;
-	RB_Size nodeQueueSize = 1;
-	RB_Size nodeQueueNextSize = 0;
+typedef struct {
+	ColorPoolOctant* octant;
+	int level;
+} OpenPaletteOctant;
 
-	if(colorPool->root.type == POOL_NODE_EMPTY) {
-		fprintf(stderr, "Error: attempting to find ideal available color in an empty color pool!");
-		return (RB_Color) {
-			.r = 0,
-			.g = 0,
-			.b = 0
-		};
+void addPaletteOctantChild(ColorPoolOctant* octant, ColorPoolNode child) {
+	updateNodeParentData(child, octant, octant->numChildren);
+	octant->children[octant->numChildren] = child;
+	octant->numChildren++;
+}
+
+// Called once an octant has all of its children.
+ColorPoolNode closePaletteOctant(ColorPoolOctant* octant) {
+	octant->minCorner = calculateOctantMinCorner(octant);
+	octant->maxCorner = calculateOctantMaxCorner(octant);
+
+	for(NodeChildrenSize i = octant->numChildren; i < RB_COLOR_POOL_NODE_NUM_CHILDREN; i++) {
+		octant->children[i] = emptyColorPoolNode;
 	}
 
-	nodeQueue[0] = colorPool->root;
-	RB_ColorSquareDistance minWorstCase = getBlindWorstDistance(colorPool->root, desired);
-	bool shouldIterateAgain = true;
+	return (ColorPoolNode) {
+		.type = POOL_NODE_OCTANT,
+		.octantNodePtr = octant
+	};
+}
 
-	while(shouldIterateAgain) {
-		shouldIterateAgain = false;
+/*
+Builds a palette pool's tree in a single pass over its sorted colors. Returns false if the tree could not be built.
 
-		for(RB_Size i = 0; i < nodeQueueSize; i++) {
-			ColorPoolNode node = nodeQueue[i];
-			RB_ColorSquareDistance nodeBestCase = getBlindClosestDistance(node, desired);
+Each available color is added after the one before it, whose subtree (pending) is still waiting for a parent. The open
+octants form a path down the right edge of the tree, deepest last. Every open octant that is deeper than the octant
+splitting the two colors is finished, so it is closed and becomes the pending subtree instead. The pending subtree is
+then added to the splitting octant, which is opened first if it isn't already.
+*/
+bool buildPaletteColorPoolTree(RB_ColorPool* pool, const uint8_t* availability) {
+	RB_TRACE_BEGIN(traceStart);
 
-			if(nodeBestCase <= minWorstCase) {
-				if(node.type == POOL_NODE_OCTANT) {
-					ColorPoolOctant* octantNode = node.octantNodePtr;
-					for(NodeChildrenSize j = 0; j < octantNode->numChildren; j++) {
-						ColorPoolNode child = octantNode->children[j];
+	OpenPaletteOctant openOctants[RB_PALETTE_MAX_OPEN_OCTANTS];
+	int numOpenOctants = 0;
+	size_t numOctants = 0;
 
-						RB_ColorSquareDistance childBestCase = getBlindClosestDistance(child, desired);
-						RB_ColorSquareDistance childWorstCase = getBlindWorstDistance(child, desired);
+	ColorPoolNode pending = emptyColorPoolNode;
+	uint32_t previousCode = 0;
 
-						if(childBestCase <= minWorstCase) {
-							// add child to node queue
+	for(size_t i = 0; i < pool->numColors; i++) {
+		ColorPoolColorNode* colorNode = &(pool->colorNodes[i]);
 
-							if(nodeQueueNextSize <= i) {
-								// If there's room at the start of the queue, add it there
-								// We're able to overwrite the node at position `i` because we already have its value saved
-								// in the node variable, and because it's an octant, it's going to be deleted anyway.
+		colorNode->count = (RB_StoredSize) getBuildColorCount(pool, availability, i);
+		colorNode->parentData.octant = NULL;
+		colorNode->parentData.index = 0;
 
-								if(child.type == POOL_NODE_OCTANT) {
-									// Despite my algorithm saying that we should iterate again whenever we add
-									// an octant to the queue, the way we're handling adding nodes to the queue
+		if(colorNode->count == 0) {
+			continue;
+		}
+
+		uint32_t code = getColorMortonCode(colorNode->color);
+
+		if(pending.type != POOL_NODE_EMPTY) {
+			int level = getPaletteSplitLevel(previousCode, code);
+
+			while(numOpenOctants > 0 && openOctants[numOpenOctants - 1].level < level) {
+				ColorPoolOctant* finished = openOctants[numOpenOctants - 1].octant;
+				addPaletteOctantChild(finished, pending);
+				pending = closePaletteOctant(finished);
+				numOpenOctants--;
+			}
+
+			if(numOpenOctants == 0 || openOctants[numOpenOctants - 1].level != level) {
+				if(numOctants == pool->maxOctants) {
+					fprintf(stderr, "Too many octants are being generated!\n");
+					return false;
+				}
+
+				ColorPoolOctant* opened = &(pool->octants[numOctants]);
+				numOctants++;
+				opened->parentData.octant = NULL;
+				opened->numChildren = 0;
+
+				openOctants[numOpenOctants] = (OpenPaletteOctant) {
+					.octant = opened,
+					.level = level
+				};
+				numOpenOctants++;
+			}
+
+			addPaletteOctantChild(openOctants[numOpenOctants - 1].octant, pending);
+		}
+
+		pending = (ColorPoolNode) {
+			.type = POOL_NODE_COLOR,
+			.colorNodePtr = colorNode
+		};
+		previousCode = code;
+	}
+
+	while(numOpenOctants > 0) {
+		ColorPoolOctant* finished = openOctants[numOpenOctants - 1].octant;
+		addPaletteOctantChild(finished, pending);
+		pending = closePaletteOctant(finished);
+		numOpenOctants--;
+	}
+
+	pool->numOctants = numOctants;
+	pool->root = pending;
+	if(pool->root.type != POOL_NODE_EMPTY) {
+		updateNodeParentData(pool->root, NULL, 0);
+	}
+
+	RB_TRACE_END_WITH_ARG(traceStart, "buildPaletteColorPoolTree", "colors", pool->numColors);
+	return true;
+}
+
+// Returns the color's node, or NULL if the palette doesn't have the color.
+ColorPoolColorNode* getPaletteColorNode(RB_ColorPool* pool, RB_Color color) {
+	uint32_t code = getColorMortonCode(color);
+	size_t low = 0;
+	size_t high = pool->numColors;
+
+	while(low < high) {
+		size_t middle = low + ((high - low) / 2);
+		if(getColorMortonCode(pool->colorNodes[middle].color) < code) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	if(low == pool->numColors || getColorMortonCode(pool->colorNodes[low].color) != code) {
+		return NULL;
+	}
+
+	return &(pool->colorNodes[low]);
+}
+
+RB_ColorPool* RB_createPaletteColorPool(const RB_Color* palette, RB_Size length) {
+	return RB_createPaletteColorPoolInArena(NULL, palette, length);
+}
+
+RB_ColorPool* RB_createPaletteColorPoolInArena(RB_Arena* arena, const RB_Color* palette, RB_Size length) {
+	if(length < 1 || length > RB_MAXIMUM_NUMBER_OF_PIXELS) {
+		fprintf(
+			stderr,
+			"Error creating palette color pool: the palette must have between 1 and %d colors, not %ld!\n",
+			RB_MAXIMUM_NUMBER_OF_PIXELS, (long) length
+		);
+		return NULL;
+	}
+
+	uint32_t* codes = (uint32_t*) malloc(sizeof(uint32_t) * length);
+	uint32_t* scratch = (uint32_t*) malloc(sizeof(uint32_t) * length);
+
+	if(codes == NULL || scratch == NULL) {
+		fprintf(stderr, "Error creating palette color pool: cannot allocate space to sort the palette!\n");
+		free(codes);
+		free(scratch);
+		return NULL;
+	}
+
+	// A Morton code holds every bit of its color, so sorting the codes sorts the colors, too, and puts every color's
+	// duplicates next to each other.
+	for(RB_Size i = 0; i < length; i++) {
+		codes[i] = getColorMortonCode(palette[i]);
+	}
+	sortMortonCodes(codes, scratch, (size_t) length);
+	free(scratch);
+
+	size_t numDistinct = 1;
+	for(RB_Size i = 1; i < length; i++) {
+		numDistinct += codes[i] != codes[i - 1];
+	}
+
+	RB_ColorPool* ret = allocateColorPool(arena, numDistinct, calculatePaletteMaximumOctants(numDistinct));
+	if(ret != NULL) {
+		ret->countEnds = (RB_StoredSize*) RB_allocateZeroed(
+			arena,
+			RB_ARENA_COLOR_POOL,
+			sizeof(RB_StoredSize) * numDistinct
+		);
+	}
+
+	if(ret == NULL || ret->countEnds == NULL) {
+		fprintf(stderr, "Error creating palette color pool: cannot allocate the pool!\n");
+		free(codes);
+		RB_freeColorPool(ret);
+		return NULL;
+	}
+
+	ret->rSize = RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION;
+	ret->gSize = RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION;
+	ret->bSize = RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION;
+	ret->isPalette = true;
+
+	size_t colorIndex = 0;
+	RB_Size maximumCount = 0;
+	RB_Size runStart = 0;
+	for(RB_Size i = 1; i <= length; i++) {
+		if(i < length && codes[i] == codes[runStart]) {
+			continue;
+		}
+
+		ret->colorNodes[colorIndex].color = getMortonCodeColor(codes[runStart]);
+		ret->countEnds[colorIndex] = (RB_StoredSize) i;
+		if(i - runStart > maximumCount) {
+			maximumCount = i - runStart;
+		}
+
+		colorIndex++;
+		runStart = i;
+	}
+	free(codes);
+
+	setColorPoolCounts(ret, (size_t) length, maximumCount);
+
+	if(!buildPaletteColorPoolTree(ret, NULL)) {
+		RB_freeColorPool(ret);
+		return NULL;
+	}
+
+	return ret;
+}
+
+/*
+Builds the pool's tree in a single bottom-up pass. Returns false if the tree could not be built.
+
+If availability is NULL, every color gets its initial count (see getInitialColorCount). Otherwise, every color gets
+its count from the availability array (see RB_getColorPoolAvailability), and the tree is built as if every color with
+a count of zero had been removed. Octants that would be left without any colors are never linked into the tree.
+
+Large layers are built by several threads at once (see buildColorPoolLayer). Palette pools are built by
+buildPaletteColorPoolTree instead.
+*/
+bool buildColorPoolTree(RB_ColorPool* pool, const uint8_t* availability) {
+	if(pool->isPalette) {
+		return buildPaletteColorPoolTree(pool, availability);
+	}
+
+	RB_TRACE_BEGIN(traceStart);
+
+	// DEAL WITH COLORS
+	OctantLayerMetaData lastLayer = {
+		.index = 0,
+		.divisor = 1,
+		.rSize = pool->rSize,
+		.gSize = pool->gSize,
+		.bSize = pool->bSize,
+		.dataStart = pool->colorNodes
+	};
+
+	buildColorPoolLayer(pool, lastLayer, lastLayer, availability);
+
+
+	// DEAL WITH OCTANTS
+	size_t maxOctants = pool->maxOctants;
+	size_t octantDataIndex = 0;
+
+	do {
+		OctantLayerMetaData layer = {
+			.index = lastLayer.index + 1,
+			.divisor = lastLayer.divisor * 2,
+			.rSize = (lastLayer.rSize + 1) / 2,
+			.gSize = (lastLayer.gSize + 1) / 2,
+			.bSize = (lastLayer.bSize + 1) / 2,
+			.dataStart = (pool->octants + octantDataIndex)
+		};
+
+		size_t layerOctants = (size_t) layer.rSize * layer.gSize * layer.bSize;
+		if(octantDataIndex + layerOctants > maxOctants) {
+			fprintf(stderr, "Too many octants are being generated!\n");
+			return false;
+		}
+
+		buildColorPoolLayer(pool, layer, lastLayer, availability);
+		octantDataIndex += layerOctants;
+
+		lastLayer = layer;
+	} while(lastLayer.rSize > 1 || lastLayer.gSize > 1 || lastLayer.bSize > 1);
+
+	pool->numOctants = octantDataIndex;
+
+	// set the root node
+	pool->root = (ColorPoolNode) {
+		.type = POOL_NODE_OCTANT,
+		.octantNodePtr = (ColorPoolOctant*) lastLayer.dataStart
+	};
+
+	if(!newNodeHasColors(pool->root)) {
+		pool->root = emptyColorPoolNode;
+		RB_TRACE_END_WITH_ARG(traceStart, "buildColorPoolTree", "colors", pool->numColors);
+		return true;
+	}
+
+	//prune the tree
+	pruneNewNodeTree(pool->root);
+
+	// Pruning can't replace the root, so if it only has one child, that child becomes the root.
+	if(pool->root.octantNodePtr->numChildren == 1) {
+		pool->root = pool->root.octantNodePtr->children[0];
+		updateNodeParentData(pool->root, NULL, 0);
+	}
+
+	RB_TRACE_END_WITH_ARG(traceStart, "buildColorPoolTree", "colors", pool->numColors);
+	return true;
+}
+
+RB_ColorPool* RB_createColorPool(RB_ColorChannelSize rSize, RB_ColorChannelSize gSize, RB_ColorChannelSize bSize) {
+	return RB_createColorPoolInArena(NULL, rSize, gSize, bSize);
+}
+
+RB_ColorPool* RB_createColorPoolInArena(
+	RB_Arena* arena,
+	RB_ColorChannelSize rSize,
+	RB_ColorChannelSize gSize,
+	RB_ColorChannelSize bSize
+) {
+	return RB_createCountedColorPoolInArena(arena, rSize, gSize, bSize, rSize * gSize * bSize);
+}
+
+RB_ColorPool* RB_createCountedColorPool(
+	RB_ColorChannelSize rSize,
+	RB_ColorChannelSize gSize,
+	RB_ColorChannelSize bSize,
+	RB_Size totalCount
+) {
+	return RB_createCountedColorPoolInArena(NULL, rSize, gSize, bSize, totalCount);
+}
+
+RB_ColorPool* RB_createCountedColorPoolInArena(
+	RB_Arena* arena,
+	RB_ColorChannelSize rSize,
+	RB_ColorChannelSize gSize,
+	RB_ColorChannelSize bSize,
+	RB_Size totalCount
+) {
+	if(totalCount < 1 || totalCount > RB_MAXIMUM_NUMBER_OF_PIXELS) {
+		fprintf(
+			stderr,
+			"Error creating color pool: the colors must be usable between 1 and %d times altogether, not %ld!\n",
+			RB_MAXIMUM_NUMBER_OF_PIXELS, (long) totalCount
+		);
+		return NULL;
+	}
+
+	size_t numColors = (size_t) rSize * gSize * bSize;
+	RB_ColorPool* ret = allocateColorPool(arena, numColors, calculateMaximumOctants(rSize, gSize, bSize));
+
+	if(ret == NULL) {
+		return NULL;
+	}
+
+	ret->rSize = rSize;
+	ret->gSize = gSize;
+	ret->bSize = bSize;
+	// Every color's count is the total divided by the number of colors, either rounded down or up.
+	setColorPoolCounts(ret, (size_t) totalCount, (RB_Size) (((size_t) totalCount + numColors - 1) / numColors));
+
+	if(!buildColorPoolTree(ret, NULL)) {
+		RB_freeColorPool(ret);
+		return NULL;
+	}
+
+	return ret;
+}
+
+bool RB_resetColorPool(RB_ColorPool* pool) {
+	// Rebuilding the tree in place touches every node once, but doesn't allocate anything.
+	return buildColorPoolTree(pool, NULL);
+}
+
+size_t RB_getColorPoolAvailabilitySize(const RB_ColorPool* pool) {
+	return ((pool->numColors * pool->availabilityCountBits) + 7) / 8;
+}
+
+size_t RB_getColorPoolSize(const RB_ColorPool* pool) {
+	return pool->totalCount;
+}
+
+RB_Color RB_getColorPoolColor(const RB_ColorPool* pool, size_t index) {
+	size_t colorIndex;
+
+	if(pool->countEnds != NULL) {
+		// The first color whose counts end after the index.
+		size_t low = 0;
+		size_t high = pool->numColors - 1;
+		while(low < high) {
+			size_t middle = low + ((high - low) / 2);
+			if((size_t) pool->countEnds[middle] <= index) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+		colorIndex = low;
+	} else {
+		// The last color whose counts start at or before the index (see getLatticeCountStart).
+		colorIndex = (size_t) ((((uint64_t) index + 1) * pool->numColors - 1) / pool->totalCount);
+	}
+
+	return pool->colorNodes[colorIndex].color;
+}
+
+void RB_getColorPoolAvailability(const RB_ColorPool* pool, uint8_t* availability) {
+	memset(availability, 0, RB_getColorPoolAvailabilitySize(pool));
+
+	for(size_t i = 0; i < pool->numColors; i++) {
+		if(pool->colorNodes[i].count > 0) {
+			storeAvailabilityCount(pool, availability, i, pool->colorNodes[i].count);
+		}
+	}
+}
+
+bool RB_rebuildColorPool(RB_ColorPool* pool, const uint8_t* availability) {
+	// When every color starts out with a count of one, a single bit can't hold any more than that.
+	if(pool->availabilityCountBits > 1 || pool->totalCount != pool->numColors) {
+		for(size_t i = 0; i < pool->numColors; i++) {
+			if(loadAvailabilityCount(pool, availability, i) > getInitialColorCount(pool, i)) {
+				RB_Color color = pool->colorNodes[i].color;
+				fprintf(
+					stderr,
+					"Error rebuilding color pool: Color(%d, %d, %d) has more uses left than it started out with!\n",
+					color.r, color.g, color.b
+				);
+				return false;
+			}
+		}
+	}
+
+	// Removing the missing colors one at a time would restructure the tree once per color. Building the tree with only
+	// the available colors in it touches every node once, no matter how many colors are missing.
+	return buildColorPoolTree(pool, availability);
+}
+
+// Translates a node pointing into one pool's arrays into the equivalent node pointing into another pool's arrays.
+ColorPoolNode rebaseColorPoolNode(ColorPoolNode node, const RB_ColorPool* from, RB_ColorPool* to) {
+	switch(node.type) {
+		case POOL_NODE_COLOR:
+			node.colorNodePtr = to->colorNodes + (node.colorNodePtr - from->colorNodes);
+			break;
+		case POOL_NODE_OCTANT:
+			node.octantNodePtr = to->octants + (node.octantNodePtr - from->octants);
+			break;
+		case POOL_NODE_EMPTY:
+			break;
+	}
+	return node;
+}
+
+ColorPoolOctant* rebaseColorPoolOctant(ColorPoolOctant* octant, const RB_ColorPool* from, RB_ColorPool* to) {
+	return (octant == NULL)? NULL : to->octants + (octant - from->octants);
+}
+
+bool RB_copyColorPool(RB_ColorPool* dest, const RB_ColorPool* src) {
+	if(
+		dest->rSize != src->rSize || dest->gSize != src->gSize || dest->bSize != src->bSize
+		|| dest->isPalette != src->isPalette || dest->numColors != src->numColors
+		|| dest->totalCount != src->totalCount
+	) {
+		fprintf(stderr, "Error copying color pool: the pools have different ranges of colors!\n");
+		return false;
+	}
+
+	// A palette pool with the same number of distinct colors and the same total count can still have a different
+	// palette, which is copied along with everything else.
+	if(src->countEnds != NULL) {
+		memcpy(dest->countEnds, src->countEnds, sizeof(RB_StoredSize) * src->numColors);
+	}
+	setColorPoolCounts(dest, src->totalCount, src->maximumCount);
+
+	// Both arrays are copied wholesale, and then every pointer into them is moved over to the destination's arrays.
+	memcpy(dest->colorNodes, src->colorNodes, sizeof(ColorPoolColorNode) * src->numColors);
+	memcpy(dest->octants, src->octants, sizeof(ColorPoolOctant) * src->numOctants);
+	dest->numOctants = src->numOctants;
+
+	for(size_t i = 0; i < dest->numColors; i++) {
+		ChildNodeParentData* parentData = &(dest->colorNodes[i].parentData);
+		parentData->octant = rebaseColorPoolOctant(parentData->octant, src, dest);
+	}
+
+	for(size_t i = 0; i < dest->numOctants; i++) {
+		ColorPoolOctant* octant = &(dest->octants[i]);
+		octant->parentData.octant = rebaseColorPoolOctant(octant->parentData.octant, src, dest);
+
+		for(NodeChildrenSize j = 0; j < octant->numChildren; j++) {
+			octant->children[j] = rebaseColorPoolNode(octant->children[j], src, dest);
+		}
+	}
+
+	dest->root = rebaseColorPoolNode(src->root, src, dest);
+
+	return true;
+}
+
+RB_ColorPool* RB_cloneColorPool(const RB_ColorPool* src) {
+	return RB_cloneColorPoolInArena(NULL, src);
+}
+
+RB_ColorPool* RB_cloneColorPoolInArena(RB_Arena* arena, const RB_ColorPool* src) {
+	RB_ColorPool* ret = allocateColorPool(arena, src->numColors, src->maxOctants);
+
+	if(ret == NULL) {
+		return NULL;
+	}
+
+	ret->rSize = src->rSize;
+	ret->gSize = src->gSize;
+	ret->bSize = src->bSize;
+	ret->isPalette = src->isPalette;
+	ret->totalCount = src->totalCount;
+
+	if(src->countEnds != NULL) {
+		ret->countEnds = (RB_StoredSize*) RB_allocateZeroed(
+			arena,
+			RB_ARENA_COLOR_POOL,
+			sizeof(RB_StoredSize) * src->numColors
+		);
+		if(ret->countEnds == NULL) {
+			RB_freeColorPool(ret);
+			return NULL;
+		}
+	}
+
+	RB_copyColorPool(ret, src);
+	return ret;
+}
+
+// Frees a previously allocated color pool
+void RB_freeColorPool(RB_ColorPool* pool) {
+	if(pool == NULL) {
+		return;
+	}
+
+	printf("Freeing RB_ColorPool!\n");
+
+	RB_freeZeroed(pool->arena, pool->colorNodes);
+	pool->colorNodes = NULL;
+
+	RB_freeZeroed(pool->arena, pool->octants);
+	pool->octants = NULL;
+
+	RB_freeZeroed(pool->arena, pool->countEnds);
+	pool->countEnds = NULL;
+
+	RB_freeColorPoolSearch(pool->search);
+	pool->search = NULL;
+
+	RB_freeZeroed(pool->arena, pool);
+}
+
+RB_ColorChannel getChannelValueWithinBoundaries(RB_ColorChannel minVal, RB_ColorChannel maxVal, RB_ColorChannel toBound) {
+	RB_ColorChannel lowerBounded = toBound < minVal? minVal : toBound;
+	return lowerBounded > maxVal? maxVal : lowerBounded;
+}
+
+RB_ColorSquareDistance getSquareDistance(RB_Color a, RB_Color b) {
+	RB_ColorChannelDifference dR = a.r - b.r;
+	RB_ColorChannelDifference dG = a.g - b.g;
+	RB_ColorChannelDifference dB = a.b - b.b;
+
+	return (
+		((RB_ColorSquareDistance) dR * dR)
+		+ ((RB_ColorSquareDistance) dG * dG)
+		+ ((RB_ColorSquareDistance) dB * dB)
+	);
+}
+
+// Using only the bounds of the octant and not the actual elements inside of it, what's the closest color
+// that this octant could possibly contain?
+RB_ColorSquareDistance getBlindClosestDistance(ColorPoolNode node, RB_Color color) {
+	switch(node.type) {
+		case POOL_NODE_EMPTY:
+			fprintf(stderr, "Attemping to get the closest distance to an empty node!\n");
+			return ~((RB_ColorSquareDistance) 0); // This should return the maximum possible value
+		case POOL_NODE_OCTANT: {
+			ColorPoolOctant* octant = node.octantNodePtr;
+			RB_Color closest = (RB_Color) {
+				.r = getChannelValueWithinBoundaries(octant->minCorner.r, octant->maxCorner.r, color.r),
+				.g = getChannelValueWithinBoundaries(octant->minCorner.g, octant->maxCorner.g, color.g),
+				.b = getChannelValueWithinBoundaries(octant->minCorner.b, octant->maxCorner.b, color.b),
+			};
+			return getSquareDistance(color, closest);
+		}
+		case POOL_NODE_COLOR: {
+			ColorPoolColorNode* colorNodePtr = node.colorNodePtr;
+			return getSquareDistance(color, colorNodePtr->color);
+		}
+	}
+}
+
+RB_ColorSquareDistance getBlindWorstDistance(ColorPoolNode node, RB_Color color) {
+	switch(node.type) {
+		case POOL_NODE_EMPTY:
+			fprintf(stderr, "Attemping to get the worst distance to an empty node!\n");
+			return 0;
+		case POOL_NODE_OCTANT: {
+			ColorPoolOctant* octant = node.octantNodePtr;
+			RB_Color furthestColor = {
+				.r = ((color.r * 2) - (octant->minCorner.r + octant->maxCorner.r)) > 0?
+					octant->minCorner.r : octant->maxCorner.r,
+				.g = ((color.g * 2) - (octant->minCorner.g + octant->maxCorner.g)) > 0?
+					octant->minCorner.g : octant->maxCorner.g,
+				.b = ((color.b * 2) - (octant->minCorner.b + octant->maxCorner.b)) > 0?
+					octant->minCorner.b : octant->maxCorner.b
+			};
+			return getSquareDistance(color, furthestColor);
+		}
+		case POOL_NODE_COLOR: {
+			ColorPoolColorNode* colorNodePtr = node.colorNodePtr;
+			return getSquareDistance(color, colorNodePtr->color);
+		}
+	}
+}
+
+
+int RB_setColorPoolBuildThreads(int numThreads) {
+	int previous = colorPoolBuildThreads;
+	colorPoolBuildThreads = (numThreads > 0)? numThreads : 0;
+	return previous;
+}
+
+RB_ColorPoolSearch* RB_createColorPoolSearch() {
+	RB_ColorPoolSearch* ret = (RB_ColorPoolSearch*) malloc(sizeof(RB_ColorPoolSearch));
+
+	if(ret == NULL) {
+		return NULL;
+	}
+
+	// The node queue can never need to be larger than the number of nodes in the pool, but in practice it only ever
+	// holds a tiny fraction of them, so it starts small and grows as needed.
+	ret->capacity = RB_COLOR_POOL_SEARCH_INITIAL_CAPACITY;
+	ret->nodeQueue = (ColorPoolNode*) malloc(sizeof(ColorPoolNode) * ret->capacity);
+
+	if(ret->nodeQueue == NULL) {
+		free(ret);
+		return NULL;
+	}
+
+	return ret;
+}
+
+void RB_freeColorPoolSearch(RB_ColorPoolSearch* search) {
+	if(search == NULL) {
+		return;
+	}
+
+	free(search->nodeQueue);
+	free(search);
+}
+
+// Makes sure the search's node queue has room for at least one more node than the specified size.
+bool reserveColorPoolSearchCapacity(RB_ColorPoolSearch* search, RB_Size size) {
+	if(size < search->capacity) {
+		return true;
+	}
+
+	RB_Size newCapacity = search->capacity * 2;
+	ColorPoolNode* newNodeQueue = (ColorPoolNode*) realloc(search->nodeQueue, sizeof(ColorPoolNode) * newCapacity);
+
+	if(newNodeQueue == NULL) {
+		fprintf(stderr, "Error: cannot grow the color pool search's node queue to %ld nodes!\n", (long) newCapacity);
+		return false;
+	}
+
+	search->nodeQueue = newNodeQueue;
+	search->capacity = newCapacity;
+	return true;
+}
+
+bool RB_findIdealAvailableColor(RB_ColorPool* colorPool, RB_Color desired, RB_Random* random, RB_Color* found) {
+#ifdef RB_ENABLE_TRACE
+	if(RB_shouldSampleTrace()) {
+		RB_TRACE_BEGIN(traceStart);
+		bool wasFound = RB_searchForIdealAvailableColor(colorPool, colorPool->search, desired, random, found);
+		RB_TRACE_END_WITH_ARG(traceStart, "findIdealAvailableColor", "nodesVisited", colorPool->search->nodesVisited);
+		return wasFound;
+	}
+#endif
+
+	return RB_searchForIdealAvailableColor(colorPool, colorPool->search, desired, random, found);
+}
+
+#ifdef RB_ENABLE_STATS
+void RB_getLastColorPoolSearchCounts(RB_ColorPool* colorPool, uint64_t* nodesVisited, uint64_t* passes) {
+	*nodesVisited = colorPool->search->nodesVisited;
+	*passes = colorPool->search->passes;
+}
+#endif
+
+/*
+Basic algorithm (figured out by me!):
+1) Add the root node to the "node queue." At the start, it will be the only node in the queue.
+2) Initialize minWorstCase to the worst case of the root node, I guess.
+3) Iterate through each node in the node queue.
+	3.1) If the node's best case is greater than minWorstCase, remove it from the queue.
+	3.2) If the node is an octant node, iterate through its children.
+		3.2.1) If the child's best case is greater than minWorstCase, do nothing.
+		3.2.2) If the child's best case is less than or equal to minWorstCase, add it to the node queue.
+		3.2.3) If the child's worst case is less than minWorstCase, set minWorstCase to the child's worst case value.
+	3.3) If the node is an octant node, remove it from the queue.
+4) If, during step 3, minWorstCase was updated or an octant was added to the queue, repeat step 3
+5) At this point, we know that the node queue only contains ideal colors. Choose one and return.
+*/
+bool RB_searchForIdealAvailableColor(
+	RB_ColorPool* colorPool,
+	RB_ColorPoolSearch* search,
+	RB_Color desired,
+	RB_Random* random,
+	RB_Color* found
+) {
+	ColorPoolNode* nodeQueue = search->nodeQueue;
+	RB_Size nodeQueueSize = 1;
+	RB_Size nodeQueueNextSize = 0;
+
+	if(colorPool->root.type == POOL_NODE_EMPTY) {
+		fprintf(stderr, "Error: attempting to find ideal available color in an empty color pool!\n");
+		return false;
+	}
+
+	nodeQueue[0] = colorPool->root;
+	RB_ColorSquareDistance minWorstCase = getBlindWorstDistance(colorPool->root, desired);
+	bool shouldIterateAgain = true;
+
+#if defined(RB_ENABLE_STATS) || defined(RB_ENABLE_TRACE)
+	search->nodesVisited = 1;
+	search->passes = 0;
+#endif
+
+	while(shouldIterateAgain) {
+		shouldIterateAgain = false;
+#if defined(RB_ENABLE_STATS) || defined(RB_ENABLE_TRACE)
+		search->passes++;
+#endif
+
+		for(RB_Size i = 0; i < nodeQueueSize; i++) {
+			ColorPoolNode node = nodeQueue[i];
+			RB_ColorSquareDistance nodeBestCase = getBlindClosestDistance(node, desired);
+
+			if(nodeBestCase <= minWorstCase) {
+				if(node.type == POOL_NODE_OCTANT) {
+					ColorPoolOctant* octantNode = node.octantNodePtr;
+					for(NodeChildrenSize j = 0; j < octantNode->numChildren; j++) {
+						ColorPoolNode child = octantNode->children[j];
+#if defined(RB_ENABLE_STATS) || defined(RB_ENABLE_TRACE)
+						search->nodesVisited++;
+#endif
+
+						RB_ColorSquareDistance childBestCase = getBlindClosestDistance(child, desired);
+						RB_ColorSquareDistance childWorstCase = getBlindWorstDistance(child, desired);
+
+						if(childBestCase <= minWorstCase) {
+							// add child to node queue
+
+							if(nodeQueueNextSize <= i) {
+								// If there's room at the start of the queue, add it there
+								// We're able to overwrite the node at position `i` because we already have its value saved
+								// in the node variable, and because it's an octant, it's going to be deleted anyway.
+
+								if(child.type == POOL_NODE_OCTANT) {
+									// Despite my algorithm saying that we should iterate again whenever we add
+									// an octant to the queue, the way we're handling adding nodes to the queue
 									// means that octants added to the end of the queue will be handled as though
 									// they were part of this iteration, so we don't need to iterate again for them.
 									// That's why we're only setting shouldIterateAgain to true when we're adding
@@ -584,6 +1540,10 @@ RB_Color RB_findIdealAvailableColor(RB_ColorPool* colorPool, RB_Color desired) {
 
 							} else {
 								// If there's no room at the start of the queue, add it to the end.
+								if(!reserveColorPoolSearchCapacity(search, nodeQueueSize)) {
+									return false;
+								}
+								nodeQueue = search->nodeQueue;
 								nodeQueue[nodeQueueSize] = child;
 								nodeQueueSize++;
 							}
@@ -609,37 +1569,51 @@ RB_Color RB_findIdealAvailableColor(RB_ColorPool* colorPool, RB_Color desired) {
 	}
 
 	// So, at this point, the node queue should only contain ideal colors. 
-	RB_Size colorNodeIndex = ((RB_Size) rand()) % nodeQueueSize;
+	RB_Size colorNodeIndex = (RB_Size) RB_getRandomBelow(random, nodeQueueSize);
 	ColorPoolNode nodeToReturn = nodeQueue[colorNodeIndex];
-	RB_Color ret = nodeToReturn.colorNodePtr->color;
+	*found = nodeToReturn.colorNodePtr->color;
 
-	return ret;
+	return true;
 }
 
-bool RB_colorIsAvailableInPool(RB_ColorPool* pool, RB_Color toFind) {
-	if(toFind.r >= pool->rSize || toFind.g >= pool->gSize || toFind.b >= pool->bSize) {
-		return false;
+// Returns the color's node, or NULL if the color is out of the pool's range. Only for pools that aren't palettes.
+ColorPoolColorNode* getColorNode(RB_ColorPool* pool, RB_Color color) {
+	if(color.r >= pool->rSize || color.g >= pool->gSize || color.b >= pool->bSize) {
+		return NULL;
 	}
-	RB_Size colorNodeIndex = getDataPosition(toFind.r, toFind.g, toFind.b, pool->gSize, pool->bSize);
 
-	return pool->colorNodes[colorNodeIndex].isAvailable;
+	return &(pool->colorNodes[getDataPosition(color.r, color.g, color.b, pool->gSize, pool->bSize)]);
+}
+
+// Returns the color's node, or NULL if the pool doesn't have the color at all.
+ColorPoolColorNode* findColorNode(RB_ColorPool* pool, RB_Color color) {
+	return pool->isPalette? getPaletteColorNode(pool, color) : getColorNode(pool, color);
+}
+
+RB_Size RB_getColorCountInPool(RB_ColorPool* pool, RB_Color toFind) {
+	ColorPoolColorNode* colorNode = findColorNode(pool, toFind);
+	return (colorNode == NULL)? 0 : colorNode->count;
+}
+
+bool RB_colorIsAvailableInPool(RB_ColorPool* pool, RB_Color toFind) {
+	return RB_getColorCountInPool(pool, toFind) > 0;
 }
 
 bool RB_removeColorFromPool(RB_ColorPool* pool, RB_Color toRemove) {
-	if(toRemove.r >= pool->rSize || toRemove.g >= pool->gSize || toRemove.b >= pool->bSize) {
+	ColorPoolColorNode* colorNode = findColorNode(pool, toRemove);
+
+	// If colorNode has already been used up, it can't be removed again.
+	if(colorNode == NULL || colorNode->count == 0) {
 		return false;
 	}
 
-	RB_Size colorNodeIndex = getDataPosition(toRemove.r, toRemove.g, toRemove.b, pool->gSize, pool->bSize);
-	ColorPoolColorNode* colorNode = &(pool->colorNodes[colorNodeIndex]);
+	colorNode->count--;
 
-	// If colorNode has already been removed, it can't be removed again. 
-	if(!colorNode->isAvailable) {
-		return false;
+	// Until its last use is taken, the color stays in the tree, so none of the octants' bounds change.
+	if(colorNode->count > 0) {
+		return true;
 	}
 
-	colorNode->isAvailable = false;
-
 	// If the colorNode has no parent, then it is presumably the root. Set the root to empty and return.
 	if(colorNode->parentData.octant == NULL) {
 		printf("Removing last color from the pool.\n");
@@ -647,11 +1621,15 @@ bool RB_removeColorFromPool(RB_ColorPool* pool, RB_Color toRemove) {
 		return true;
 	}
 
-	// Remove the colorNode from its parent
+	// Remove the colorNode from its parent. The children after it are shifted down, rather than the last one being moved
+	// into its place, so that they stay in the order the tree was built in. That keeps the tree (and so the order that
+	// searches find equally close colors in) the same as a tree rebuilt from the remaining colors.
 	ColorPoolOctant* octant = colorNode->parentData.octant;
 	octant->numChildren--;
-	octant->children[colorNode->parentData.index] = octant->children[octant->numChildren];
-	updateNodeParentData(octant->children[colorNode->parentData.index], octant, colorNode->parentData.index);
+	for(NodeChildrenSize i = colorNode->parentData.index; i < octant->numChildren; i++) {
+		octant->children[i] = octant->children[i + 1];
+		updateNodeParentData(octant->children[i], octant, i);
+	}
 
 	// if the parent now only has one node, replace it with its one node.
 	if(octant->numChildren == 1) {
@@ -686,6 +1664,630 @@ bool RB_removeColorFromPool(RB_ColorPool* pool, RB_Color toRemove) {
 	return true;
 }
 
+// Checks the invariants of the subtree under the node, whose parent data should match the specified parent and index.
+// Counts the colors in the subtree into numColors. Returns the number of broken invariants found.
+int checkColorPoolNodeInvariants(
+	ColorPoolNode node,
+	ColorPoolOctant* parent,
+	NodeChildrenSize index,
+	size_t* numColors
+) {
+	if(node.type == POOL_NODE_EMPTY) {
+		fprintf(stderr, "Color pool invariant broken: an empty node is in the tree!\n");
+		return 1;
+	}
+
+	int numBroken = 0;
+
+	if(node.type == POOL_NODE_COLOR) {
+		ColorPoolColorNode* colorNode = node.colorNodePtr;
+		RB_Color color = colorNode->color;
+		(*numColors)++;
+
+		if(colorNode->count <= 0) {
+			fprintf(stderr, "Color pool invariant broken: Color(%d, %d, %d) is in the tree, but used up!\n",
+				color.r, color.g, color.b
+			);
+			numBroken++;
+		}
+		if(colorNode->parentData.octant != parent || (parent != NULL && colorNode->parentData.index != index)) {
+			fprintf(stderr, "Color pool invariant broken: Color(%d, %d, %d) has the wrong parent data!\n",
+				color.r, color.g, color.b
+			);
+			numBroken++;
+		}
+		return numBroken;
+	}
+
+	ColorPoolOctant* octant = node.octantNodePtr;
+
+	if(octant->parentData.octant != parent || (parent != NULL && octant->parentData.index != index)) {
+		fprintf(stderr, "Color pool invariant broken: an octant has the wrong parent data!\n");
+		numBroken++;
+	}
+
+	// Octants with a single child are always replaced by that child, so every octant has at least two.
+	if(octant->numChildren < 2 || octant->numChildren > RB_COLOR_POOL_NODE_NUM_CHILDREN) {
+		fprintf(stderr, "Color pool invariant broken: an octant has %d children!\n", (int) octant->numChildren);
+		return numBroken + 1;
+	}
+
+	for(NodeChildrenSize i = 0; i < octant->numChildren; i++) {
+		numBroken += checkColorPoolNodeInvariants(octant->children[i], octant, i, numColors);
+	}
+
+	if(numBroken > 0) {
+		return numBroken;
+	}
+
+	// The bounds are always exactly those of the octant's children.
+	RB_Color minCorner = calculateOctantMinCorner(octant);
+	RB_Color maxCorner = calculateOctantMaxCorner(octant);
+	if(!RB_colorsAreEqual(minCorner, octant->minCorner) || !RB_colorsAreEqual(maxCorner, octant->maxCorner)) {
+		fprintf(
+			stderr,
+			"Color pool invariant broken: an octant's bounds are (%d, %d, %d) to (%d, %d, %d), "
+			"but its children's are (%d, %d, %d) to (%d, %d, %d)!\n",
+			octant->minCorner.r, octant->minCorner.g, octant->minCorner.b,
+			octant->maxCorner.r, octant->maxCorner.g, octant->maxCorner.b,
+			minCorner.r, minCorner.g, minCorner.b,
+			maxCorner.r, maxCorner.g, maxCorner.b
+		);
+		numBroken++;
+	}
+
+	return numBroken;
+}
+
+// Checks that a palette pool's colors are sorted, with every color only once.
+int checkPaletteInvariants(RB_ColorPool* pool) {
+	int numBroken = 0;
+
+	for(size_t i = 1; i < pool->numColors; i++) {
+		if(getColorMortonCode(pool->colorNodes[i - 1].color) >= getColorMortonCode(pool->colorNodes[i].color)) {
+			fprintf(stderr, "Color pool invariant broken: the palette isn't sorted at color %zu!\n", i);
+			numBroken++;
+		}
+	}
+
+	return numBroken;
+}
+
+bool RB_checkColorPoolInvariants(RB_ColorPool* pool) {
+	size_t numAvailable = 0;
+	int numBroken = pool->isPalette? checkPaletteInvariants(pool) : 0;
+
+	for(size_t i = 0; i < pool->numColors; i++) {
+		ColorPoolColorNode* colorNode = &(pool->colorNodes[i]);
+
+		if(colorNode->count > 0) {
+			numAvailable++;
+		}
+		if(colorNode->count < 0 || colorNode->count > getInitialColorCount(pool, i)) {
+			fprintf(
+				stderr,
+				"Color pool invariant broken: Color(%d, %d, %d) has %d uses left, but started out with %d!\n",
+				colorNode->color.r, colorNode->color.g, colorNode->color.b,
+				(int) colorNode->count, (int) getInitialColorCount(pool, i)
+			);
+			numBroken++;
+		}
+	}
+
+	size_t numInTree = 0;
+
+	if(pool->root.type != POOL_NODE_EMPTY) {
+		numBroken += checkColorPoolNodeInvariants(pool->root, NULL, 0, &numInTree);
+	}
+
+	if(numInTree != numAvailable) {
+		fprintf(
+			stderr,
+			"Color pool invariant broken: %zu colors are available, but %zu are in the tree!\n",
+			numAvailable, numInTree
+		);
+		numBroken++;
+	}
+
+	return numBroken == 0;
+}
+
+// CONCURRENT POOLS
+
+/*
+A concurrent pool shares its tree's layout with an ordinary pool, but it never restructures that tree after it is
+built, so readers can traverse it at any time without locks. Instead, availability and bounds live in side arrays:
+- Each color has an atomic availability flag. Claiming a color is a single compare-and-swap, so exactly one thread
+  wins each color.
+- Each octant has an atomic count of the available colors beneath it. Octants whose count has reached zero are
+  skipped entirely.
+- Each octant's bounds are packed into a single atomic value. Bounds are recalculated after claims, but a reader (or a
+  slower recalculation) may see older bounds. Colors are only ever removed, so older bounds are always at least as
+  large as the current ones. That is conservative: a search can only ever look at too much, never too little.
+*/
+struct RB_ConcurrentColorPool_s {
+	RB_ColorPool* tree;
+
+	atomic_bool* colorAvailability;
+	atomic_uint_fast32_t* octantCounts;
+	// The minimum corner is packed into the low 32 bits and the maximum corner into the high 32 bits.
+	_Atomic uint64_t* octantBounds;
+};
+
+uint64_t packOctantBounds(RB_Color minCorner, RB_Color maxCorner) {
+	uint64_t packedMin = ((uint64_t) minCorner.r << 16) | ((uint64_t) minCorner.g << 8) | minCorner.b;
+	uint64_t packedMax = ((uint64_t) maxCorner.r << 16) | ((uint64_t) maxCorner.g << 8) | maxCorner.b;
+	return packedMin | (packedMax << 32);
+}
+
+RB_Color unpackOctantCorner(uint64_t packedCorner) {
+	return (RB_Color) {
+		.r = (packedCorner >> 16) & 0xFF,
+		.g = (packedCorner >> 8) & 0xFF,
+		.b = packedCorner & 0xFF
+	};
+}
+
+RB_Size getConcurrentOctantIndex(RB_ConcurrentColorPool* pool, ColorPoolOctant* octant) {
+	return octant - pool->tree->octants;
+}
+
+RB_Size getConcurrentColorIndex(RB_ConcurrentColorPool* pool, ColorPoolColorNode* colorNode) {
+	return colorNode - pool->tree->colorNodes;
+}
+
+// Initializes the counts and bounds of the octant and its descendants, and returns the number of colors beneath it.
+uint_fast32_t initializeConcurrentNode(RB_ConcurrentColorPool* pool, ColorPoolNode node) {
+	switch(node.type) {
+		case POOL_NODE_COLOR:
+			atomic_init(&(pool->colorAvailability[getConcurrentColorIndex(pool, node.colorNodePtr)]), true);
+			return 1;
+		case POOL_NODE_OCTANT: {
+			ColorPoolOctant* octant = node.octantNodePtr;
+			RB_Size octantIndex = getConcurrentOctantIndex(pool, octant);
+			uint_fast32_t count = 0;
+
+			for(NodeChildrenSize i = 0; i < octant->numChildren; i++) {
+				count += initializeConcurrentNode(pool, octant->children[i]);
+			}
+
+			atomic_init(&(pool->octantCounts[octantIndex]), count);
+			atomic_init(&(pool->octantBounds[octantIndex]), packOctantBounds(octant->minCorner, octant->maxCorner));
+			return count;
+		}
+		default:
+			return 0;
+	}
+}
+
+RB_ConcurrentColorPool* RB_createConcurrentColorPool(
+	RB_ColorChannelSize rSize,
+	RB_ColorChannelSize gSize,
+	RB_ColorChannelSize bSize
+) {
+	RB_ConcurrentColorPool* ret = (RB_ConcurrentColorPool*) malloc(sizeof(RB_ConcurrentColorPool));
+
+	if(ret == NULL) {
+		return NULL;
+	}
+
+	ret->colorAvailability = NULL;
+	ret->octantCounts = NULL;
+	ret->octantBounds = NULL;
+
+	ret->tree = RB_createColorPool(rSize, gSize, bSize);
+	if(ret->tree == NULL) {
+		RB_freeConcurrentColorPool(ret);
+		return NULL;
+	}
+
+	size_t numColors = (size_t) rSize * gSize * bSize;
+	size_t maxOctants = calculateMaximumOctants(rSize, gSize, bSize);
+
+	ret->colorAvailability = (atomic_bool*) malloc(sizeof(atomic_bool) * numColors);
+	ret->octantCounts = (atomic_uint_fast32_t*) malloc(sizeof(atomic_uint_fast32_t) * maxOctants);
+	ret->octantBounds = (_Atomic uint64_t*) malloc(sizeof(_Atomic uint64_t) * maxOctants);
+
+	if(ret->colorAvailability == NULL || ret->octantCounts == NULL || ret->octantBounds == NULL) {
+		RB_freeConcurrentColorPool(ret);
+		return NULL;
+	}
+
+	initializeConcurrentNode(ret, ret->tree->root);
+
+	return ret;
+}
+
+void RB_freeConcurrentColorPool(RB_ConcurrentColorPool* pool) {
+	if(pool == NULL) {
+		return;
+	}
+
+	printf("Freeing RB_ConcurrentColorPool!\n");
+
+	RB_freeColorPool(pool->tree);
+	free(pool->colorAvailability);
+	free(pool->octantCounts);
+	free((void*) pool->octantBounds);
+	free(pool);
+}
+
+// Returns false for empty nodes, unavailable colors, and octants with no available colors beneath them.
+bool concurrentNodeHasColors(RB_ConcurrentColorPool* pool, ColorPoolNode node) {
+	switch(node.type) {
+		case POOL_NODE_COLOR:
+			return atomic_load_explicit(
+				&(pool->colorAvailability[getConcurrentColorIndex(pool, node.colorNodePtr)]),
+				memory_order_acquire
+			);
+		case POOL_NODE_OCTANT:
+			return atomic_load_explicit(
+				&(pool->octantCounts[getConcurrentOctantIndex(pool, node.octantNodePtr)]),
+				memory_order_acquire
+			) > 0;
+		default:
+			return false;
+	}
+}
+
+// Loads the node's current bounds. For colors, both corners are the color itself.
+void loadConcurrentNodeBounds(RB_ConcurrentColorPool* pool, ColorPoolNode node, RB_Color* minCorner, RB_Color* maxCorner) {
+	if(node.type == POOL_NODE_OCTANT) {
+		uint64_t bounds = atomic_load_explicit(
+			&(pool->octantBounds[getConcurrentOctantIndex(pool, node.octantNodePtr)]),
+			memory_order_acquire
+		);
+		*minCorner = unpackOctantCorner(bounds & 0xFFFFFFFF);
+		*maxCorner = unpackOctantCorner(bounds >> 32);
+	} else {
+		*minCorner = node.colorNodePtr->color;
+		*maxCorner = node.colorNodePtr->color;
+	}
+}
+
+// The same as getBlindClosestDistance and getBlindWorstDistance, except using the node's current bounds.
+void getConcurrentNodeDistances(
+	RB_ConcurrentColorPool* pool,
+	ColorPoolNode node,
+	RB_Color color,
+	RB_ColorSquareDistance* bestCase,
+	RB_ColorSquareDistance* worstCase
+) {
+	RB_Color minCorner;
+	RB_Color maxCorner;
+	loadConcurrentNodeBounds(pool, node, &minCorner, &maxCorner);
+
+	RB_Color closest = {
+		.r = getChannelValueWithinBoundaries(minCorner.r, maxCorner.r, color.r),
+		.g = getChannelValueWithinBoundaries(minCorner.g, maxCorner.g, color.g),
+		.b = getChannelValueWithinBoundaries(minCorner.b, maxCorner.b, color.b)
+	};
+	RB_Color furthest = {
+		.r = ((color.r * 2) - (minCorner.r + maxCorner.r)) > 0? minCorner.r : maxCorner.r,
+		.g = ((color.g * 2) - (minCorner.g + maxCorner.g)) > 0? minCorner.g : maxCorner.g,
+		.b = ((color.b * 2) - (minCorner.b + maxCorner.b)) > 0? minCorner.b : maxCorner.b
+	};
+
+	*bestCase = getSquareDistance(color, closest);
+	*worstCase = getSquareDistance(color, furthest);
+}
+
+bool RB_colorIsAvailableInConcurrentPool(RB_ConcurrentColorPool* pool, RB_Color toFind) {
+	// The availability array is laid out like the tree's color nodes.
+	ColorPoolColorNode* colorNode = getColorNode(pool->tree, toFind);
+	if(colorNode == NULL) {
+		return false;
+	}
+
+	RB_Size colorIndex = colorNode - pool->tree->colorNodes;
+	return atomic_load_explicit(&(pool->colorAvailability[colorIndex]), memory_order_acquire);
+}
+
+/*
+This is the same algorithm as RB_searchForIdealAvailableColor, except that nodes without available colors are
+skipped. Since other threads may be claiming colors at the same time, the returned color may already be gone by the
+time the caller tries to claim it, and if every candidate disappears mid-search, the search fails and returns false.
+Either way, the caller just searches again.
+*/
+bool searchConcurrentPool(
+	RB_ConcurrentColorPool* pool,
+	RB_ColorPoolSearch* search,
+	RB_Color desired,
+	RB_Random* random,
+	RB_Color* found
+) {
+	ColorPoolNode root = pool->tree->root;
+	if(!concurrentNodeHasColors(pool, root)) {
+		return false;
+	}
+
+	ColorPoolNode* nodeQueue = search->nodeQueue;
+	RB_Size nodeQueueSize = 1;
+	RB_Size nodeQueueNextSize = 0;
+
+	RB_ColorSquareDistance rootBestCase;
+	RB_ColorSquareDistance minWorstCase;
+	getConcurrentNodeDistances(pool, root, desired, &rootBestCase, &minWorstCase);
+	nodeQueue[0] = root;
+	bool shouldIterateAgain = true;
+
+	while(shouldIterateAgain) {
+		shouldIterateAgain = false;
+
+		for(RB_Size i = 0; i < nodeQueueSize; i++) {
+			ColorPoolNode node = nodeQueue[i];
+			RB_ColorSquareDistance nodeBestCase;
+			RB_ColorSquareDistance nodeWorstCase;
+			getConcurrentNodeDistances(pool, node, desired, &nodeBestCase, &nodeWorstCase);
+
+			if(nodeBestCase > minWorstCase) {
+				continue;
+			}
+
+			if(node.type != POOL_NODE_OCTANT) {
+				nodeQueue[nodeQueueNextSize] = node;
+				nodeQueueNextSize++;
+				continue;
+			}
+
+			ColorPoolOctant* octantNode = node.octantNodePtr;
+			for(NodeChildrenSize j = 0; j < octantNode->numChildren; j++) {
+				ColorPoolNode child = octantNode->children[j];
+
+				if(!concurrentNodeHasColors(pool, child)) {
+					continue;
+				}
+
+				RB_ColorSquareDistance childBestCase;
+				RB_ColorSquareDistance childWorstCase;
+				getConcurrentNodeDistances(pool, child, desired, &childBestCase, &childWorstCase);
+
+				if(childBestCase <= minWorstCase) {
+					if(nodeQueueNextSize <= i) {
+						if(child.type == POOL_NODE_OCTANT) {
+							shouldIterateAgain = true;
+						}
+						nodeQueue[nodeQueueNextSize] = child;
+						nodeQueueNextSize++;
+					} else {
+						if(!reserveColorPoolSearchCapacity(search, nodeQueueSize)) {
+							return false;
+						}
+						nodeQueue = search->nodeQueue;
+						nodeQueue[nodeQueueSize] = child;
+						nodeQueueSize++;
+					}
+				}
+				if(childWorstCase < minWorstCase) {
+					shouldIterateAgain = true;
+					minWorstCase = childWorstCase;
+				}
+			}
+		}
+
+		nodeQueueSize = nodeQueueNextSize;
+		nodeQueueNextSize = 0;
+	}
+
+	// Colors claimed since they were queued are dropped here, rather than being returned only to lose their claim.
+	RB_Size numCandidates = 0;
+	for(RB_Size i = 0; i < nodeQueueSize; i++) {
+		if(concurrentNodeHasColors(pool, nodeQueue[i])) {
+			nodeQueue[numCandidates] = nodeQueue[i];
+			numCandidates++;
+		}
+	}
+
+	if(numCandidates == 0) {
+		return false;
+	}
+
+	*found = nodeQueue[RB_getRandomBelow(random, numCandidates)].colorNodePtr->color;
+	return true;
+}
+
+// Recalculates the octant's bounds from its children's current bounds. If it has no available children, does nothing.
+void recalculateConcurrentOctantBounds(RB_ConcurrentColorPool* pool, ColorPoolOctant* octant) {
+	bool foundChild = false;
+	RB_Color minCorner;
+	RB_Color maxCorner;
+
+	for(NodeChildrenSize i = 0; i < octant->numChildren; i++) {
+		ColorPoolNode child = octant->children[i];
+		if(!concurrentNodeHasColors(pool, child)) {
+			continue;
+		}
+
+		RB_Color childMin;
+		RB_Color childMax;
+		loadConcurrentNodeBounds(pool, child, &childMin, &childMax);
+
+		if(!foundChild) {
+			minCorner = childMin;
+			maxCorner = childMax;
+			foundChild = true;
+			continue;
+		}
+
+		if(childMin.r < minCorner.r) minCorner.r = childMin.r;
+		if(childMin.g < minCorner.g) minCorner.g = childMin.g;
+		if(childMin.b < minCorner.b) minCorner.b = childMin.b;
+		if(childMax.r > maxCorner.r) maxCorner.r = childMax.r;
+		if(childMax.g > maxCorner.g) maxCorner.g = childMax.g;
+		if(childMax.b > maxCorner.b) maxCorner.b = childMax.b;
+	}
+
+	if(foundChild) {
+		atomic_store_explicit(
+			&(pool->octantBounds[getConcurrentOctantIndex(pool, octant)]),
+			packOctantBounds(minCorner, maxCorner),
+			memory_order_release
+		);
+	}
+}
+
+bool RB_claimColorFromConcurrentPool(RB_ConcurrentColorPool* pool, RB_Color toClaim) {
+	// The availability array is laid out like the tree's color nodes.
+	ColorPoolColorNode* colorNode = getColorNode(pool->tree, toClaim);
+	if(colorNode == NULL) {
+		return false;
+	}
+
+	RB_Size colorIndex = colorNode - pool->tree->colorNodes;
+	bool expected = true;
+
+	if(!atomic_compare_exchange_strong_explicit(
+		&(pool->colorAvailability[colorIndex]), &expected, false, memory_order_acq_rel, memory_order_acquire
+	)) {
+		// Somebody else got here first.
+		return false;
+	}
+
+	// The tree is never restructured, so the parent data set up when it was built is still accurate.
+	ColorPoolOctant* octant = colorNode->parentData.octant;
+
+	while(octant != NULL) {
+		atomic_fetch_sub_explicit(&(pool->octantCounts[getConcurrentOctantIndex(pool, octant)]), 1, memory_order_acq_rel);
+		recalculateConcurrentOctantBounds(pool, octant);
+		octant = octant->parentData.octant;
+	}
+
+	return true;
+}
+
+RB_Color RB_takeIdealAvailableColorFromConcurrentPool(
+	RB_ConcurrentColorPool* pool,
+	RB_ColorPoolSearch* search,
+	RB_Color desired,
+	RB_Random* random
+) {
+	RB_Color found;
+
+	// Every failed attempt means some other thread claimed a color, so this can only loop as many times as there are
+	// colors. Each retry also starts from a tree that has just had its counts and bounds tightened.
+	while(concurrentNodeHasColors(pool, pool->tree->root)) {
+		if(searchConcurrentPool(pool, search, desired, random, &found) && RB_claimColorFromConcurrentPool(pool, found)) {
+			return found;
+		}
+	}
+
+	fprintf(stderr, "Error: attempting to take an ideal available color from an empty concurrent color pool!\n");
+	return (RB_Color) {
+		.r = 0,
+		.g = 0,
+		.b = 0
+	};
+}
+
+bool colorIsWithinBounds(RB_Color color, RB_Color minCorner, RB_Color maxCorner) {
+	return color.r >= minCorner.r && color.r <= maxCorner.r
+		&& color.g >= minCorner.g && color.g <= maxCorner.g
+		&& color.b >= minCorner.b && color.b <= maxCorner.b;
+}
+
+/*
+Checks that the octant's count is the number of colors still available beneath it, and that its bounds (which may be
+looser than its children's, but never tighter) are within its parent's, and hold every color still available beneath
+it. Adds the number of those colors to numAvailable, and returns the number of broken invariants.
+*/
+int checkConcurrentNodeInvariants(
+	RB_ConcurrentColorPool* pool,
+	ColorPoolNode node,
+	RB_Color parentMin,
+	RB_Color parentMax,
+	uint_fast32_t* numAvailable
+) {
+	if(node.type == POOL_NODE_COLOR) {
+		RB_Color color = node.colorNodePtr->color;
+
+		if(!concurrentNodeHasColors(pool, node)) {
+			return 0;
+		}
+
+		(*numAvailable)++;
+		if(!colorIsWithinBounds(color, parentMin, parentMax)) {
+			fprintf(
+				stderr,
+				"Concurrent color pool invariant broken: Color(%d, %d, %d) is outside of its octant's bounds!\n",
+				color.r, color.g, color.b
+			);
+			return 1;
+		}
+		return 0;
+	}
+
+	if(node.type != POOL_NODE_OCTANT) {
+		return 0;
+	}
+
+	RB_Color minCorner;
+	RB_Color maxCorner;
+	loadConcurrentNodeBounds(pool, node, &minCorner, &maxCorner);
+
+	int numBroken = 0;
+	uint_fast32_t count = 0;
+	for(NodeChildrenSize i = 0; i < node.octantNodePtr->numChildren; i++) {
+		numBroken += checkConcurrentNodeInvariants(pool, node.octantNodePtr->children[i], minCorner, maxCorner, &count);
+	}
+
+	uint_fast32_t storedCount = atomic_load_explicit(
+		&(pool->octantCounts[getConcurrentOctantIndex(pool, node.octantNodePtr)]),
+		memory_order_acquire
+	);
+	if(storedCount != count) {
+		fprintf(
+			stderr,
+			"Concurrent color pool invariant broken: an octant's count is %lu, but %lu colors are available in it!\n",
+			(unsigned long) storedCount, (unsigned long) count
+		);
+		numBroken++;
+	}
+
+	// Once an octant is out of colors, its bounds are never updated again.
+	bool boundsAreWithinParent = colorIsWithinBounds(minCorner, parentMin, parentMax)
+		&& colorIsWithinBounds(maxCorner, parentMin, parentMax);
+	if(count > 0 && !boundsAreWithinParent) {
+		fprintf(stderr, "Concurrent color pool invariant broken: an octant's bounds are outside of its parent's!\n");
+		numBroken++;
+	}
+
+	*numAvailable += count;
+	return numBroken;
+}
+
+bool RB_checkConcurrentColorPoolInvariants(RB_ConcurrentColorPool* pool) {
+	// Claims never touch the tree itself, only the counts, bounds and availability alongside it.
+	int numBroken = RB_checkColorPoolInvariants(pool->tree)? 0 : 1;
+
+	RB_Color cubeMin = {
+		.r = 0,
+		.g = 0,
+		.b = 0
+	};
+	RB_Color cubeMax = {
+		.r = RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION - 1,
+		.g = RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION - 1,
+		.b = RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION - 1
+	};
+	uint_fast32_t numAvailable = 0;
+	numBroken += checkConcurrentNodeInvariants(pool, pool->tree->root, cubeMin, cubeMax, &numAvailable);
+
+	uint_fast32_t numMarkedAvailable = 0;
+	for(size_t i = 0; i < pool->tree->numColors; i++) {
+		numMarkedAvailable += atomic_load_explicit(&(pool->colorAvailability[i]), memory_order_acquire);
+	}
+	if(numMarkedAvailable != numAvailable) {
+		fprintf(
+			stderr,
+			"Concurrent color pool invariant broken: %lu colors are available, but %lu are reachable from the root!\n",
+			(unsigned long) numMarkedAvailable, (unsigned long) numAvailable
+		);
+		numBroken++;
+	}
+
+	return numBroken == 0;
+}
+
 void printNode(FILE* stream, ColorPoolNode node) {
 	switch(node.type) {
 		case POOL_NODE_EMPTY:
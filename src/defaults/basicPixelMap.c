@@ -1,51 +1,342 @@
 #include "headers/RB_PixelMap.h"
 #include "headers/RB_AssignmentQueue.h"
+#include "headers/RB_Arena.h"
+#include "headers/RB_FixedConfig.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 struct RB_PixelMap_s {
+	// For flat layouts, a pointer to the start of each column.
+	// For tiled layouts, a pointer to each tile (column of tiles by column of tiles), or NULL if it isn't allocated yet.
 	RB_Pixel** pixels;
 	RB_Size width;
 	RB_Size height;
+
+	RB_MapLayout layout;
+	RB_Size tilesPerColumn;
+	// True if the map's dimensions are the fixed config's (see RB_FixedConfig.h).
+	bool hasFixedDimensions;
+
+	RB_Topology topology;
+	// For every coordinate in the ring just outside of the map, the in-map coordinate it is mapped to.
+	// Only the pixels on the edges of the map ever read this, so interior pixels never pay for the topology.
+	RB_Coord* borderRemap;
+
+	// Where the map and its tiles are allocated from, or NULL if they are allocated with calloc.
+	RB_Arena* arena;
 };
 
-// allocates a pixel map with the specified dimensions
-RB_PixelMap* RB_createPixelMap(RB_Size width, RB_Size height) {
-	RB_PixelMap* ret = (RB_PixelMap*) malloc(
-		sizeof(RB_PixelMap)
-		+ (sizeof(RB_Pixel*) * width)
-		+ (sizeof(RB_Pixel) * width * height)
+// The size of the allocation that holds the map itself, along with every pixel of a flat map.
+size_t getPixelMapAllocationSize(RB_Size width, RB_Size height, RB_MapLayout layout) {
+	RB_Size numPointers = (layout == RB_MAP_LAYOUT_TILED)? RB_getNumTiles(width) * RB_getNumTiles(height) : width;
+	// Tiled layouts allocate their pixels lazily, one tile at a time.
+	RB_Size numPixels = (layout == RB_MAP_LAYOUT_TILED)? 0 : width * height;
+
+	return sizeof(RB_PixelMap) + (sizeof(RB_Pixel*) * numPointers) + (sizeof(RB_Pixel) * numPixels);
+}
+
+size_t RB_getPixelMapArenaBudget(RB_Size width, RB_Size height, RB_MapLayout layout) {
+	size_t ret = RB_getArenaAllocationSize(getPixelMapAllocationSize(width, height, layout));
+
+	if(layout == RB_MAP_LAYOUT_TILED) {
+		size_t numTiles = (size_t) RB_getNumTiles(width) * RB_getNumTiles(height);
+		ret += numTiles * RB_getArenaAllocationSize(sizeof(RB_Pixel) * RB_MAP_TILE_AREA);
+	}
+
+	return ret;
+}
+
+// Allocates a pixel map. Every pixel starts out blank, because blank pixels are all zeroes, and the memory is zeroed.
+// Tiled maps start with no tiles.
+RB_PixelMap* allocatePixelMap(RB_Arena* arena, RB_Size width, RB_Size height, RB_MapLayout layout) {
+	RB_PixelMap* ret = (RB_PixelMap*) RB_allocateZeroed(
+		arena,
+		RB_ARENA_PIXEL_MAP,
+		getPixelMapAllocationSize(width, height, layout)
 	);
 
 	if(ret == NULL) {
 		return NULL;
 	}
 
+	ret->arena = arena;
 	ret->width = width;
 	ret->height = height;
+	ret->layout = layout;
+	ret->tilesPerColumn = RB_getNumTiles(height);
+	ret->hasFixedDimensions = RB_isFixedMapDimensions(width, height);
+	ret->topology = RB_TOPOLOGY_RECTANGLE;
+	ret->borderRemap = NULL;
 
 	ret->pixels = (RB_Pixel**) (ret + 1);
-	RB_Pixel* pixelData = (RB_Pixel*) (ret->pixels + width);
 
-	for(int x = 0; x < width; x++) {
-		ret->pixels[x] = pixelData + (x * height);
+	// Tiled maps' tile pointers are already NULL.
+	if(layout == RB_MAP_LAYOUT_FLAT) {
+		RB_Pixel* pixelData = (RB_Pixel*) (ret->pixels + width);
 
-		for(int y = 0; y < height; y++) {
-			ret->pixels[x][y] = (RB_Pixel) {
-				.loc = { .x = x, .y = y },
-				.color = { .r = 0, .g = 0, .b = 0 },
-				.status = RB_PIXEL_BLANK
-			};
+		for(RB_Size x = 0; x < width; x++) {
+			ret->pixels[x] = pixelData + (x * height);
 		}
 	}
 
+	if(!RB_setPixelMapTopology(ret, RB_TOPOLOGY_RECTANGLE, NULL)) {
+		RB_freePixelMap(ret);
+		return NULL;
+	}
+
 	return ret;
 }
 
+// allocates a pixel map with the specified dimensions and memory layout
+RB_PixelMap* RB_createPixelMap(RB_Size width, RB_Size height, RB_MapLayout layout) {
+	return allocatePixelMap(NULL, width, height, layout);
+}
+
+RB_PixelMap* RB_createPixelMapInArena(RB_Arena* arena, RB_Size width, RB_Size height, RB_MapLayout layout) {
+	return allocatePixelMap(arena, width, height, layout);
+}
+
+RB_Pixel* allocatePixelMapTile(RB_PixelMap* map, RB_Size tileX, RB_Size tileY) {
+	// Like the rest of the map, the tile's pixels start out blank.
+	RB_Pixel* tile = (RB_Pixel*) RB_allocateZeroed(map->arena, RB_ARENA_PIXEL_MAP, sizeof(RB_Pixel) * RB_MAP_TILE_AREA);
+
+	if(tile == NULL) {
+		fprintf(stderr, "Error allocating pixel map tile (%d, %d)!\n", tileX, tileY);
+		return NULL;
+	}
+
+	map->pixels[(tileX * map->tilesPerColumn) + tileY] = tile;
+	return tile;
+}
+
+void RB_clearPixelMap(RB_PixelMap* map) {
+	// Blank pixels are all zeroes.
+	if(map->layout == RB_MAP_LAYOUT_FLAT) {
+		memset(map->pixels[0], 0, sizeof(RB_Pixel) * map->width * map->height);
+		return;
+	}
+
+	// Tiles are kept rather than freed, so that generating again doesn't have to allocate them again.
+	RB_Size numTiles = RB_getNumTiles(map->width) * map->tilesPerColumn;
+	for(RB_Size i = 0; i < numTiles; i++) {
+		if(map->pixels[i] != NULL) {
+			memset(map->pixels[i], 0, sizeof(RB_Pixel) * RB_MAP_TILE_AREA);
+		}
+	}
+}
+
+bool RB_copyPixelMap(RB_PixelMap* dest, const RB_PixelMap* src) {
+	if(dest->width != src->width || dest->height != src->height || dest->layout != src->layout) {
+		fprintf(stderr, "Error copying pixel map: the maps have different dimensions or layouts!\n");
+		return false;
+	}
+
+	if(src->layout == RB_MAP_LAYOUT_FLAT) {
+		memcpy(dest->pixels[0], src->pixels[0], sizeof(RB_Pixel) * src->width * src->height);
+	} else {
+		// Tiles the destination already has are reused rather than freed, so copying never gives memory back.
+		for(RB_Size tileX = 0; tileX < RB_getNumTiles(src->width); tileX++) {
+			for(RB_Size tileY = 0; tileY < src->tilesPerColumn; tileY++) {
+				RB_Size tileIndex = (tileX * src->tilesPerColumn) + tileY;
+				RB_Pixel* srcTile = src->pixels[tileIndex];
+				RB_Pixel* destTile = dest->pixels[tileIndex];
+
+				if(srcTile == NULL) {
+					if(destTile != NULL) {
+						memset(destTile, 0, sizeof(RB_Pixel) * RB_MAP_TILE_AREA);
+					}
+					continue;
+				}
+
+				if(destTile == NULL) {
+					destTile = allocatePixelMapTile(dest, tileX, tileY);
+					if(destTile == NULL) {
+						return false;
+					}
+				}
+
+				memcpy(destTile, srcTile, sizeof(RB_Pixel) * RB_MAP_TILE_AREA);
+			}
+		}
+	}
+
+	memcpy(dest->borderRemap, src->borderRemap, sizeof(RB_Coord) * RB_getTopologyRemapLength(src->width, src->height));
+	dest->topology = src->topology;
+
+	return true;
+}
+
+RB_PixelMap* RB_clonePixelMap(const RB_PixelMap* src) {
+	RB_PixelMap* ret = allocatePixelMap(NULL, src->width, src->height, src->layout);
+
+	if(ret == NULL) {
+		return NULL;
+	}
+
+	if(!RB_copyPixelMap(ret, src)) {
+		RB_freePixelMap(ret);
+		return NULL;
+	}
+
+	return ret;
+}
+
+// Returns the column of a flat map. The map's height is passed in (like the sizes of the other RB_SPECIALIZED
+// functions) so that it is a constant when the map has the fixed config's dimensions.
+RB_SPECIALIZED RB_Pixel* getFlatColumn(RB_PixelMap* map, RB_Size height, RB_Size x) {
+	return map->pixels[0] + (x * height);
+}
+
+// Returns the pixel at an in-bounds coordinate. For tiled maps, if the pixel's tile doesn't exist yet, either allocates
+// it or (if allocate is false) returns NULL, since every pixel in it is blank. Lookups that don't allocate never modify
+// the map, so they are safe to make from several threads at once.
+RB_SPECIALIZED RB_Pixel* locateSizedPixel(RB_PixelMap* map, RB_Size height, RB_Size x, RB_Size y, bool allocate) {
+	if(map->layout == RB_MAP_LAYOUT_FLAT) {
+		return getFlatColumn(map, height, x) + y;
+	}
+
+	RB_Size tileX = x >> RB_MAP_TILE_SHIFT;
+	RB_Size tileY = y >> RB_MAP_TILE_SHIFT;
+	RB_Pixel* tile = map->pixels[(tileX * RB_getNumTiles(height)) + tileY];
+
+	if(tile == NULL) {
+		if(!allocate) {
+			return NULL;
+		}
+
+		tile = allocatePixelMapTile(map, tileX, tileY);
+		if(tile == NULL) {
+			return NULL;
+		}
+	}
+
+	return tile + RB_getTileOffset(x, y);
+}
+
+RB_Pixel* locatePixel(RB_PixelMap* map, RB_Size x, RB_Size y, bool allocate) {
+	return locateSizedPixel(map, map->height, x, y, allocate);
+}
+
+RB_Size RB_getTopologyRemapLength(RB_Size width, RB_Size height) {
+	return (2 * (width + 2)) + (2 * height);
+}
+
+RB_Size RB_getTopologyRemapIndex(RB_Size width, RB_Size height, RB_Coord coord) {
+	if(coord.x < -1 || coord.x > width || coord.y < -1 || coord.y > height) {
+		return -1;
+	}
+
+	// The top row, then the bottom row, then the left column, then the right column.
+	if(coord.y == -1) {
+		return coord.x + 1;
+	}
+	if(coord.y == height) {
+		return (width + 2) + coord.x + 1;
+	}
+	if(coord.x == -1) {
+		return (2 * (width + 2)) + coord.y;
+	}
+	if(coord.x == width) {
+		return (2 * (width + 2)) + height + coord.y;
+	}
+
+	// The coord is inside of the map.
+	return -1;
+}
+
+RB_Size wrapTopologyComponent(RB_Size component, RB_Size range) {
+	if(component < 0) {
+		return component + range;
+	}
+	if(component >= range) {
+		return component - range;
+	}
+	return component;
+}
+
+// Determines where a coordinate just outside of the map ends up under one of the built-in topologies.
+RB_Coord getBuiltInTopologyCoord(RB_Topology topology, RB_Size width, RB_Size height, RB_Coord outside) {
+	switch(topology) {
+		case RB_TOPOLOGY_TORUS:
+			return (RB_Coord) {
+				.x = wrapTopologyComponent(outside.x, width),
+				.y = wrapTopologyComponent(outside.y, height)
+			};
+		case RB_TOPOLOGY_KLEIN_BOTTLE: {
+			RB_Coord ret = outside;
+			if(ret.x < 0 || ret.x >= width) {
+				ret.x = wrapTopologyComponent(ret.x, width);
+				ret.y = (height - 1) - ret.y;
+			}
+			ret.y = wrapTopologyComponent(ret.y, height);
+			return ret;
+		}
+		default:
+			return (RB_Coord) { .x = -1, .y = -1 };
+	}
+}
+
+bool RB_setPixelMapTopology(RB_PixelMap* map, RB_Topology topology, const RB_Coord* remapTable) {
+	if(topology == RB_TOPOLOGY_CUSTOM && remapTable == NULL) {
+		fprintf(stderr, "Error setting pixel map topology: custom topologies require a remap table!\n");
+		return false;
+	}
+
+	RB_Size remapLength = RB_getTopologyRemapLength(map->width, map->height);
+
+	if(map->borderRemap == NULL) {
+		map->borderRemap = (RB_Coord*) malloc(sizeof(RB_Coord) * remapLength);
+
+		if(map->borderRemap == NULL) {
+			fprintf(stderr, "Error setting pixel map topology: cannot allocate remap table!\n");
+			return false;
+		}
+	}
+
+	for(RB_Size i = 0; i < remapLength; i++) {
+		RB_Coord mapped;
+		if(topology == RB_TOPOLOGY_CUSTOM) {
+			mapped = remapTable[i];
+			if(mapped.x < 0 || mapped.x >= map->width || mapped.y < 0 || mapped.y >= map->height) {
+				mapped = (RB_Coord) { .x = -1, .y = -1 };
+			}
+		} else {
+			// Recovering the outside coordinate from its index lets the built-in topologies share the custom layout.
+			RB_Coord outside;
+			if(i < map->width + 2) {
+				outside = (RB_Coord) { .x = i - 1, .y = -1 };
+			} else if(i < 2 * (map->width + 2)) {
+				outside = (RB_Coord) { .x = i - (map->width + 2) - 1, .y = map->height };
+			} else if(i < (2 * (map->width + 2)) + map->height) {
+				outside = (RB_Coord) { .x = -1, .y = i - (2 * (map->width + 2)) };
+			} else {
+				outside = (RB_Coord) { .x = map->width, .y = i - (2 * (map->width + 2)) - map->height };
+			}
+			mapped = getBuiltInTopologyCoord(topology, map->width, map->height, outside);
+		}
+		map->borderRemap[i] = mapped;
+	}
+
+	map->topology = topology;
+	return true;
+}
+
 // deallocates the pixel map
 void RB_freePixelMap(RB_PixelMap* map) {
+	if(map == NULL) {
+		return;
+	}
+
 	printf("Freeing RB_PixelMap!\n");
-	free(map);
+	if(map->layout == RB_MAP_LAYOUT_TILED) {
+		RB_Size numTiles = RB_getNumTiles(map->width) * map->tilesPerColumn;
+		for(RB_Size i = 0; i < numTiles; i++) {
+			RB_freeZeroed(map->arena, map->pixels[i]);
+		}
+	}
+	free(map->borderRemap);
+	RB_freeZeroed(map->arena, map);
 }
 
 // returns the pixel that the coord maps to, or NULL if the coord does not map to a pixel.
@@ -54,16 +345,81 @@ RB_Pixel* RB_getPixel(RB_PixelMap* map, RB_Coord coord) {
 		return NULL;
 	}
 
-	return &(map->pixels[coord.x][coord.y]);
+	return locatePixel(map, coord.x, coord.y, true);
 }
 
-// Determines, based on the current state of the pixelMap, the preferred color for the specified coordinate.
-RB_Color RB_determinePreferredCoordColor(RB_PixelMap* pixelMap, RB_Coord coord) {
-	RB_Size minX = ((coord.x - 1) < 0)? 0 : coord.x - 1;
-	RB_Size maxX = ((coord.x + 1) >= pixelMap->width)? pixelMap->width - 1 : coord.x + 1;
-	RB_Size minY = ((coord.y - 1) < 0)? 0 : coord.y - 1;
-	RB_Size maxY = ((coord.y + 1) >= pixelMap->height)? pixelMap->height - 1 : coord.y + 1;
+void RB_readPixelMapColumn(RB_PixelMap* map, RB_Size x, RB_Size y, RB_Size length, RB_Color* colors) {
+	if(map->layout == RB_MAP_LAYOUT_FLAT) {
+		RB_Pixel* column = map->pixels[x] + y;
+		for(RB_Size i = 0; i < length; i++) {
+			colors[i] = column[i].color;
+		}
+		return;
+	}
+
+	for(RB_Size i = 0; i < length; i++) {
+		RB_Pixel* pixel = locatePixel(map, x, y + i, false);
+		colors[i] = (pixel == NULL)? (RB_Color) { .r = 0, .g = 0, .b = 0 } : pixel->color;
+	}
+}
 
+void RB_readPixelMapColumnStatuses(RB_PixelMap* map, RB_Size x, RB_Size y, RB_Size length, RB_PixelStatus* statuses) {
+	if(map->layout == RB_MAP_LAYOUT_FLAT) {
+		RB_Pixel* column = map->pixels[x] + y;
+		for(RB_Size i = 0; i < length; i++) {
+			statuses[i] = column[i].status;
+		}
+		return;
+	}
+
+	for(RB_Size i = 0; i < length; i++) {
+		RB_Pixel* pixel = locatePixel(map, x, y + i, false);
+		statuses[i] = (pixel == NULL)? RB_PIXEL_BLANK : pixel->status;
+	}
+}
+
+const RB_Coord* RB_getPixelMapTopologyRemap(RB_PixelMap* map) {
+	return map->borderRemap;
+}
+
+RB_SPECIALIZED bool coordIsInMapInterior(RB_Size width, RB_Size height, RB_Coord coord) {
+	return coord.x > 0 && coord.x < width - 1 && coord.y > 0 && coord.y < height - 1;
+}
+
+// Returns the in-map coordinate that a coordinate within one pixel of the map is considered to be, according to the
+// map's topology. If there is no such coordinate, the returned coordinate's x is negative.
+RB_SPECIALIZED RB_Coord getTopologicalCoord(RB_PixelMap* map, RB_Size width, RB_Size height, RB_Size x, RB_Size y) {
+	if(x >= 0 && x < width && y >= 0 && y < height) {
+		return (RB_Coord) { .x = x, .y = y };
+	}
+
+	return map->borderRemap[RB_getTopologyRemapIndex(width, height, (RB_Coord) { .x = x, .y = y })];
+}
+
+// Returns the pixel that a coordinate within one pixel of the map is considered to be, according to the map's
+// topology, or NULL if there is no such pixel. Only pixels on the edges of the map need to call this.
+RB_SPECIALIZED RB_Pixel* getTopologicalPixel(
+	RB_PixelMap* map,
+	RB_Size width,
+	RB_Size height,
+	RB_Size x,
+	RB_Size y,
+	bool allocate
+) {
+	RB_Coord mapped = getTopologicalCoord(map, width, height, x, y);
+	if(mapped.x < 0) {
+		return NULL;
+	}
+
+	return locateSizedPixel(map, height, mapped.x, mapped.y, allocate);
+}
+
+RB_SPECIALIZED RB_Color determinePreferredCoordColor(
+	RB_PixelMap* pixelMap,
+	RB_Size width,
+	RB_Size height,
+	RB_Coord coord
+) {
 	// A ColorChannelSum is garanteed to be able to hold the sum of up to 256 colorChannel values
 	// Because we're adding half of numNeighbors, this will have a lower capacity.
 	// That doesn't matter here, though.
@@ -73,30 +429,48 @@ RB_Color RB_determinePreferredCoordColor(RB_PixelMap* pixelMap, RB_Coord coord)
 
 	uint_fast8_t numNeighbors = 0;
 
-	for(RB_Size x = minX; x <= maxX; x++) {
-		for(RB_Size y = minY; y <= maxY; y++) {
-			RB_Coord newCoord = { .x = x, .y = y };
+	// Interior pixels (by far the most common case) read their neighbors directly. Only pixels on the edges of the
+	// map need to go through the topology.
+	bool isInterior = coordIsInMapInterior(width, height, coord);
 
-			RB_Pixel* neighborPixel = RB_getPixel(pixelMap, newCoord);
+	if(isInterior && pixelMap->layout == RB_MAP_LAYOUT_FLAT) {
+		for(RB_Size x = coord.x - 1; x <= coord.x + 1; x++) {
+			RB_Pixel* column = getFlatColumn(pixelMap, height, x);
+			for(RB_Size y = coord.y - 1; y <= coord.y + 1; y++) {
+				RB_Pixel* neighborPixel = &(column[y]);
 
-			if(neighborPixel == NULL) {
-				fprintf(stderr,
-					"Somehow, determinePreferredCoordColor has encountered a NULL pixel"
-					"even though that shouldn't be possible?\nThe pixel is at %d %d.\n",
-					x, y
-				);
-				continue;
+				if(neighborPixel->status != RB_PIXEL_SET) continue;
+
+				numNeighbors++;
+				rSum += neighborPixel->color.r;
+				gSum += neighborPixel->color.g;
+				bSum += neighborPixel->color.b;
 			}
+		}
+	} else {
+		for(RB_Size x = coord.x - 1; x <= coord.x + 1; x++) {
+			for(RB_Size y = coord.y - 1; y <= coord.y + 1; y++) {
+				// Unallocated tiles only contain blank pixels, so there's no need to allocate them here.
+				RB_Pixel* neighborPixel = isInterior?
+					locateSizedPixel(pixelMap, height, x, y, false)
+					: getTopologicalPixel(pixelMap, width, height, x, y, false);
 
-			if(neighborPixel->status != RB_PIXEL_SET) continue;
+				if(neighborPixel == NULL) continue;
+				if(neighborPixel->status != RB_PIXEL_SET) continue;
 
-			numNeighbors++;
-			rSum += neighborPixel->color.r;
-			gSum += neighborPixel->color.g;
-			bSum += neighborPixel->color.b;
+				numNeighbors++;
+				rSum += neighborPixel->color.r;
+				gSum += neighborPixel->color.g;
+				bSum += neighborPixel->color.b;
+			}
 		}
 	}
 
+	// A custom topology doesn't have to be symmetric, so a queued coord might not see the pixel that queued it.
+	if(numNeighbors == 0) {
+		return (RB_Color) { .r = 0, .g = 0, .b = 0 };
+	}
+
 	uint_fast8_t halfNumNeighbors = numNeighbors / 2;
 	// By adding half of numNeighbors, hopefully the sums will round instead of floor.
 	RB_ColorChannelSum retR = (rSum + halfNumNeighbors) / numNeighbors;
@@ -110,18 +484,64 @@ RB_Color RB_determinePreferredCoordColor(RB_PixelMap* pixelMap, RB_Coord coord)
 	};
 }
 
-// Add cords to the queue in an implementation-defined pattern relative to the given coord
-void RB_addResultantCoordsToQueue(RB_PixelMap* map, RB_AssignmentQueue* queue, RB_Coord center) {
+// Determines, based on the current state of the pixelMap, the preferred color for the specified coordinate.
+RB_Color RB_determinePreferredCoordColor(RB_PixelMap* pixelMap, RB_Coord coord) {
+#ifdef RB_FIXED_CONFIG
+	if(pixelMap->hasFixedDimensions) {
+		return determinePreferredCoordColor(pixelMap, RB_FIXED_WIDTH, RB_FIXED_HEIGHT, coord);
+	}
+#endif
+	return determinePreferredCoordColor(pixelMap, pixelMap->width, pixelMap->height, coord);
+}
+
+RB_SPECIALIZED void addResultantCoordsToQueue(
+	RB_PixelMap* map,
+	RB_AssignmentQueue* queue,
+	RB_Size width,
+	RB_Size height,
+	RB_Coord center
+) {
+	bool isInterior = coordIsInMapInterior(width, height, center);
+
+	if(isInterior && map->layout == RB_MAP_LAYOUT_FLAT) {
+		for(RB_Size x = center.x - 1; x <= center.x + 1; x++) {
+			RB_Pixel* column = getFlatColumn(map, height, x);
+			for(RB_Size y = center.y - 1; y <= center.y + 1; y++) {
+				// The center pixel has just been set, so it is skipped along with every other non-blank pixel.
+				if(column[y].status != RB_PIXEL_BLANK) continue;
+
+				RB_addCoordToAssignmentQueue(queue, (RB_Coord) { .x = x, .y = y }, -1);
+			}
+		}
+		return;
+	}
+
 	for(RB_Size dx = -1; dx <= 1; dx++) {
 		for(RB_Size dy = -1; dy <= 1; dy++) {
 			if(dx == 0 && dy == 0) continue;
 
+			// Pixels don't know where they are, so the coord is worked out first.
+			RB_Coord toAddCoord = isInterior?
+				(RB_Coord) { .x = center.x + dx, .y = center.y + dy }
+				: getTopologicalCoord(map, width, height, center.x + dx, center.y + dy);
+			if(toAddCoord.x < 0) continue;
 
-			RB_Pixel* toAdd = RB_getPixel(map, (RB_Coord) { .x = center.x + dx, .y = center.y + dy });
+			RB_Pixel* toAdd = locateSizedPixel(map, height, toAddCoord.x, toAddCoord.y, true);
 			if(toAdd == NULL) continue;
 			if(toAdd->status != RB_PIXEL_BLANK) continue;
 
-			RB_addCoordToAssignmentQueue(queue, toAdd->loc, -1);
+			RB_addCoordToAssignmentQueue(queue, toAddCoord, -1);
 		}
 	}
-}
\ No newline at end of file
+}
+
+// Add cords to the queue in an implementation-defined pattern relative to the given coord
+void RB_addResultantCoordsToQueue(RB_PixelMap* map, RB_AssignmentQueue* queue, RB_Coord center) {
+#ifdef RB_FIXED_CONFIG
+	if(map->hasFixedDimensions) {
+		addResultantCoordsToQueue(map, queue, RB_FIXED_WIDTH, RB_FIXED_HEIGHT, center);
+		return;
+	}
+#endif
+	addResultantCoordsToQueue(map, queue, map->width, map->height, center);
+}
@@ -9,4 +9,12 @@ bool RB_colorsAreEqual(RB_Color color0, RB_Color color1) {
 // Returns true if the two coords are equal. Otherwise returns false.
 bool RB_coordsAreEqual(RB_Coord coord0, RB_Coord coord1) {
 	return coord0.x == coord1.x && coord0.y == coord1.y;
+}
+
+// Fills the lookup table with every value of a channel with the specified resolution, rescaled to 8 bits.
+void RB_buildChannelLookup(uint8_t* lookup, RB_ColorChannelSize resolution) {
+	// Using this type because it is guaranteed to be twice as many bits long as a color channel is;
+	for(RB_ColorChannelSize i = 0; i < resolution; i++) {
+		lookup[i] = (uint8_t) (((RB_ColorSquareDistance) i * RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION) / resolution);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,327 @@
+#include "headers/RB_Batch.h"
+#include "headers/RB_AssignmentQueue.h"
+#include "headers/RB_ColorPool.h"
+#include "headers/RB_PixelMap.h"
+#include "headers/RB_Random.h"
+#include "headers/RB_Clock.h"
+#include "headers/RB_Trace.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+typedef struct {
+	// The resolved config of the first job with this geometry. Its seed is meaningless.
+	RB_Config config;
+	// Pristine, and never modified once the workers have started.
+	RB_ColorPool* colorPool;
+	RB_PixelMap* pixelMap;
+} BatchTemplate;
+
+typedef struct {
+	const RB_BatchJob* jobs;
+	int numJobs;
+	// The resolved config and template of each job.
+	RB_Config* jobConfigs;
+	int* jobTemplates;
+	BatchTemplate* templates;
+
+	RB_BatchCallback callback;
+	void* userData;
+
+	atomic_int nextJob;
+	atomic_int numFinished;
+	atomic_ullong numPixels;
+	atomic_bool failed;
+} BatchState;
+
+typedef struct {
+	BatchState* state;
+	pthread_t thread;
+	bool threadStarted;
+} BatchWorker;
+
+bool haveSameGeometry(const RB_Config* a, const RB_Config* b) {
+	return a->rRes == b->rRes && a->gRes == b->gRes && a->bRes == b->bRes
+		&& a->width == b->width && a->height == b->height
+		&& a->mapLayout == b->mapLayout
+		&& a->topology == b->topology && a->topologyRemap == b->topologyRemap
+		&& a->paletteSet == b->paletteSet && a->palette == b->palette && a->paletteLength == b->paletteLength
+		&& a->repeatColors == b->repeatColors;
+}
+
+void freeBatchData(RB_Data* data) {
+	RB_freeAssignmentQueue(data->assignmentQueue);
+	RB_freeColorPool(data->colorPool);
+	RB_freePixelMap(data->pixelMap);
+	data->assignmentQueue = NULL;
+	data->colorPool = NULL;
+	data->pixelMap = NULL;
+}
+
+// Allocates the worker's queue, pool and map for the template's geometry.
+bool allocateBatchData(RB_Data* data, const BatchTemplate* template) {
+	const RB_Config* config = &(template->config);
+
+	data->assignmentQueue = RB_createAssignmentQueue(
+		config->width * config->height,
+		config->width,
+		config->height,
+		config->mapLayout
+	);
+	data->colorPool = RB_cloneColorPool(template->colorPool);
+	data->pixelMap = RB_clonePixelMap(template->pixelMap);
+
+	if(data->assignmentQueue == NULL || data->colorPool == NULL || data->pixelMap == NULL) {
+		freeBatchData(data);
+		return false;
+	}
+
+	return true;
+}
+
+void* runBatchWorker(void* workerPtr) {
+	BatchState* state = ((BatchWorker*) workerPtr)->state;
+
+	RB_Data data = {
+		.assignmentQueue = NULL,
+		.colorPool = NULL,
+		.pixelMap = NULL,
+		.numPixelObservers = 0,
+		.hasStarted = false
+	};
+	int currentTemplate = -1;
+	// The first job after (re)allocating doesn't need to reset anything.
+	bool isPristine = false;
+	// The calling thread is a worker too, so its own budget is restored afterwards.
+	int buildThreads = RB_setColorPoolBuildThreads(1);
+	RB_TRACE_THREAD_NAME("batch worker");
+
+	while(!atomic_load(&(state->failed))) {
+		int jobIndex = atomic_fetch_add(&(state->nextJob), 1);
+		if(jobIndex >= state->numJobs) {
+			break;
+		}
+		RB_TRACE_BEGIN(traceStart);
+
+		int templateIndex = state->jobTemplates[jobIndex];
+		const BatchTemplate* template = &(state->templates[templateIndex]);
+
+		if(templateIndex != currentTemplate) {
+			freeBatchData(&data);
+			currentTemplate = -1;
+
+			if(!allocateBatchData(&data, template)) {
+				fprintf(stderr, "Failed to allocate a batch worker's rainbow!\n");
+				atomic_store(&(state->failed), true);
+				break;
+			}
+
+			currentTemplate = templateIndex;
+			isPristine = true;
+		}
+
+		if(!isPristine) {
+			RB_clearAssignmentQueue(data.assignmentQueue);
+			if(
+				!RB_copyColorPool(data.colorPool, template->colorPool)
+				|| !RB_copyPixelMap(data.pixelMap, template->pixelMap)
+			) {
+				fprintf(stderr, "Failed to reset a batch worker's rainbow!\n");
+				atomic_store(&(state->failed), true);
+				break;
+			}
+		}
+		isPristine = false;
+
+		data.config = state->jobConfigs[jobIndex];
+		RB_seedRandom(&(data.random), data.config.seed);
+		data.hasStarted = false;
+
+		RB_Coord firstCoord = RB_getRandomCoord(&data);
+		RB_Color firstColor = RB_getRandomColor(&data);
+		RB_setCoordColor(&data, firstCoord, firstColor);
+		RB_generatePixels(&data, data.config.width * data.config.height);
+
+		if(state->callback != NULL) {
+			state->callback(state->userData, jobIndex, &data);
+		}
+
+		atomic_fetch_add(&(state->numFinished), 1);
+		atomic_fetch_add(&(state->numPixels), (unsigned long long) data.config.width * data.config.height);
+		RB_TRACE_END_WITH_ARG(traceStart, "batchJob", "job", jobIndex);
+	}
+
+	freeBatchData(&data);
+	RB_setColorPoolBuildThreads(buildThreads);
+
+	return NULL;
+}
+
+// Resolves every job's config and builds a template for every distinct geometry. numTemplates is kept up to date
+// even on failure, so that the templates which were built can be freed. Returns true on success.
+bool buildBatchTemplates(BatchState* state, int* numTemplates) {
+	*numTemplates = 0;
+
+	for(int i = 0; i < state->numJobs; i++) {
+		RB_Config* config = &(state->jobConfigs[i]);
+
+		if(state->jobs[i].config == NULL || !RB_resolveConfig(state->jobs[i].config, config)) {
+			fprintf(stderr, "Batch job %d has an invalid config!\n", i);
+			return false;
+		}
+		config->seed = state->jobs[i].seed;
+
+		int templateIndex = 0;
+		while(templateIndex < *numTemplates && !haveSameGeometry(config, &(state->templates[templateIndex].config))) {
+			templateIndex++;
+		}
+
+		if(templateIndex == *numTemplates) {
+			BatchTemplate* template = &(state->templates[templateIndex]);
+			(*numTemplates)++;
+
+			template->config = *config;
+			template->colorPool = config->paletteSet?
+				RB_createPaletteColorPool(config->palette, config->paletteLength)
+				: RB_createCountedColorPool(config->rRes, config->gRes, config->bRes, config->width * config->height);
+			template->pixelMap = RB_createPixelMap(config->width, config->height, config->mapLayout);
+
+			if(template->colorPool == NULL || template->pixelMap == NULL) {
+				fprintf(stderr, "Failed to build a batch template!\n");
+				return false;
+			}
+
+			if(!RB_setPixelMapTopology(template->pixelMap, config->topology, config->topologyRemap)) {
+				fprintf(stderr, "Failed to set a batch template's topology!\n");
+				return false;
+			}
+		}
+
+		state->jobTemplates[i] = templateIndex;
+	}
+
+	return true;
+}
+
+void freeBatchState(BatchState* state, int numTemplates) {
+	if(state->templates != NULL) {
+		for(int i = 0; i < numTemplates; i++) {
+			RB_freeColorPool(state->templates[i].colorPool);
+			RB_freePixelMap(state->templates[i].pixelMap);
+		}
+	}
+	free(state->templates);
+	free(state->jobTemplates);
+	free(state->jobConfigs);
+}
+
+bool RB_runBatch(
+	const RB_BatchJob* jobs,
+	int numJobs,
+	int numThreads,
+	RB_BatchCallback callback,
+	void* userData,
+	RB_BatchReport* report
+) {
+	if(numJobs < 1 || jobs == NULL) {
+		fprintf(stderr, "Cannot run a batch without jobs!\n");
+		return false;
+	}
+
+	if(numThreads < 1) {
+		numThreads = 1;
+	}
+	if(numThreads > numJobs) {
+		numThreads = numJobs;
+	}
+
+	double startTime = RB_getMonotonicSeconds();
+
+	BatchState state = {
+		.jobs = jobs,
+		.numJobs = numJobs,
+		.callback = callback,
+		.userData = userData
+	};
+	atomic_init(&(state.nextJob), 0);
+	atomic_init(&(state.numFinished), 0);
+	atomic_init(&(state.numPixels), 0);
+	atomic_init(&(state.failed), false);
+
+	// There can't be more templates than jobs.
+	state.jobConfigs = (RB_Config*) malloc(sizeof(RB_Config) * numJobs);
+	state.jobTemplates = (int*) malloc(sizeof(int) * numJobs);
+	state.templates = (BatchTemplate*) calloc(numJobs, sizeof(BatchTemplate));
+
+	if(state.jobConfigs == NULL || state.jobTemplates == NULL || state.templates == NULL) {
+		fprintf(stderr, "Failed to allocate the batch!\n");
+		freeBatchState(&state, 0);
+		return false;
+	}
+
+	int numTemplates;
+	if(!buildBatchTemplates(&state, &numTemplates)) {
+		freeBatchState(&state, numTemplates);
+		return false;
+	}
+
+	BatchWorker* workers = (BatchWorker*) calloc(numThreads, sizeof(BatchWorker));
+
+	if(workers == NULL) {
+		fprintf(stderr, "Failed to allocate the batch workers!\n");
+		freeBatchState(&state, numTemplates);
+		return false;
+	}
+
+	// Worker 0 is the calling thread. If a thread fails to start, the other workers pick up its jobs.
+	for(int i = 0; i < numThreads; i++) {
+		workers[i].state = &state;
+	}
+	for(int i = 1; i < numThreads; i++) {
+		workers[i].threadStarted = pthread_create(&(workers[i].thread), NULL, runBatchWorker, &(workers[i])) == 0;
+		if(!workers[i].threadStarted) {
+			fprintf(stderr, "Failed to start batch worker %d, continuing without it.\n", i);
+		}
+	}
+
+	runBatchWorker(&(workers[0]));
+
+	for(int i = 1; i < numThreads; i++) {
+		if(workers[i].threadStarted) {
+			pthread_join(workers[i].thread, NULL);
+		}
+	}
+
+	free(workers);
+	freeBatchState(&state, numTemplates);
+
+
+	int numFinished = atomic_load(&(state.numFinished));
+	double numPixels = (double) atomic_load(&(state.numPixels));
+	double seconds = RB_getMonotonicSeconds() - startTime;
+	double imagesPerHour = seconds > 0? (numFinished * 3600.0) / seconds : 0;
+	double pixelsPerSecond = seconds > 0? numPixels / seconds : 0;
+
+	printf(
+		"Batch finished.\n"
+		"| Images: %d of %d, on %d threads, from %d templates.\n"
+		"| Time: %.3f s.\n"
+		"| Throughput: %.1f images/hour, %.0f pixels/s.\n",
+		numFinished, numJobs, numThreads, numTemplates,
+		seconds,
+		imagesPerHour, pixelsPerSecond
+	);
+
+	if(report != NULL) {
+		*report = (RB_BatchReport) {
+			.numImages = numFinished,
+			.numPixels = (uint64_t) numPixels,
+			.seconds = seconds,
+			.imagesPerHour = imagesPerHour,
+			.pixelsPerSecond = pixelsPerSecond
+		};
+	}
+
+	return numFinished == numJobs;
+}
@@ -0,0 +1,495 @@
+#include "headers/RB_Checkpoint.h"
+#include "headers/RB_AssignmentQueue.h"
+#include "headers/RB_ColorPool.h"
+#include "headers/RB_PixelMap.h"
+#include "headers/RB_Trace.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RB_CHECKPOINT_MAGIC "RBCP"
+// The magic, the version, ten uint32 config fields, the keepPristineColorPool byte, the generator's state, the length
+// of the queue, the length of the palette, and the repeatColors byte.
+#define RB_CHECKPOINT_HEADER_SIZE (4 + 4 + (10 * 4) + 1 + 8 + 4 + 4 + 1)
+// Checkpoints are read and written in large pieces, so the file's buffer is made much larger than stdio's default.
+#define RB_CHECKPOINT_BUFFER_SIZE (1 << 20)
+
+typedef struct {
+	FILE* file;
+	bool failed;
+	// Each column of the map, as it is read out of or written into the pixel map.
+	RB_PixelStatus* statuses;
+	RB_Color* colors;
+	uint8_t* colorBytes;
+	// One bit for every pixel, a column at a time.
+	uint8_t* pixelBitmap;
+	size_t pixelBitmapSize;
+} CheckpointFile;
+
+void storeCheckpointUint32(uint8_t* bytes, uint32_t value) {
+	for(int i = 0; i < 4; i++) {
+		bytes[i] = (uint8_t) (value >> (8 * i));
+	}
+}
+
+uint32_t loadCheckpointUint32(const uint8_t* bytes) {
+	uint32_t ret = 0;
+	for(int i = 0; i < 4; i++) {
+		ret |= ((uint32_t) bytes[i]) << (8 * i);
+	}
+	return ret;
+}
+
+void writeCheckpointBytes(CheckpointFile* checkpoint, const void* bytes, size_t length) {
+	if(!checkpoint->failed && length > 0 && fwrite(bytes, 1, length, checkpoint->file) != length) {
+		fprintf(stderr, "Error saving checkpoint: cannot write to the file!\n");
+		checkpoint->failed = true;
+	}
+}
+
+void readCheckpointBytes(CheckpointFile* checkpoint, void* bytes, size_t length) {
+	if(!checkpoint->failed && length > 0 && fread(bytes, 1, length, checkpoint->file) != length) {
+		fprintf(stderr, "Error loading checkpoint: the file is truncated!\n");
+		checkpoint->failed = true;
+	}
+}
+
+void writeCheckpointCoords(CheckpointFile* checkpoint, const RB_Coord* coords, RB_Size numCoords) {
+	for(RB_Size i = 0; i < numCoords; i++) {
+		uint8_t bytes[8];
+		storeCheckpointUint32(bytes, (uint32_t) coords[i].x);
+		storeCheckpointUint32(bytes + 4, (uint32_t) coords[i].y);
+		writeCheckpointBytes(checkpoint, bytes, 8);
+	}
+}
+
+RB_Coord readCheckpointCoord(CheckpointFile* checkpoint) {
+	uint8_t bytes[8] = {0};
+	readCheckpointBytes(checkpoint, bytes, 8);
+	return (RB_Coord) {
+		.x = (RB_Size) (int32_t) loadCheckpointUint32(bytes),
+		.y = (RB_Size) (int32_t) loadCheckpointUint32(bytes + 4)
+	};
+}
+
+// The palette is written a column's worth of colors at a time, through the column buffers.
+void writeCheckpointPalette(CheckpointFile* checkpoint, const RB_ColorPool* pool, RB_Size length, RB_Size height) {
+	for(RB_Size start = 0; start < length; start += height) {
+		RB_Size numColors = (length - start < height)? length - start : height;
+		for(RB_Size i = 0; i < numColors; i++) {
+			RB_Color color = RB_getColorPoolColor(pool, start + i);
+			checkpoint->colorBytes[3 * i] = (uint8_t) color.r;
+			checkpoint->colorBytes[(3 * i) + 1] = (uint8_t) color.g;
+			checkpoint->colorBytes[(3 * i) + 2] = (uint8_t) color.b;
+		}
+		writeCheckpointBytes(checkpoint, checkpoint->colorBytes, (size_t) numColors * 3);
+	}
+}
+
+void readCheckpointPalette(CheckpointFile* checkpoint, RB_Color* palette, RB_Size length, RB_Size height) {
+	for(RB_Size start = 0; start < length && !checkpoint->failed; start += height) {
+		RB_Size numColors = (length - start < height)? length - start : height;
+		readCheckpointBytes(checkpoint, checkpoint->colorBytes, (size_t) numColors * 3);
+		for(RB_Size i = 0; i < numColors; i++) {
+			palette[start + i] = (RB_Color) {
+				.r = checkpoint->colorBytes[3 * i],
+				.g = checkpoint->colorBytes[(3 * i) + 1],
+				.b = checkpoint->colorBytes[(3 * i) + 2]
+			};
+		}
+	}
+}
+
+bool openCheckpointFile(CheckpointFile* checkpoint, const char* path, const char* mode, RB_Size width, RB_Size height) {
+	*checkpoint = (CheckpointFile) {
+		.file = fopen(path, mode),
+		.failed = false,
+		.pixelBitmapSize = (((size_t) width * height) + 7) / 8
+	};
+
+	if(checkpoint->file == NULL) {
+		fprintf(stderr, "Error opening checkpoint: cannot open %s!\n", path);
+		return false;
+	}
+	setvbuf(checkpoint->file, NULL, _IOFBF, RB_CHECKPOINT_BUFFER_SIZE);
+
+	checkpoint->statuses = (RB_PixelStatus*) malloc(sizeof(RB_PixelStatus) * height);
+	checkpoint->colors = (RB_Color*) malloc(sizeof(RB_Color) * height);
+	checkpoint->colorBytes = (uint8_t*) malloc((size_t) height * 3);
+	checkpoint->pixelBitmap = (uint8_t*) calloc(checkpoint->pixelBitmapSize, 1);
+
+	if(
+		checkpoint->statuses == NULL || checkpoint->colors == NULL
+		|| checkpoint->colorBytes == NULL || checkpoint->pixelBitmap == NULL
+	) {
+		fprintf(
+			stderr, "Error opening checkpoint: cannot allocate buffers for a column of %ld pixels!\n", (long) height
+		);
+		checkpoint->failed = true;
+		return false;
+	}
+
+	return true;
+}
+
+// Closes the file and frees the buffers. Returns false if anything went wrong with the checkpoint.
+bool closeCheckpointFile(CheckpointFile* checkpoint) {
+	if(checkpoint->file != NULL && fclose(checkpoint->file) != 0) {
+		fprintf(stderr, "Error closing checkpoint!\n");
+		checkpoint->failed = true;
+	}
+
+	free(checkpoint->statuses);
+	free(checkpoint->colors);
+	free(checkpoint->colorBytes);
+	free(checkpoint->pixelBitmap);
+
+	return !checkpoint->failed;
+}
+
+bool RB_saveCheckpoint(RB_Data* data, const char* path) {
+	RB_Config* config = &(data->config);
+	RB_Size width = config->width;
+	RB_Size height = config->height;
+	RB_Size queueSize = RB_getQueueSize(data->assignmentQueue);
+	RB_TRACE_BEGIN(traceStart);
+
+	CheckpointFile checkpoint;
+	if(!openCheckpointFile(&checkpoint, path, "wb", width, height)) {
+		closeCheckpointFile(&checkpoint);
+		return false;
+	}
+
+	uint8_t header[RB_CHECKPOINT_HEADER_SIZE];
+	uint32_t headerFields[] = {
+		RB_CHECKPOINT_VERSION,
+		(uint32_t) width,
+		(uint32_t) height,
+		(uint32_t) config->rRes,
+		(uint32_t) config->gRes,
+		(uint32_t) config->bRes,
+		(uint32_t) config->windowWidth,
+		(uint32_t) config->windowHeight,
+		(uint32_t) config->seed,
+		(uint32_t) config->topology,
+		(uint32_t) config->mapLayout
+	};
+	memcpy(header, RB_CHECKPOINT_MAGIC, 4);
+	for(int i = 0; i < 11; i++) {
+		storeCheckpointUint32(header + 4 + (4 * i), headerFields[i]);
+	}
+	header[48] = config->keepPristineColorPool? 1 : 0;
+	storeCheckpointUint32(header + 49, (uint32_t) data->random.state);
+	storeCheckpointUint32(header + 53, (uint32_t) (data->random.state >> 32));
+	storeCheckpointUint32(header + 57, (uint32_t) queueSize);
+	storeCheckpointUint32(header + 61, (uint32_t) (config->paletteSet? config->paletteLength : 0));
+	header[65] = config->repeatColors? 1 : 0;
+	writeCheckpointBytes(&checkpoint, header, RB_CHECKPOINT_HEADER_SIZE);
+
+	if(config->paletteSet) {
+		writeCheckpointPalette(&checkpoint, data->colorPool, config->paletteLength, height);
+	}
+
+	if(config->topology == RB_TOPOLOGY_CUSTOM) {
+		writeCheckpointCoords(
+			&checkpoint,
+			RB_getPixelMapTopologyRemap(data->pixelMap),
+			RB_getTopologyRemapLength(width, height)
+		);
+	}
+
+	// Which pixels are set. Every pixel has to be looked at for this, but their colors don't.
+	size_t pixelIndex = 0;
+	for(RB_Size x = 0; x < width; x++) {
+		RB_readPixelMapColumnStatuses(data->pixelMap, x, 0, height, checkpoint.statuses);
+		for(RB_Size y = 0; y < height; y++) {
+			if(checkpoint.statuses[y] == RB_PIXEL_SET) {
+				checkpoint.pixelBitmap[pixelIndex >> 3] |= (uint8_t) (1 << (pixelIndex & 7));
+			}
+			pixelIndex++;
+		}
+	}
+	writeCheckpointBytes(&checkpoint, checkpoint.pixelBitmap, checkpoint.pixelBitmapSize);
+
+	// The colors of the set pixels, in the same order.
+	pixelIndex = 0;
+	for(RB_Size x = 0; x < width; x++) {
+		RB_readPixelMapColumn(data->pixelMap, x, 0, height, checkpoint.colors);
+
+		size_t numBytes = 0;
+		for(RB_Size y = 0; y < height; y++) {
+			if((checkpoint.pixelBitmap[pixelIndex >> 3] >> (pixelIndex & 7)) & 1) {
+				checkpoint.colorBytes[numBytes] = (uint8_t) checkpoint.colors[y].r;
+				checkpoint.colorBytes[numBytes + 1] = (uint8_t) checkpoint.colors[y].g;
+				checkpoint.colorBytes[numBytes + 2] = (uint8_t) checkpoint.colors[y].b;
+				numBytes += 3;
+			}
+			pixelIndex++;
+		}
+		writeCheckpointBytes(&checkpoint, checkpoint.colorBytes, numBytes);
+	}
+
+	for(RB_Size i = 0; i < queueSize; i++) {
+		RB_Coord coord = RB_getQueuedCoord(data->assignmentQueue, i);
+		writeCheckpointCoords(&checkpoint, &coord, 1);
+	}
+
+	size_t availabilitySize = RB_getColorPoolAvailabilitySize(data->colorPool);
+	uint8_t* availability = (uint8_t*) malloc(availabilitySize);
+	if(availability == NULL) {
+		fprintf(stderr, "Error saving checkpoint: cannot allocate the availability bitmap!\n");
+		checkpoint.failed = true;
+	} else {
+		RB_getColorPoolAvailability(data->colorPool, availability);
+		writeCheckpointBytes(&checkpoint, availability, availabilitySize);
+		free(availability);
+	}
+
+	bool saved = closeCheckpointFile(&checkpoint);
+	RB_TRACE_END_WITH_ARG(traceStart, "saveCheckpoint", "queuedCoords", queueSize);
+	return saved;
+}
+
+// Reads the header into the config (which is fully resolved, apart from the topology's remap table and the palette's
+// colors), the generator's state and the length of the queue. Returns false if the file isn't a checkpoint this
+// version can load.
+bool readCheckpointHeader(FILE* file, RB_Config* config, uint64_t* randomState, RB_Size* queueSize) {
+	uint8_t header[RB_CHECKPOINT_HEADER_SIZE];
+
+	if(fread(header, 1, RB_CHECKPOINT_HEADER_SIZE, file) != RB_CHECKPOINT_HEADER_SIZE) {
+		fprintf(stderr, "Error loading checkpoint: the file is too short to be a checkpoint!\n");
+		return false;
+	}
+
+	if(memcmp(header, RB_CHECKPOINT_MAGIC, 4) != 0) {
+		fprintf(stderr, "Error loading checkpoint: the file is not a checkpoint!\n");
+		return false;
+	}
+
+	uint32_t version = loadCheckpointUint32(header + 4);
+	if(version != RB_CHECKPOINT_VERSION) {
+		fprintf(
+			stderr,
+			"Error loading checkpoint: the file is version %u, but only version %d can be loaded!\n",
+			version, RB_CHECKPOINT_VERSION
+		);
+		return false;
+	}
+
+	*config = (RB_Config) {
+		.width = (RB_Size) loadCheckpointUint32(header + 8),
+		.height = (RB_Size) loadCheckpointUint32(header + 12),
+		.mapDimensionsSet = true,
+		.rRes = (RB_ColorChannelSize) loadCheckpointUint32(header + 16),
+		.gRes = (RB_ColorChannelSize) loadCheckpointUint32(header + 20),
+		.bRes = (RB_ColorChannelSize) loadCheckpointUint32(header + 24),
+		.colorResSet = true,
+		.windowWidth = (int) loadCheckpointUint32(header + 28),
+		.windowHeight = (int) loadCheckpointUint32(header + 32),
+		.windowDimensionsSet = true,
+		.seed = loadCheckpointUint32(header + 36),
+		.seedSet = true,
+		.topology = (RB_Topology) loadCheckpointUint32(header + 40),
+		.topologyRemap = NULL,
+		.topologySet = true,
+		.mapLayout = (RB_MapLayout) loadCheckpointUint32(header + 44),
+		.mapLayoutSet = true,
+		.keepPristineColorPool = header[48] != 0,
+		.palette = NULL,
+		.paletteLength = (RB_Size) loadCheckpointUint32(header + 61),
+		.repeatColors = header[65] != 0
+	};
+	config->paletteSet = config->paletteLength != 0;
+	*randomState = loadCheckpointUint32(header + 49) | (((uint64_t) loadCheckpointUint32(header + 53)) << 32);
+	*queueSize = (RB_Size) loadCheckpointUint32(header + 57);
+
+	bool paletteIsValid = !config->paletteSet || (
+		config->paletteLength > 0 && config->paletteLength <= RB_MAXIMUM_NUMBER_OF_PIXELS
+		&& config->rRes == RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION
+		&& config->gRes == RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION
+		&& config->bRes == RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION
+	);
+
+	if(
+		config->rRes < 1 || config->rRes > RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION
+		|| config->gRes < 1 || config->gRes > RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION
+		|| config->bRes < 1 || config->bRes > RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION
+		|| config->width < 1 || config->height < 1
+		|| (RB_MAXIMUM_NUMBER_OF_PIXELS / config->width) < config->height
+		|| !paletteIsValid
+		|| (
+			(config->paletteSet || !config->repeatColors)
+			&& (config->paletteSet? config->paletteLength : (RB_Size) (config->rRes * config->gRes * config->bRes))
+				!= config->width * config->height
+		)
+		|| config->topology > RB_TOPOLOGY_CUSTOM
+		|| config->mapLayout > RB_MAP_LAYOUT_TILED
+		|| *queueSize < 0 || *queueSize > config->width * config->height
+	) {
+		fprintf(stderr, "Error loading checkpoint: the file's config is invalid!\n");
+		return false;
+	}
+
+	return true;
+}
+
+// Reads the pixels, the queue and the pool from the checkpoint into a freshly initialized rainbow.
+void readCheckpointState(CheckpointFile* checkpoint, RB_Data* data, RB_Size queueSize) {
+	RB_Size width = data->config.width;
+	RB_Size height = data->config.height;
+
+	readCheckpointBytes(checkpoint, checkpoint->pixelBitmap, checkpoint->pixelBitmapSize);
+
+	size_t pixelIndex = 0;
+	for(RB_Size x = 0; x < width && !checkpoint->failed; x++) {
+		size_t numSet = 0;
+		for(RB_Size y = 0; y < height; y++) {
+			numSet += (checkpoint->pixelBitmap[(pixelIndex + y) >> 3] >> ((pixelIndex + y) & 7)) & 1;
+		}
+		readCheckpointBytes(checkpoint, checkpoint->colorBytes, numSet * 3);
+
+		// Only set pixels are touched, so tiles that are still blank are never allocated.
+		uint8_t* colorBytes = checkpoint->colorBytes;
+		for(RB_Size y = 0; y < height && !checkpoint->failed; y++) {
+			if((checkpoint->pixelBitmap[pixelIndex >> 3] >> (pixelIndex & 7)) & 1) {
+				RB_Pixel* pixel = RB_getPixel(data->pixelMap, (RB_Coord) { .x = x, .y = y });
+				if(pixel == NULL) {
+					fprintf(
+						stderr,
+						"Error loading checkpoint: cannot allocate the pixel at (%ld, %ld)!\n",
+						(long) x, (long) y
+					);
+					checkpoint->failed = true;
+					break;
+				}
+
+				if(
+					colorBytes[0] >= data->config.rRes || colorBytes[1] >= data->config.gRes
+					|| colorBytes[2] >= data->config.bRes
+				) {
+					fprintf(
+						stderr,
+						"Error loading checkpoint: the pixel at (%ld, %ld) has an invalid color!\n",
+						(long) x, (long) y
+					);
+					checkpoint->failed = true;
+					break;
+				}
+
+				pixel->color = (RB_Color) { .r = colorBytes[0], .g = colorBytes[1], .b = colorBytes[2] };
+				pixel->status = RB_PIXEL_SET;
+				data->hasStarted = true;
+				colorBytes += 3;
+			}
+			pixelIndex++;
+		}
+	}
+
+	// Adding the coords in their saved order puts each of them back in the same position of the queue.
+	for(RB_Size i = 0; i < queueSize && !checkpoint->failed; i++) {
+		RB_Coord coord = readCheckpointCoord(checkpoint);
+		if(!RB_coordIsWithinQueueBounds(data->assignmentQueue, coord) || RB_coordIsInQueue(data->assignmentQueue, coord)) {
+			fprintf(stderr, "Error loading checkpoint: queued Coord(%d, %d) is invalid!\n", coord.x, coord.y);
+			checkpoint->failed = true;
+			break;
+		}
+		RB_addCoordToAssignmentQueue(data->assignmentQueue, coord, 0);
+	}
+
+	size_t availabilitySize = RB_getColorPoolAvailabilitySize(data->colorPool);
+	uint8_t* availability = (uint8_t*) malloc(availabilitySize);
+	if(availability == NULL) {
+		fprintf(stderr, "Error loading checkpoint: cannot allocate the availability bitmap!\n");
+		checkpoint->failed = true;
+		return;
+	}
+
+	readCheckpointBytes(checkpoint, availability, availabilitySize);
+	if(!checkpoint->failed && !RB_rebuildColorPool(data->colorPool, availability)) {
+		fprintf(stderr, "Error loading checkpoint: cannot rebuild the Color Pool!\n");
+		checkpoint->failed = true;
+	}
+	free(availability);
+}
+
+RB_Data* RB_loadCheckpoint(const char* path) {
+	RB_TRACE_BEGIN(traceStart);
+	FILE* file = fopen(path, "rb");
+	if(file == NULL) {
+		fprintf(stderr, "Error loading checkpoint: cannot open %s!\n", path);
+		return NULL;
+	}
+
+	RB_Config config;
+	uint64_t randomState;
+	RB_Size queueSize;
+	bool headerIsValid = readCheckpointHeader(file, &config, &randomState, &queueSize);
+	fclose(file);
+
+	if(!headerIsValid) {
+		return NULL;
+	}
+
+	// The header has already been validated, so the file is simply opened again and read past it.
+	CheckpointFile checkpoint;
+	if(!openCheckpointFile(&checkpoint, path, "rb", config.width, config.height)) {
+		closeCheckpointFile(&checkpoint);
+		return NULL;
+	}
+	if(fseek(checkpoint.file, RB_CHECKPOINT_HEADER_SIZE, SEEK_SET) != 0) {
+		fprintf(stderr, "Error loading checkpoint: cannot read past the header of %s!\n", path);
+		closeCheckpointFile(&checkpoint);
+		return NULL;
+	}
+
+	RB_Color* palette = NULL;
+	if(config.paletteSet) {
+		palette = (RB_Color*) malloc(sizeof(RB_Color) * config.paletteLength);
+		if(palette == NULL) {
+			fprintf(stderr, "Error loading checkpoint: cannot allocate the palette!\n");
+			closeCheckpointFile(&checkpoint);
+			return NULL;
+		}
+
+		readCheckpointPalette(&checkpoint, palette, config.paletteLength, config.height);
+		config.palette = palette;
+	}
+
+	RB_Coord* remapTable = NULL;
+	if(config.topology == RB_TOPOLOGY_CUSTOM) {
+		RB_Size remapLength = RB_getTopologyRemapLength(config.width, config.height);
+		remapTable = (RB_Coord*) malloc(sizeof(RB_Coord) * remapLength);
+		if(remapTable == NULL) {
+			fprintf(stderr, "Error loading checkpoint: cannot allocate the topology's remap table!\n");
+			free(palette);
+			closeCheckpointFile(&checkpoint);
+			return NULL;
+		}
+
+		for(RB_Size i = 0; i < remapLength; i++) {
+			remapTable[i] = readCheckpointCoord(&checkpoint);
+		}
+		config.topologyRemap = remapTable;
+	}
+
+	RB_Data* data = checkpoint.failed? NULL : RB_init(&config);
+	// RB_init copies the remap table into the pixel map, and the palette into the color pool.
+	free(remapTable);
+	free(palette);
+
+	if(data == NULL) {
+		closeCheckpointFile(&checkpoint);
+		return NULL;
+	}
+
+	data->random.state = randomState;
+	readCheckpointState(&checkpoint, data, queueSize);
+
+	if(!closeCheckpointFile(&checkpoint)) {
+		RB_free(data);
+		return NULL;
+	}
+
+	RB_TRACE_END_WITH_ARG(traceStart, "loadCheckpoint", "queuedCoords", queueSize);
+	return data;
+}
@@ -0,0 +1,8 @@
+#include "headers/RB_Clock.h"
+#include <time.h>
+
+double RB_getMonotonicSeconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double) now.tv_sec + ((double) now.tv_nsec / 1000000000.0);
+}
@@ -1,17 +1,36 @@
 #include "headers/RB_Display.h"
+#include "headers/RB_Clock.h"
+#include "headers/RB_Trace.h"
 #include "SDL.h"
-#include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+
+// The color every pixel is displayed as before it is set, as an RGB888 value.
+#define RB_DISPLAY_BACKGROUND 0x808080
 
 struct RB_Display_s {
 	SDL_Window* window;
 	SDL_Renderer* renderer;
 	SDL_Texture* texture;
 
+	// Pixels are drawn into this RGB888 framebuffer, row by row, and only uploaded to the texture once per frame.
+	uint32_t* framebuffer;
+	RB_Size pWidth;
+	RB_Size pHeight;
+	// The rows that have changed since the last upload. If dirtyMinY > dirtyMaxY, nothing has changed.
+	RB_Size dirtyMinY;
+	RB_Size dirtyMaxY;
+
+	// For every value of each channel, that value rescaled to 8 bits and shifted into its place in an RGB888 value.
+	uint32_t rLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint32_t gLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint32_t bLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+
 	double framesPerSecond;
 	double secondsPerFrame;
-	clock_t lastFrameProcTime;
+	// In monotonic seconds, so that frames are paced by real time rather than by how busy the CPU is.
+	double lastFrameTime;
 
 	RB_ColorChannelSize rRes;
 	RB_ColorChannelSize gRes;
@@ -54,15 +73,43 @@ RB_Display* RB_createDisplay(
 	ret->window = NULL;
 	ret->renderer = NULL;
 	ret->texture = NULL;
+	ret->framebuffer = NULL;
+
+	ret->pWidth = pWidth;
+	ret->pHeight = pHeight;
 
 	ret->framesPerSecond = 60.0;
 	ret->secondsPerFrame = 1.0/ret->framesPerSecond;
-	ret->lastFrameProcTime = clock();
+	ret->lastFrameTime = RB_getMonotonicSeconds();
 
 	ret->rRes = rRes;
 	ret->gRes = gRes;
 	ret->bRes = bRes;
 
+	uint8_t rLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint8_t gLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint8_t bLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	RB_buildChannelLookup(rLookup, rRes);
+	RB_buildChannelLookup(gLookup, gRes);
+	RB_buildChannelLookup(bLookup, bRes);
+
+	for(RB_ColorChannelSize i = 0; i < rRes; i++) {
+		ret->rLookup[i] = (uint32_t) rLookup[i] << 16;
+	}
+	for(RB_ColorChannelSize i = 0; i < gRes; i++) {
+		ret->gLookup[i] = (uint32_t) gLookup[i] << 8;
+	}
+	for(RB_ColorChannelSize i = 0; i < bRes; i++) {
+		ret->bLookup[i] = bLookup[i];
+	}
+
+	ret->framebuffer = (uint32_t*) malloc(sizeof(uint32_t) * pWidth * pHeight);
+	if(ret->framebuffer == NULL) {
+		fprintf(stderr, "Error in RB_createDisplay: cannot allocate framebuffer!\n");
+		RB_freeDisplay(ret);
+		return NULL;
+	}
+
 	// Initializing SDL
 	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
 		fprintf(stderr, "Error in RB_createDisplay: Error initializing SDL!: %s\n", SDL_GetError());
@@ -86,20 +133,16 @@ RB_Display* RB_createDisplay(
 		return NULL;
 	}
 
-	// Creating texture
-	ret->texture = SDL_CreateTexture(ret->renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_TARGET, pWidth, pHeight);
+	// Creating texture. It is only ever written to by uploading the framebuffer.
+	ret->texture = SDL_CreateTexture(ret->renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING, pWidth, pHeight);
 	if(ret->texture == NULL) {
 		fprintf(stderr, "Error in RB_createDisplay: Error creating texture!: %s\n", SDL_GetError());
 		RB_freeDisplay(ret);
 		return NULL;
 	}
 
-	// Setting render target to the texture
-	SDL_SetRenderTarget(ret->renderer, ret->texture);
-
 	// Giving the texture a background.
-	SDL_SetRenderDrawColor(ret->renderer, 128, 128, 128, SDL_ALPHA_OPAQUE);
-	SDL_RenderClear(ret->renderer);
+	RB_clearDisplay(ret);
 	RB_forceUpdateDisplay(ret, true);
 
 	// Handling the window events. This is required to make the window show up.
@@ -122,6 +165,7 @@ void RB_freeDisplay(RB_Display* ret) {
 		SDL_DestroyWindow(ret->window);
 		ret->window = NULL;
 	}
+	free(ret->framebuffer);
 	free(ret);
 
 	// Technically, this does make it not-modular.
@@ -129,27 +173,87 @@ void RB_freeDisplay(RB_Display* ret) {
 }
 
 
+void displayPixelObserver(void* displayPtr, RB_Coord coord, RB_Color color) {
+	RB_setDisplayedPixelColor((RB_Display*) displayPtr, coord, color);
+}
+
+void resetDisplayObserver(void* displayPtr) {
+	RB_clearDisplay((RB_Display*) displayPtr);
+}
+
+void freeDisplayObserver(void* displayPtr) {
+	RB_freeDisplay((RB_Display*) displayPtr);
+}
+
+RB_Display* RB_attachDisplay(RB_Data* data) {
+	RB_Display* ret = RB_createDisplay(
+		data->config.windowWidth, data->config.windowHeight,
+		data->config.width, data->config.height,
+		data->config.rRes, data->config.gRes, data->config.bRes
+	);
+
+	if(ret == NULL) {
+		return NULL;
+	}
+
+	RB_PixelObserver observer = {
+		.onPixelSet = displayPixelObserver,
+		.onReset = resetDisplayObserver,
+		.onFree = freeDisplayObserver,
+		.userData = ret
+	};
+
+	if(!RB_addPixelObserver(data, observer)) {
+		fprintf(stderr, "Error in RB_attachDisplay: could not add the display to the rainbow!\n");
+		RB_freeDisplay(ret);
+		return NULL;
+	}
+
+	return ret;
+}
 
 // Forces the display to update immediately.
 void RB_forceUpdateDisplay(RB_Display* display, bool interruptFramerate) {
+	RB_TRACE_BEGIN(traceStart);
+
 	if(interruptFramerate) {
-		display->lastFrameProcTime = clock();
+		display->lastFrameTime = RB_getMonotonicSeconds();
+	}
+
+	// Only the rows that changed since the last frame are uploaded, all in one call.
+	if(display->dirtyMinY <= display->dirtyMaxY) {
+		SDL_Rect dirtyRect = {
+			.x = 0,
+			.y = display->dirtyMinY,
+			.w = display->pWidth,
+			.h = (display->dirtyMaxY - display->dirtyMinY) + 1
+		};
+		SDL_UpdateTexture(
+			display->texture,
+			&dirtyRect,
+			display->framebuffer + ((size_t) display->dirtyMinY * display->pWidth),
+			display->pWidth * sizeof(uint32_t)
+		);
+
+		display->dirtyMinY = display->pHeight;
+		display->dirtyMaxY = 0;
 	}
 
-	SDL_SetRenderTarget(display->renderer, NULL);
+	SDL_RenderClear(display->renderer);
 	SDL_RenderCopy(display->renderer, display->texture, NULL, NULL);
 	SDL_RenderPresent(display->renderer);
-	SDL_SetRenderTarget(display->renderer, display->texture);
+
+	RB_TRACE_END(traceStart, "updateDisplay");
 }
 
 // If it has been a sufficiently long time since the last update, updates the display and returns 1.
 // Otherwise, does not update the display and returns 0.
 bool RB_updateDisplay(RB_Display* display) {
-	clock_t currentTime = clock();
-	double deltaT = ((double) (currentTime - display->lastFrameProcTime)) / CLOCKS_PER_SEC;
+	double currentTime = RB_getMonotonicSeconds();
+	double deltaT = currentTime - display->lastFrameTime;
 	if(deltaT < 0 || deltaT >= display->secondsPerFrame) {
 		RB_forceUpdateDisplay(display, false);
-		display->lastFrameProcTime = currentTime;
+		display->lastFrameTime = currentTime;
 		return true;
 	}
 
@@ -168,14 +272,27 @@ int RB_handleWindowEvents(RB_Display* disp) {
 	return 1;
 }
 
+// Clears every displayed pixel back to the background color.
+void RB_clearDisplay(RB_Display* disp) {
+	size_t numPixels = (size_t) disp->pWidth * disp->pHeight;
+	for(size_t i = 0; i < numPixels; i++) {
+		disp->framebuffer[i] = RB_DISPLAY_BACKGROUND;
+	}
+
+	disp->dirtyMinY = 0;
+	disp->dirtyMaxY = disp->pHeight - 1;
+}
+
 // Sets the pixel at the specified coordinate to the specified color
 // Note: This function will convert the color to the displayed color format. You should NOT do that beforehand.
 void RB_setDisplayedPixelColor(RB_Display* disp, RB_Coord coord, RB_Color color) {
-	// Using this type because it is guaranteed to be twice as many bits long as a color channel is;
-	RB_ColorChannel realR = ((RB_ColorSquareDistance) color.r * RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION) / disp->rRes;
-	RB_ColorChannel realG = ((RB_ColorSquareDistance) color.g * RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION) / disp->gRes;
-	RB_ColorChannel realB = ((RB_ColorSquareDistance) color.b * RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION) / disp->bRes;
-	
-	SDL_SetRenderDrawColor(disp->renderer, realR, realG, realB, SDL_ALPHA_OPAQUE);
-	SDL_RenderDrawPoint(disp->renderer, coord.x, coord.y);
+	disp->framebuffer[((size_t) coord.y * disp->pWidth) + coord.x] =
+		disp->rLookup[color.r] | disp->gLookup[color.g] | disp->bLookup[color.b];
+
+	if(coord.y < disp->dirtyMinY) {
+		disp->dirtyMinY = coord.y;
+	}
+	if(coord.y > disp->dirtyMaxY) {
+		disp->dirtyMaxY = coord.y;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,399 @@
+#include "headers/RB_FrameExport.h"
+#include "headers/RB_PixelMap.h"
+#include "headers/RB_PixelRing.h"
+#include "headers/RB_Trace.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How many bytes of delta frame records are encoded before they are written out.
+#define RB_DELTA_WRITE_BUFFER_SIZE (1 << 16)
+// The size of each pixel in a delta frame: x, y, r, g and b.
+#define RB_DELTA_RECORD_SIZE 11
+
+// The pixels that changed during a frame, in the order they changed.
+typedef struct {
+	RB_PixelUpdate* updates;
+	size_t len;
+	size_t capacity;
+	// True if the rainbow was reset during the frame, in which case the frame starts from a black canvas.
+	bool clearsCanvas;
+} FrameDelta;
+
+struct RB_FrameExporter_s {
+	FILE* output;
+	RB_FrameFormat format;
+	RB_Size width;
+	RB_Size height;
+	RB_Size pixelsPerFrame;
+
+	uint8_t rLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint8_t gLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint8_t bLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+
+	// Three deltas rotate between the generating thread (live), the hand-off (pending), and the writer (writing),
+	// so the generating thread can always hand over a frame while the writer is still writing the one before it.
+	FrameDelta deltas[3];
+
+	// Only the generating thread touches these.
+	FrameDelta* live;
+	RB_Size pixelsInFrame;
+
+	// Protected by the mutex.
+	pthread_mutex_t mutex;
+	pthread_cond_t condition;
+	FrameDelta* pending;
+	bool pendingReady;
+	bool stopping;
+
+	// Only the writer thread touches these.
+	FrameDelta* writing;
+	// The whole picture as of the last frame: RGB for raw frames, or the Y, U and V planes for Y4M.
+	// Delta frames don't need it, so it is NULL for them.
+	uint8_t* canvas;
+	uint8_t* deltaBuffer;
+	bool writeFailed;
+
+	atomic_uint_fast64_t numWrittenFrames;
+	atomic_uint_fast64_t numDroppedFrames;
+
+	pthread_t thread;
+	bool threadStarted;
+};
+
+bool appendFrameUpdate(FrameDelta* delta, RB_Coord coord, RB_Color color) {
+	if(delta->len == delta->capacity) {
+		size_t newCapacity = (delta->capacity == 0)? 1024 : delta->capacity * 2;
+		RB_PixelUpdate* newUpdates = (RB_PixelUpdate*) realloc(delta->updates, sizeof(RB_PixelUpdate) * newCapacity);
+
+		if(newUpdates == NULL) {
+			return false;
+		}
+
+		delta->updates = newUpdates;
+		delta->capacity = newCapacity;
+	}
+
+	delta->updates[delta->len] = (RB_PixelUpdate) { .coord = coord, .color = color };
+	delta->len++;
+	return true;
+}
+
+void storeLittleEndian(uint8_t* bytes, uint32_t value) {
+	bytes[0] = (uint8_t) value;
+	bytes[1] = (uint8_t) (value >> 8);
+	bytes[2] = (uint8_t) (value >> 16);
+	bytes[3] = (uint8_t) (value >> 24);
+}
+
+void writeFrameBytes(RB_FrameExporter* exporter, const void* bytes, size_t length) {
+	if(!exporter->writeFailed && fwrite(bytes, 1, length, exporter->output) != length) {
+		fprintf(stderr, "Error exporting frames: cannot write to the output!\n");
+		exporter->writeFailed = true;
+	}
+}
+
+void clearFrameCanvas(RB_FrameExporter* exporter) {
+	size_t planeSize = (size_t) exporter->width * exporter->height;
+
+	if(exporter->format == RB_FRAME_FORMAT_RAW_RGB) {
+		memset(exporter->canvas, 0, planeSize * 3);
+	} else if(exporter->format == RB_FRAME_FORMAT_Y4M) {
+		// Black, in the limited range that Y4M uses by default.
+		memset(exporter->canvas, 16, planeSize);
+		memset(exporter->canvas + planeSize, 128, planeSize * 2);
+	}
+}
+
+void applyFrameUpdate(RB_FrameExporter* exporter, RB_PixelUpdate update) {
+	size_t index = ((size_t) update.coord.y * exporter->width) + update.coord.x;
+	int r = exporter->rLookup[update.color.r];
+	int g = exporter->gLookup[update.color.g];
+	int b = exporter->bLookup[update.color.b];
+
+	if(exporter->format == RB_FRAME_FORMAT_RAW_RGB) {
+		uint8_t* out = exporter->canvas + (index * 3);
+		out[0] = r;
+		out[1] = g;
+		out[2] = b;
+	} else {
+		// BT.601, limited range.
+		size_t planeSize = (size_t) exporter->width * exporter->height;
+		exporter->canvas[index] = (uint8_t) ((((66 * r) + (129 * g) + (25 * b) + 128) >> 8) + 16);
+		exporter->canvas[planeSize + index] = (uint8_t) ((((-38 * r) - (74 * g) + (112 * b) + 128) >> 8) + 128);
+		exporter->canvas[(2 * planeSize) + index] = (uint8_t) ((((112 * r) - (94 * g) - (18 * b) + 128) >> 8) + 128);
+	}
+}
+
+void writeDeltaFrame(RB_FrameExporter* exporter, FrameDelta* delta) {
+	uint8_t frameHeader[5];
+	frameHeader[0] = delta->clearsCanvas? 1 : 0;
+	storeLittleEndian(frameHeader + 1, (uint32_t) delta->len);
+	writeFrameBytes(exporter, frameHeader, 5);
+
+	size_t bufferLen = 0;
+	for(size_t i = 0; i < delta->len; i++) {
+		RB_PixelUpdate update = delta->updates[i];
+		uint8_t* record = exporter->deltaBuffer + bufferLen;
+
+		storeLittleEndian(record, (uint32_t) update.coord.x);
+		storeLittleEndian(record + 4, (uint32_t) update.coord.y);
+		record[8] = exporter->rLookup[update.color.r];
+		record[9] = exporter->gLookup[update.color.g];
+		record[10] = exporter->bLookup[update.color.b];
+		bufferLen += RB_DELTA_RECORD_SIZE;
+
+		if(bufferLen + RB_DELTA_RECORD_SIZE > RB_DELTA_WRITE_BUFFER_SIZE) {
+			writeFrameBytes(exporter, exporter->deltaBuffer, bufferLen);
+			bufferLen = 0;
+		}
+	}
+
+	writeFrameBytes(exporter, exporter->deltaBuffer, bufferLen);
+}
+
+void writeFrame(RB_FrameExporter* exporter, FrameDelta* delta) {
+	RB_TRACE_BEGIN(traceStart);
+
+	if(exporter->format == RB_FRAME_FORMAT_DELTA) {
+		writeDeltaFrame(exporter, delta);
+	} else {
+		if(delta->clearsCanvas) {
+			clearFrameCanvas(exporter);
+		}
+		for(size_t i = 0; i < delta->len; i++) {
+			applyFrameUpdate(exporter, delta->updates[i]);
+		}
+
+		size_t frameSize = (size_t) exporter->width * exporter->height * 3;
+		if(exporter->format == RB_FRAME_FORMAT_Y4M) {
+			writeFrameBytes(exporter, "FRAME\n", 6);
+		}
+		writeFrameBytes(exporter, exporter->canvas, frameSize);
+	}
+
+	atomic_fetch_add(&(exporter->numWrittenFrames), 1);
+	RB_TRACE_END_WITH_ARG(traceStart, "writeFrame", "updates", delta->len);
+}
+
+void* runFrameWriter(void* exporterPtr) {
+	RB_FrameExporter* exporter = (RB_FrameExporter*) exporterPtr;
+	RB_TRACE_THREAD_NAME("frame writer");
+
+	while(true) {
+		pthread_mutex_lock(&(exporter->mutex));
+		while(!exporter->pendingReady && !exporter->stopping) {
+			pthread_cond_wait(&(exporter->condition), &(exporter->mutex));
+		}
+
+		// Anything still pending is written before stopping.
+		if(!exporter->pendingReady) {
+			pthread_mutex_unlock(&(exporter->mutex));
+			break;
+		}
+
+		FrameDelta* toWrite = exporter->pending;
+		exporter->pending = exporter->writing;
+		exporter->writing = toWrite;
+		exporter->pendingReady = false;
+		pthread_cond_broadcast(&(exporter->condition));
+		pthread_mutex_unlock(&(exporter->mutex));
+
+		writeFrame(exporter, toWrite);
+		toWrite->len = 0;
+		toWrite->clearsCanvas = false;
+	}
+
+	fflush(exporter->output);
+	return NULL;
+}
+
+// Hands the live delta over to the writer. If wait is false and the writer hasn't picked up the previous frame yet,
+// the live delta is kept, so that it becomes part of the next frame.
+void publishFrame(RB_FrameExporter* exporter, bool wait) {
+	pthread_mutex_lock(&(exporter->mutex));
+
+	while(wait && exporter->pendingReady) {
+		pthread_cond_wait(&(exporter->condition), &(exporter->mutex));
+	}
+
+	if(exporter->pendingReady) {
+		atomic_fetch_add(&(exporter->numDroppedFrames), 1);
+	} else {
+		FrameDelta* published = exporter->live;
+		exporter->live = exporter->pending;
+		exporter->pending = published;
+		exporter->pendingReady = true;
+		pthread_cond_broadcast(&(exporter->condition));
+	}
+
+	pthread_mutex_unlock(&(exporter->mutex));
+	exporter->pixelsInFrame = 0;
+}
+
+void frameExportPixelObserver(void* exporterPtr, RB_Coord coord, RB_Color color) {
+	RB_FrameExporter* exporter = (RB_FrameExporter*) exporterPtr;
+
+	if(!appendFrameUpdate(exporter->live, coord, color)) {
+		fprintf(stderr, "Error exporting frames: cannot record pixel (%d, %d)!\n", (int) coord.x, (int) coord.y);
+	}
+
+	exporter->pixelsInFrame++;
+	if(exporter->pixelsInFrame >= exporter->pixelsPerFrame) {
+		publishFrame(exporter, false);
+	}
+}
+
+void resetFrameExportObserver(void* exporterPtr) {
+	RB_FrameExporter* exporter = (RB_FrameExporter*) exporterPtr;
+	exporter->live->len = 0;
+	exporter->live->clearsCanvas = true;
+}
+
+void freeFrameExporter(RB_FrameExporter* exporter) {
+	printf("Freeing RB_FrameExporter!\n");
+
+	if(exporter->threadStarted) {
+		if(exporter->live->len > 0 || exporter->live->clearsCanvas) {
+			publishFrame(exporter, true);
+		}
+
+		pthread_mutex_lock(&(exporter->mutex));
+		exporter->stopping = true;
+		pthread_cond_broadcast(&(exporter->condition));
+		pthread_mutex_unlock(&(exporter->mutex));
+
+		pthread_join(exporter->thread, NULL);
+	}
+
+	pthread_mutex_destroy(&(exporter->mutex));
+	pthread_cond_destroy(&(exporter->condition));
+
+	for(int i = 0; i < 3; i++) {
+		free(exporter->deltas[i].updates);
+	}
+	free(exporter->canvas);
+	free(exporter->deltaBuffer);
+	free(exporter);
+}
+
+void freeFrameExportObserver(void* exporterPtr) {
+	freeFrameExporter((RB_FrameExporter*) exporterPtr);
+}
+
+// Writes the part of the stream that comes before the first frame.
+void writeFrameStreamHeader(RB_FrameExporter* exporter) {
+	if(exporter->format == RB_FRAME_FORMAT_Y4M) {
+		char header[128];
+		int headerLength = snprintf(
+			header, sizeof(header),
+			"YUV4MPEG2 W%d H%d F30:1 Ip A1:1 C444\n",
+			(int) exporter->width, (int) exporter->height
+		);
+		writeFrameBytes(exporter, header, headerLength);
+	} else if(exporter->format == RB_FRAME_FORMAT_DELTA) {
+		uint8_t header[16];
+		memcpy(header, "RBDELTA1", 8);
+		storeLittleEndian(header + 8, (uint32_t) exporter->width);
+		storeLittleEndian(header + 12, (uint32_t) exporter->height);
+		writeFrameBytes(exporter, header, 16);
+	}
+}
+
+RB_FrameExporter* RB_attachFrameExporter(RB_Data* data, FILE* output, RB_FrameFormat format, RB_Size pixelsPerFrame) {
+	if(output == NULL || pixelsPerFrame < 1) {
+		fprintf(stderr, "Error creating frame exporter: it needs an output, and at least 1 pixel per frame!\n");
+		return NULL;
+	}
+
+	RB_FrameExporter* ret = (RB_FrameExporter*) calloc(1, sizeof(RB_FrameExporter));
+
+	if(ret == NULL) {
+		fprintf(stderr, "Error creating frame exporter: cannot allocate exporter!\n");
+		return NULL;
+	}
+
+	ret->output = output;
+	ret->format = format;
+	ret->width = data->config.width;
+	ret->height = data->config.height;
+	ret->pixelsPerFrame = pixelsPerFrame;
+	RB_buildChannelLookup(ret->rLookup, data->config.rRes);
+	RB_buildChannelLookup(ret->gLookup, data->config.gRes);
+	RB_buildChannelLookup(ret->bLookup, data->config.bRes);
+
+	ret->live = &(ret->deltas[0]);
+	ret->pending = &(ret->deltas[1]);
+	ret->writing = &(ret->deltas[2]);
+	pthread_mutex_init(&(ret->mutex), NULL);
+	pthread_cond_init(&(ret->condition), NULL);
+	atomic_init(&(ret->numWrittenFrames), 0);
+	atomic_init(&(ret->numDroppedFrames), 0);
+
+	if(format == RB_FRAME_FORMAT_DELTA) {
+		ret->deltaBuffer = (uint8_t*) malloc(RB_DELTA_WRITE_BUFFER_SIZE);
+	} else {
+		ret->canvas = (uint8_t*) malloc((size_t) ret->width * ret->height * 3);
+	}
+
+	if(ret->deltaBuffer == NULL && ret->canvas == NULL) {
+		fprintf(stderr, "Error creating frame exporter: cannot allocate the writer's buffers!\n");
+		freeFrameExporter(ret);
+		return NULL;
+	}
+
+	if(ret->canvas != NULL) {
+		clearFrameCanvas(ret);
+	}
+
+	// Pixels that are already set become part of the first frame. Set pixels that are black look blank anyway.
+	RB_Color* column = (RB_Color*) malloc(sizeof(RB_Color) * ret->height);
+	if(column == NULL) {
+		fprintf(stderr, "Error creating frame exporter: cannot read the pixel map!\n");
+		freeFrameExporter(ret);
+		return NULL;
+	}
+
+	for(RB_Size x = 0; x < ret->width; x++) {
+		RB_readPixelMapColumn(data->pixelMap, x, 0, ret->height, column);
+		for(RB_Size y = 0; y < ret->height; y++) {
+			RB_Color color = column[y];
+			if(color.r != 0 || color.g != 0 || color.b != 0) {
+				appendFrameUpdate(ret->live, (RB_Coord) { .x = x, .y = y }, color);
+			}
+		}
+	}
+	free(column);
+
+	writeFrameStreamHeader(ret);
+
+	if(pthread_create(&(ret->thread), NULL, runFrameWriter, ret) != 0) {
+		fprintf(stderr, "Error creating frame exporter: cannot start the writer thread!\n");
+		freeFrameExporter(ret);
+		return NULL;
+	}
+	ret->threadStarted = true;
+
+	RB_PixelObserver observer = {
+		.onPixelSet = frameExportPixelObserver,
+		.onReset = resetFrameExportObserver,
+		.onFree = freeFrameExportObserver,
+		.userData = ret
+	};
+
+	if(!RB_addPixelObserver(data, observer)) {
+		freeFrameExporter(ret);
+		return NULL;
+	}
+
+	return ret;
+}
+
+uint64_t RB_getWrittenFrameCount(RB_FrameExporter* exporter) {
+	return atomic_load(&(exporter->numWrittenFrames));
+}
+
+uint64_t RB_getDroppedFrameCount(RB_FrameExporter* exporter) {
+	return atomic_load(&(exporter->numDroppedFrames));
+}
@@ -0,0 +1,203 @@
+#include "headers/RB_GenerationPipeline.h"
+#include "headers/RB_PixelRing.h"
+#include "headers/RB_Trace.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+// How many updates the display thread copies out of the ring at a time.
+#define RB_PIPELINE_DRAIN_BATCH 1024
+// How many pixels the generation thread generates between checks of whether it should stop.
+#define RB_PIPELINE_GENERATION_CHUNK 256
+// How many batches the display thread drains before drawing a frame, so that a frame is never held up for too long.
+#define RB_PIPELINE_MAX_DRAIN_BATCHES 256
+
+struct RB_GenerationPipeline_s {
+	RB_Data* data;
+	RB_Display* display;
+	RB_PixelRing* ring;
+
+	// Updates that didn't fit in the ring, oldest first. Only the generation thread touches these.
+	RB_PixelUpdate* backlog;
+	size_t backlogStart;
+	size_t backlogLen;
+	size_t backlogCapacity;
+
+	pthread_t thread;
+	bool threadStarted;
+	atomic_bool stopRequested;
+	// Set once every update has been pushed into the ring.
+	atomic_bool finished;
+};
+
+// Moves as much of the backlog into the ring as will fit. Returns true if the backlog is now empty.
+bool flushPipelineBacklog(RB_GenerationPipeline* pipeline) {
+	while(pipeline->backlogStart < pipeline->backlogLen) {
+		if(!RB_pushPixelUpdate(pipeline->ring, pipeline->backlog[pipeline->backlogStart])) {
+			return false;
+		}
+		pipeline->backlogStart++;
+	}
+
+	pipeline->backlogStart = 0;
+	pipeline->backlogLen = 0;
+	return true;
+}
+
+void pipelinePixelObserver(void* pipelinePtr, RB_Coord coord, RB_Color color) {
+	RB_GenerationPipeline* pipeline = (RB_GenerationPipeline*) pipelinePtr;
+	RB_PixelUpdate update = { .coord = coord, .color = color };
+
+	// Updates have to reach the display in order, so nothing skips ahead of the backlog.
+	if(flushPipelineBacklog(pipeline) && RB_pushPixelUpdate(pipeline->ring, update)) {
+		return;
+	}
+
+	if(pipeline->backlogLen == pipeline->backlogCapacity) {
+		size_t newCapacity = (pipeline->backlogCapacity == 0)? RB_PIPELINE_DRAIN_BATCH : pipeline->backlogCapacity * 2;
+		RB_PixelUpdate* newBacklog = (RB_PixelUpdate*) realloc(pipeline->backlog, sizeof(RB_PixelUpdate) * newCapacity);
+
+		if(newBacklog == NULL) {
+			// There's nowhere to put the update, so the only options are to drop it or to wait for the display.
+			fprintf(stderr, "Error in generation pipeline: cannot grow backlog, waiting for the display!\n");
+			while(!RB_pushPixelUpdate(pipeline->ring, update)) {
+				sched_yield();
+			}
+			return;
+		}
+
+		pipeline->backlog = newBacklog;
+		pipeline->backlogCapacity = newCapacity;
+	}
+
+	pipeline->backlog[pipeline->backlogLen] = update;
+	pipeline->backlogLen++;
+}
+
+void* runGenerationPipeline(void* pipelinePtr) {
+	RB_GenerationPipeline* pipeline = (RB_GenerationPipeline*) pipelinePtr;
+	RB_TRACE_THREAD_NAME("generation pipeline");
+
+	// Generating in chunks means the stop flag only has to be checked once per chunk.
+	while(!atomic_load_explicit(&(pipeline->stopRequested), memory_order_relaxed)) {
+		if(RB_generatePixels(pipeline->data, RB_PIPELINE_GENERATION_CHUNK) < RB_PIPELINE_GENERATION_CHUNK) {
+			break;
+		}
+	}
+
+	// The rainbow is finished, so the only thing left to do is wait for the display to make room for the backlog.
+	struct timespec pause = { .tv_sec = 0, .tv_nsec = 1000000 };
+	while(!flushPipelineBacklog(pipeline) && !atomic_load(&(pipeline->stopRequested))) {
+		nanosleep(&pause, NULL);
+	}
+
+	atomic_store(&(pipeline->finished), true);
+	return NULL;
+}
+
+RB_GenerationPipeline* RB_createGenerationPipeline(RB_Data* data, RB_Display* display, size_t ringCapacity) {
+	RB_GenerationPipeline* ret = (RB_GenerationPipeline*) malloc(sizeof(RB_GenerationPipeline));
+
+	if(ret == NULL) {
+		fprintf(stderr, "Error creating generation pipeline: cannot allocate pipeline!\n");
+		return NULL;
+	}
+
+	ret->data = data;
+	ret->display = display;
+	ret->backlog = NULL;
+	ret->backlogStart = 0;
+	ret->backlogLen = 0;
+	ret->backlogCapacity = 0;
+	ret->threadStarted = false;
+	atomic_init(&(ret->stopRequested), false);
+	atomic_init(&(ret->finished), false);
+
+	ret->ring = RB_createPixelRing(ringCapacity);
+
+	if(ret->ring == NULL) {
+		free(ret);
+		return NULL;
+	}
+
+	RB_PixelObserver observer = {
+		.onPixelSet = pipelinePixelObserver,
+		.onReset = NULL,
+		.onFree = NULL,
+		.userData = ret
+	};
+
+	if(!RB_addPixelObserver(data, observer)) {
+		RB_freePixelRing(ret->ring);
+		free(ret);
+		return NULL;
+	}
+
+	return ret;
+}
+
+bool RB_startGenerationPipeline(RB_GenerationPipeline* pipeline) {
+	if(pipeline->threadStarted) {
+		fprintf(stderr, "Error starting generation pipeline: it has already been started!\n");
+		return false;
+	}
+
+	if(pthread_create(&(pipeline->thread), NULL, runGenerationPipeline, pipeline) != 0) {
+		fprintf(stderr, "Error starting generation pipeline: cannot create thread!\n");
+		return false;
+	}
+
+	pipeline->threadStarted = true;
+	return true;
+}
+
+bool RB_drainGenerationPipeline(RB_GenerationPipeline* pipeline) {
+	// Checked before draining, so that nothing pushed before the generation thread finished can be missed.
+	bool finished = atomic_load(&(pipeline->finished));
+	RB_TRACE_BEGIN(traceStart);
+
+	RB_PixelUpdate updates[RB_PIPELINE_DRAIN_BATCH];
+	size_t numUpdates;
+	size_t totalUpdates = 0;
+	int numBatches = 0;
+	do {
+		numUpdates = RB_popPixelUpdates(pipeline->ring, updates, RB_PIPELINE_DRAIN_BATCH);
+		for(size_t i = 0; i < numUpdates; i++) {
+			RB_setDisplayedPixelColor(pipeline->display, updates[i].coord, updates[i].color);
+		}
+		totalUpdates += numUpdates;
+		numBatches++;
+		// Once generation has finished, nothing else is coming, so the ring is always drained completely.
+	} while(numUpdates == RB_PIPELINE_DRAIN_BATCH && (finished || numBatches < RB_PIPELINE_MAX_DRAIN_BATCHES));
+
+	RB_TRACE_END_WITH_ARG(traceStart, "drainGenerationPipeline", "updates", totalUpdates);
+
+	if(finished) {
+		RB_forceUpdateDisplay(pipeline->display, false);
+		return false;
+	}
+
+	RB_updateDisplay(pipeline->display);
+	return true;
+}
+
+void RB_freeGenerationPipeline(RB_GenerationPipeline* pipeline) {
+	if(pipeline == NULL) {
+		return;
+	}
+
+	printf("Freeing RB_GenerationPipeline!\n");
+
+	atomic_store(&(pipeline->stopRequested), true);
+	if(pipeline->threadStarted) {
+		pthread_join(pipeline->thread, NULL);
+	}
+
+	RB_removePixelObserver(pipeline->data, pipeline);
+	RB_freePixelRing(pipeline->ring);
+	free(pipeline->backlog);
+	free(pipeline);
+}
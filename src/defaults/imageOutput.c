@@ -0,0 +1,375 @@
+#include "headers/RB_ImageOutput.h"
+#include "headers/RB_PixelMap.h"
+#include "headers/RB_Clock.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// How many rows are read out of the pixel map at a time. Reading a whole band a column at a time reads the map in the
+// order it is stored in, and matches the height of a tile.
+#define RB_IMAGE_BAND_ROWS 64
+
+// The largest amount of data a single stored deflate block can hold.
+#define RB_DEFLATE_MAX_STORED_BLOCK 65535
+// How much image data is collected before it is written out as an IDAT chunk.
+#define RB_PNG_IDAT_SIZE (1 << 20)
+
+typedef struct {
+	RB_Data* data;
+	RB_Size width;
+	RB_Size height;
+
+	// Every value of each channel, rescaled to 8 bits.
+	uint8_t rLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint8_t gLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint8_t bLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+
+	RB_Color* columnBuffer;
+	// Up to RB_IMAGE_BAND_ROWS rows, each of which starts with rowPrefix bytes of zeroes.
+	uint8_t* band;
+	size_t rowPrefix;
+	size_t rowStride;
+} ImageBandReader;
+
+bool createImageBandReader(ImageBandReader* reader, RB_Data* data, size_t rowPrefix) {
+	RB_Config* config = &(data->config);
+
+	reader->data = data;
+	reader->width = config->width;
+	reader->height = config->height;
+	reader->rowPrefix = rowPrefix;
+	reader->rowStride = rowPrefix + ((size_t) config->width * 3);
+
+	RB_buildChannelLookup(reader->rLookup, config->rRes);
+	RB_buildChannelLookup(reader->gLookup, config->gRes);
+	RB_buildChannelLookup(reader->bLookup, config->bRes);
+
+	reader->columnBuffer = (RB_Color*) malloc(sizeof(RB_Color) * RB_IMAGE_BAND_ROWS);
+	reader->band = (uint8_t*) calloc(RB_IMAGE_BAND_ROWS, reader->rowStride);
+
+	if(reader->columnBuffer == NULL || reader->band == NULL) {
+		fprintf(stderr, "Error writing image: cannot allocate band of %d rows!\n", RB_IMAGE_BAND_ROWS);
+		free(reader->columnBuffer);
+		free(reader->band);
+		return false;
+	}
+
+	return true;
+}
+
+void freeImageBandReader(ImageBandReader* reader) {
+	free(reader->columnBuffer);
+	free(reader->band);
+}
+
+// Reads the band of rows starting at row y into the reader's band, and returns how many rows are in it.
+RB_Size readImageBand(ImageBandReader* reader, RB_Size y) {
+	RB_Size numRows = reader->height - y;
+	if(numRows > RB_IMAGE_BAND_ROWS) {
+		numRows = RB_IMAGE_BAND_ROWS;
+	}
+
+	for(RB_Size x = 0; x < reader->width; x++) {
+		RB_readPixelMapColumn(reader->data->pixelMap, x, y, numRows, reader->columnBuffer);
+
+		uint8_t* out = reader->band + reader->rowPrefix + ((size_t) x * 3);
+		for(RB_Size row = 0; row < numRows; row++) {
+			RB_Color color = reader->columnBuffer[row];
+			out[0] = reader->rLookup[color.r];
+			out[1] = reader->gLookup[color.g];
+			out[2] = reader->bLookup[color.b];
+			out += reader->rowStride;
+		}
+	}
+
+	return numRows;
+}
+
+void finishImageReport(
+	const char* format,
+	const char* path,
+	const ImageBandReader* reader,
+	uint64_t numBytes,
+	double startTime,
+	RB_ImageReport* report
+) {
+	double seconds = RB_getMonotonicSeconds() - startTime;
+	double numPixels = (double) reader->width * reader->height;
+	double megapixelsPerSecond = (seconds > 0)? (numPixels / 1000000.0) / seconds : 0;
+	double megabytesPerSecond = (seconds > 0)? ((double) numBytes / 1000000.0) / seconds : 0;
+
+	printf(
+		"Wrote %s to %s.\n"
+		"| %llu bytes in %.3f s (%.1f megapixels/s, %.1f MB/s).\n",
+		format, path,
+		(unsigned long long) numBytes, seconds, megapixelsPerSecond, megabytesPerSecond
+	);
+
+	if(report != NULL) {
+		*report = (RB_ImageReport) {
+			.numBytes = numBytes,
+			.seconds = seconds,
+			.megapixelsPerSecond = megapixelsPerSecond,
+			.megabytesPerSecond = megabytesPerSecond
+		};
+	}
+}
+
+bool RB_writePPM(RB_Data* data, const char* path, RB_ImageReport* report) {
+	double startTime = RB_getMonotonicSeconds();
+
+	ImageBandReader reader;
+	if(!createImageBandReader(&reader, data, 0)) {
+		return false;
+	}
+
+	FILE* file = fopen(path, "wb");
+	if(file == NULL) {
+		fprintf(stderr, "Error writing PPM: cannot open %s!\n", path);
+		freeImageBandReader(&reader);
+		return false;
+	}
+
+	int headerLength = fprintf(file, "P6\n%d %d\n255\n", (int) reader.width, (int) reader.height);
+	bool success = headerLength > 0;
+	uint64_t numBytes = (headerLength > 0)? headerLength : 0;
+
+	for(RB_Size y = 0; success && y < reader.height; y += RB_IMAGE_BAND_ROWS) {
+		RB_Size numRows = readImageBand(&reader, y);
+		size_t bandSize = reader.rowStride * numRows;
+		success = fwrite(reader.band, 1, bandSize, file) == bandSize;
+		numBytes += bandSize;
+	}
+
+	success = (fclose(file) == 0) && success;
+	freeImageBandReader(&reader);
+
+	if(!success) {
+		fprintf(stderr, "Error writing PPM: cannot write to %s!\n", path);
+		return false;
+	}
+
+	finishImageReport("PPM", path, &reader, numBytes, startTime, report);
+	return true;
+}
+
+
+// PNG OUTPUT:
+
+typedef struct {
+	FILE* file;
+	bool failed;
+	uint64_t numBytes;
+
+	uint32_t crcTable[256];
+
+	// The data of the IDAT chunk that is being collected.
+	uint8_t* idat;
+	size_t idatLen;
+
+	// The zlib stream's running Adler-32 checksum.
+	uint32_t adlerA;
+	uint32_t adlerB;
+	// How much uncompressed data is left to write, in total and in the current stored block.
+	uint64_t deflateRemaining;
+	size_t blockRemaining;
+} PNGWriter;
+
+void initializeCRCTable(uint32_t* table) {
+	for(uint32_t i = 0; i < 256; i++) {
+		uint32_t crc = i;
+		for(int bit = 0; bit < 8; bit++) {
+			crc = (crc & 1)? (0xEDB88320 ^ (crc >> 1)) : (crc >> 1);
+		}
+		table[i] = crc;
+	}
+}
+
+uint32_t updateCRC(const uint32_t* table, uint32_t crc, const uint8_t* bytes, size_t length) {
+	for(size_t i = 0; i < length; i++) {
+		crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+void updateAdler(PNGWriter* writer, const uint8_t* bytes, size_t length) {
+	// 5552 is the most bytes that can be summed before b could overflow 32 bits, so the expensive modulo is only done
+	// once per 5552 bytes.
+	uint32_t a = writer->adlerA;
+	uint32_t b = writer->adlerB;
+
+	while(length > 0) {
+		size_t chunkLength = (length < 5552)? length : 5552;
+		for(size_t i = 0; i < chunkLength; i++) {
+			a += bytes[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		bytes += chunkLength;
+		length -= chunkLength;
+	}
+
+	writer->adlerA = a;
+	writer->adlerB = b;
+}
+
+void storeBigEndian(uint8_t* bytes, uint32_t value) {
+	bytes[0] = (uint8_t) (value >> 24);
+	bytes[1] = (uint8_t) (value >> 16);
+	bytes[2] = (uint8_t) (value >> 8);
+	bytes[3] = (uint8_t) value;
+}
+
+void writePNGBytes(PNGWriter* writer, const void* bytes, size_t length) {
+	if(!writer->failed && fwrite(bytes, 1, length, writer->file) != length) {
+		writer->failed = true;
+	}
+	writer->numBytes += length;
+}
+
+void writePNGChunk(PNGWriter* writer, const char* type, const uint8_t* chunkData, size_t length) {
+	uint8_t header[8];
+	storeBigEndian(header, (uint32_t) length);
+	memcpy(header + 4, type, 4);
+
+	uint32_t crc = updateCRC(writer->crcTable, 0xFFFFFFFF, header + 4, 4);
+	crc = updateCRC(writer->crcTable, crc, chunkData, length) ^ 0xFFFFFFFF;
+
+	uint8_t footer[4];
+	storeBigEndian(footer, crc);
+
+	writePNGBytes(writer, header, 8);
+	writePNGBytes(writer, chunkData, length);
+	writePNGBytes(writer, footer, 4);
+}
+
+void flushPNGImageData(PNGWriter* writer) {
+	if(writer->idatLen > 0) {
+		writePNGChunk(writer, "IDAT", writer->idat, writer->idatLen);
+		writer->idatLen = 0;
+	}
+}
+
+// Adds part of the zlib stream to the image data, splitting it into IDAT chunks as needed.
+void writePNGImageData(PNGWriter* writer, const uint8_t* bytes, size_t length) {
+	while(length > 0) {
+		size_t toCopy = RB_PNG_IDAT_SIZE - writer->idatLen;
+		if(toCopy > length) {
+			toCopy = length;
+		}
+
+		memcpy(writer->idat + writer->idatLen, bytes, toCopy);
+		writer->idatLen += toCopy;
+		bytes += toCopy;
+		length -= toCopy;
+
+		if(writer->idatLen == RB_PNG_IDAT_SIZE) {
+			flushPNGImageData(writer);
+		}
+	}
+}
+
+// Adds uncompressed data to the zlib stream as stored blocks. Since the total length is known up front, each block's
+// header can be written as soon as the block starts, so nothing has to be held back.
+void deflatePNGImageData(PNGWriter* writer, const uint8_t* bytes, size_t length) {
+	updateAdler(writer, bytes, length);
+
+	while(length > 0) {
+		if(writer->blockRemaining == 0) {
+			size_t blockLength = (writer->deflateRemaining < RB_DEFLATE_MAX_STORED_BLOCK)?
+				writer->deflateRemaining : RB_DEFLATE_MAX_STORED_BLOCK;
+			bool isFinal = blockLength == writer->deflateRemaining;
+
+			uint8_t blockHeader[5] = {
+				isFinal? 1 : 0,
+				(uint8_t) blockLength,
+				(uint8_t) (blockLength >> 8),
+				(uint8_t) ~blockLength,
+				(uint8_t) (~blockLength >> 8)
+			};
+			writePNGImageData(writer, blockHeader, 5);
+			writer->blockRemaining = blockLength;
+		}
+
+		size_t toWrite = (length < writer->blockRemaining)? length : writer->blockRemaining;
+		writePNGImageData(writer, bytes, toWrite);
+		writer->blockRemaining -= toWrite;
+		writer->deflateRemaining -= toWrite;
+		bytes += toWrite;
+		length -= toWrite;
+	}
+}
+
+bool RB_writePNG(RB_Data* data, const char* path, RB_ImageReport* report) {
+	double startTime = RB_getMonotonicSeconds();
+
+	// Every row of a PNG starts with the filter type. 0 means the row isn't filtered.
+	ImageBandReader reader;
+	if(!createImageBandReader(&reader, data, 1)) {
+		return false;
+	}
+
+	PNGWriter writer = {
+		.failed = false,
+		.numBytes = 0,
+		.idatLen = 0,
+		.adlerA = 1,
+		.adlerB = 0,
+		.deflateRemaining = (uint64_t) reader.rowStride * reader.height,
+		.blockRemaining = 0
+	};
+	initializeCRCTable(writer.crcTable);
+
+	writer.idat = (uint8_t*) malloc(RB_PNG_IDAT_SIZE);
+	if(writer.idat == NULL) {
+		fprintf(stderr, "Error writing PNG: cannot allocate IDAT buffer!\n");
+		freeImageBandReader(&reader);
+		return false;
+	}
+
+	writer.file = fopen(path, "wb");
+	if(writer.file == NULL) {
+		fprintf(stderr, "Error writing PNG: cannot open %s!\n", path);
+		free(writer.idat);
+		freeImageBandReader(&reader);
+		return false;
+	}
+
+	const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	writePNGBytes(&writer, signature, 8);
+
+	// 8 bits per channel, truecolor, default compression and filtering, not interlaced.
+	uint8_t header[13] = { 0, 0, 0, 0, 0, 0, 0, 0, 8, 2, 0, 0, 0 };
+	storeBigEndian(header, (uint32_t) reader.width);
+	storeBigEndian(header + 4, (uint32_t) reader.height);
+	writePNGChunk(&writer, "IHDR", header, 13);
+
+	// Deflate, with a 32K window, and no preset dictionary. 0x7801 is a multiple of 31, as the header has to be.
+	const uint8_t zlibHeader[2] = { 0x78, 0x01 };
+	writePNGImageData(&writer, zlibHeader, 2);
+
+	for(RB_Size y = 0; !writer.failed && y < reader.height; y += RB_IMAGE_BAND_ROWS) {
+		RB_Size numRows = readImageBand(&reader, y);
+		deflatePNGImageData(&writer, reader.band, reader.rowStride * numRows);
+	}
+
+	uint8_t adler[4];
+	storeBigEndian(adler, (writer.adlerB << 16) | writer.adlerA);
+	writePNGImageData(&writer, adler, 4);
+	flushPNGImageData(&writer);
+
+	writePNGChunk(&writer, "IEND", NULL, 0);
+
+	bool success = (fclose(writer.file) == 0) && !writer.failed;
+	free(writer.idat);
+	freeImageBandReader(&reader);
+
+	if(!success) {
+		fprintf(stderr, "Error writing PNG: cannot write to %s!\n", path);
+		return false;
+	}
+
+	finishImageReport("PNG", path, &reader, writer.numBytes, startTime, report);
+	return true;
+}
@@ -0,0 +1,161 @@
+#include "headers/RB_MappedCanvas.h"
+#include "headers/RB_PixelMap.h"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Long enough for the header of the largest possible image.
+#define RB_CANVAS_MAX_HEADER_LENGTH 64
+
+struct RB_MappedCanvas_s {
+	// The whole file. The pixels start right after the header, one row after another, 3 bytes per pixel.
+	uint8_t* mapping;
+	size_t mappingLength;
+	uint8_t* pixels;
+	RB_Size width;
+	RB_Size height;
+
+	uint8_t rLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint8_t gLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint8_t bLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+};
+
+void writeMappedCanvasPixel(RB_MappedCanvas* canvas, RB_Coord coord, RB_Color color) {
+	uint8_t* out = canvas->pixels + ((((size_t) coord.y * canvas->width) + coord.x) * 3);
+	out[0] = canvas->rLookup[color.r];
+	out[1] = canvas->gLookup[color.g];
+	out[2] = canvas->bLookup[color.b];
+}
+
+void mappedCanvasPixelObserver(void* canvasPtr, RB_Coord coord, RB_Color color) {
+	writeMappedCanvasPixel((RB_MappedCanvas*) canvasPtr, coord, color);
+}
+
+void resetMappedCanvasObserver(void* canvasPtr) {
+	RB_MappedCanvas* canvas = (RB_MappedCanvas*) canvasPtr;
+	memset(canvas->pixels, 0, (size_t) canvas->width * canvas->height * 3);
+}
+
+void freeMappedCanvas(RB_MappedCanvas* canvas) {
+	printf("Freeing RB_MappedCanvas!\n");
+	if(canvas->mapping != NULL) {
+		munmap(canvas->mapping, canvas->mappingLength);
+	}
+	free(canvas);
+}
+
+void freeMappedCanvasObserver(void* canvasPtr) {
+	freeMappedCanvas((RB_MappedCanvas*) canvasPtr);
+}
+
+// Frees a canvas that couldn't be attached, and removes its file, which would otherwise be left behind as a black
+// image of the full size.
+void abandonMappedCanvas(RB_MappedCanvas* canvas, const char* path) {
+	freeMappedCanvas(canvas);
+	unlink(path);
+}
+
+// Copies the pixels that are already set into the canvas.
+void copyPixelMapToMappedCanvas(RB_MappedCanvas* canvas, RB_PixelMap* map) {
+	RB_Color* column = (RB_Color*) malloc(sizeof(RB_Color) * canvas->height);
+
+	for(RB_Size x = 0; x < canvas->width; x++) {
+		if(column != NULL) {
+			RB_readPixelMapColumn(map, x, 0, canvas->height, column);
+		}
+
+		for(RB_Size y = 0; y < canvas->height; y++) {
+			RB_Color color;
+			if(column != NULL) {
+				color = column[y];
+			} else {
+				RB_readPixelMapColumn(map, x, y, 1, &color);
+			}
+
+			// The file starts out black, so writing black pixels would only dirty pages for nothing.
+			if(color.r != 0 || color.g != 0 || color.b != 0) {
+				writeMappedCanvasPixel(canvas, (RB_Coord) { .x = x, .y = y }, color);
+			}
+		}
+	}
+
+	free(column);
+}
+
+RB_MappedCanvas* RB_attachMappedCanvas(RB_Data* data, const char* path) {
+	RB_MappedCanvas* ret = (RB_MappedCanvas*) malloc(sizeof(RB_MappedCanvas));
+
+	if(ret == NULL) {
+		fprintf(stderr, "Error creating mapped canvas: cannot allocate canvas!\n");
+		return NULL;
+	}
+
+	ret->mapping = NULL;
+	ret->width = data->config.width;
+	ret->height = data->config.height;
+	RB_buildChannelLookup(ret->rLookup, data->config.rRes);
+	RB_buildChannelLookup(ret->gLookup, data->config.gRes);
+	RB_buildChannelLookup(ret->bLookup, data->config.bRes);
+
+	char header[RB_CANVAS_MAX_HEADER_LENGTH];
+	int headerLength = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", (int) ret->width, (int) ret->height);
+	ret->mappingLength = headerLength + ((size_t) ret->width * ret->height * 3);
+
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0) {
+		fprintf(stderr, "Error creating mapped canvas: cannot open %s!\n", path);
+		freeMappedCanvas(ret);
+		return NULL;
+	}
+
+	// Extending the file fills it with zeroes (which are black) without writing them, so the file starts out sparse.
+	if(ftruncate(fd, (off_t) ret->mappingLength) != 0) {
+		fprintf(stderr, "Error creating mapped canvas: cannot resize %s to %zu bytes!\n", path, ret->mappingLength);
+		close(fd);
+		abandonMappedCanvas(ret, path);
+		return NULL;
+	}
+
+	void* mapping = mmap(NULL, ret->mappingLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	// The mapping keeps the file open by itself.
+	close(fd);
+
+	if(mapping == MAP_FAILED) {
+		fprintf(stderr, "Error creating mapped canvas: cannot map %s!\n", path);
+		abandonMappedCanvas(ret, path);
+		return NULL;
+	}
+
+	ret->mapping = (uint8_t*) mapping;
+	memcpy(ret->mapping, header, headerLength);
+	ret->pixels = ret->mapping + headerLength;
+
+	copyPixelMapToMappedCanvas(ret, data->pixelMap);
+
+	RB_PixelObserver observer = {
+		.onPixelSet = mappedCanvasPixelObserver,
+		.onReset = resetMappedCanvasObserver,
+		.onFree = freeMappedCanvasObserver,
+		.userData = ret
+	};
+
+	if(!RB_addPixelObserver(data, observer)) {
+		abandonMappedCanvas(ret, path);
+		return NULL;
+	}
+
+	return ret;
+}
+
+bool RB_syncMappedCanvas(RB_MappedCanvas* canvas) {
+	if(msync(canvas->mapping, canvas->mappingLength, MS_SYNC) != 0) {
+		fprintf(stderr, "Error syncing mapped canvas!\n");
+		return false;
+	}
+
+	return true;
+}
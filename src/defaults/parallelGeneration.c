@@ -0,0 +1,287 @@
+#include "headers/RB_ParallelGeneration.h"
+#include "headers/RB_AssignmentQueue.h"
+#include "headers/RB_ColorPool.h"
+#include "headers/RB_PixelMap.h"
+#include "headers/RB_Random.h"
+#include "headers/RB_Trace.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+typedef struct {
+	RB_Coord coord;
+	RB_Color idealColor;
+} ParallelClaim;
+
+typedef struct {
+	RB_ParallelGenerator* generator;
+	// Worker i handles claims i, i + numThreads, i + (2 * numThreads), and so on.
+	int index;
+	pthread_t thread;
+	bool threadStarted;
+
+	RB_ColorPoolSearch* search;
+	RB_Random random;
+	// True if one of the worker's searches failed this round, which leaves its claims without ideal colors.
+	bool searchFailed;
+} ParallelWorker;
+
+struct RB_ParallelGenerator_s {
+	RB_Data* data;
+
+	int numThreads;
+	RB_Size claimsPerThread;
+
+	ParallelClaim* claims;
+	RB_Size numClaims;
+	RB_Size numConflicts;
+
+	// Worker 0 is the thread calling RB_generateNextPixelsInParallel. The rest each have their own thread.
+	ParallelWorker* workers;
+
+	pthread_mutex_t lock;
+	pthread_cond_t roundStarted;
+	pthread_cond_t roundFinished;
+	unsigned long roundNumber;
+	int workersFinished;
+	bool shuttingDown;
+};
+
+// Determines the preferred and ideal colors of each of the worker's claims.
+// Nothing modifies the pixel map or the color pool while this runs, so every worker can do this at once.
+void processParallelClaims(ParallelWorker* worker) {
+	RB_ParallelGenerator* generator = worker->generator;
+	RB_Data* data = generator->data;
+	RB_TRACE_BEGIN(traceStart);
+
+	worker->searchFailed = false;
+	for(RB_Size i = worker->index; i < generator->numClaims; i += generator->numThreads) {
+		ParallelClaim* claim = &(generator->claims[i]);
+		RB_Color preferredColor = RB_determinePreferredCoordColor(data->pixelMap, claim->coord);
+		if(!RB_searchForIdealAvailableColor(
+			data->colorPool, worker->search, preferredColor, &(worker->random), &(claim->idealColor)
+		)) {
+			worker->searchFailed = true;
+			break;
+		}
+	}
+
+	RB_TRACE_END(traceStart, "processParallelClaims");
+}
+
+void* runParallelWorker(void* workerPtr) {
+	ParallelWorker* worker = (ParallelWorker*) workerPtr;
+	RB_ParallelGenerator* generator = worker->generator;
+	unsigned long lastRound = 0;
+	RB_TRACE_THREAD_NAME("parallel worker");
+
+	while(true) {
+		pthread_mutex_lock(&(generator->lock));
+		while(generator->roundNumber == lastRound && !generator->shuttingDown) {
+			pthread_cond_wait(&(generator->roundStarted), &(generator->lock));
+		}
+		if(generator->shuttingDown) {
+			pthread_mutex_unlock(&(generator->lock));
+			return NULL;
+		}
+		lastRound = generator->roundNumber;
+		pthread_mutex_unlock(&(generator->lock));
+
+		processParallelClaims(worker);
+
+		pthread_mutex_lock(&(generator->lock));
+		generator->workersFinished++;
+		if(generator->workersFinished == generator->numThreads - 1) {
+			pthread_cond_signal(&(generator->roundFinished));
+		}
+		pthread_mutex_unlock(&(generator->lock));
+	}
+}
+
+RB_ParallelGenerator* RB_createParallelGenerator(RB_Data* data, int numThreads, RB_Size claimsPerThread) {
+	if(numThreads < 1 || claimsPerThread < 1) {
+		fprintf(
+			stderr,
+			"Error creating parallel generator: there must be at least one thread and one claim per thread!\n"
+			"numThreads = %d, claimsPerThread = %ld\n",
+			numThreads, (long) claimsPerThread
+		);
+		return NULL;
+	}
+
+	RB_ParallelGenerator* ret = (RB_ParallelGenerator*) malloc(
+		sizeof(RB_ParallelGenerator)
+		+ (sizeof(ParallelWorker) * numThreads)
+		+ (sizeof(ParallelClaim) * numThreads * claimsPerThread)
+	);
+
+	if(ret == NULL) {
+		fprintf(stderr, "Error creating parallel generator: cannot allocate generator!\n");
+		return NULL;
+	}
+
+	ret->data = data;
+	ret->numThreads = numThreads;
+	ret->claimsPerThread = claimsPerThread;
+	ret->numClaims = 0;
+	ret->numConflicts = 0;
+	ret->roundNumber = 0;
+	ret->workersFinished = 0;
+	ret->shuttingDown = false;
+
+	ret->workers = (ParallelWorker*) (ret + 1);
+	ret->claims = (ParallelClaim*) (ret->workers + numThreads);
+
+	pthread_mutex_init(&(ret->lock), NULL);
+	pthread_cond_init(&(ret->roundStarted), NULL);
+	pthread_cond_init(&(ret->roundFinished), NULL);
+
+	// The workers' generators are seeded from the rainbow's, so the whole generation still depends only on its seed.
+	for(int i = 0; i < numThreads; i++) {
+		ParallelWorker* worker = &(ret->workers[i]);
+		worker->generator = ret;
+		worker->index = i;
+		worker->threadStarted = false;
+		worker->searchFailed = false;
+		worker->search = RB_createColorPoolSearch();
+		RB_seedRandom(&(worker->random), RB_nextRandom(&(data->random)));
+
+		if(worker->search == NULL) {
+			fprintf(stderr, "Error creating parallel generator: cannot allocate a color pool search!\n");
+			RB_freeParallelGenerator(ret);
+			return NULL;
+		}
+	}
+
+	for(int i = 1; i < numThreads; i++) {
+		ParallelWorker* worker = &(ret->workers[i]);
+
+		if(pthread_create(&(worker->thread), NULL, runParallelWorker, worker) != 0) {
+			fprintf(stderr, "Error creating parallel generator: cannot start worker thread %d!\n", i);
+			RB_freeParallelGenerator(ret);
+			return NULL;
+		}
+		worker->threadStarted = true;
+	}
+
+	return ret;
+}
+
+void RB_freeParallelGenerator(RB_ParallelGenerator* generator) {
+	if(generator == NULL) {
+		return;
+	}
+
+	printf("Freeing RB_ParallelGenerator!\n");
+
+	pthread_mutex_lock(&(generator->lock));
+	generator->shuttingDown = true;
+	pthread_cond_broadcast(&(generator->roundStarted));
+	pthread_mutex_unlock(&(generator->lock));
+
+	for(int i = 0; i < generator->numThreads; i++) {
+		ParallelWorker* worker = &(generator->workers[i]);
+		if(worker->threadStarted) {
+			pthread_join(worker->thread, NULL);
+		}
+		RB_freeColorPoolSearch(worker->search);
+	}
+
+	pthread_cond_destroy(&(generator->roundFinished));
+	pthread_cond_destroy(&(generator->roundStarted));
+	pthread_mutex_destroy(&(generator->lock));
+
+	free(generator);
+}
+
+// Puts the claims from the specified one on back in the queue, since the round was abandoned before they were set.
+void returnParallelClaims(RB_ParallelGenerator* generator, RB_Size firstClaim) {
+	for(RB_Size i = firstClaim; i < generator->numClaims; i++) {
+		RB_addCoordToAssignmentQueue(generator->data->assignmentQueue, generator->claims[i].coord, -1);
+	}
+	generator->numClaims = firstClaim;
+}
+
+bool RB_generateNextPixelsInParallel(RB_ParallelGenerator* generator) {
+	RB_Data* data = generator->data;
+	RB_AssignmentQueue* queue = data->assignmentQueue;
+	RB_TRACE_BEGIN(traceStart);
+
+	// CLAIM
+	// Removing the claimed coords from the queue guarantees that every claim in the round is distinct.
+	RB_Size maxClaims = generator->numThreads * generator->claimsPerThread;
+	generator->numClaims = 0;
+
+	while(generator->numClaims < maxClaims && !RB_isQueueEmpty(queue)) {
+		RB_Coord coord = RB_chooseCoordFromAssignmentQueue(queue, &(data->random));
+		RB_removeCoordFromAssignmentQueue(queue, coord);
+		generator->claims[generator->numClaims].coord = coord;
+		generator->numClaims++;
+	}
+
+	if(generator->numClaims == 0) {
+		return false;
+	}
+
+	// SEARCH
+	pthread_mutex_lock(&(generator->lock));
+	generator->roundNumber++;
+	generator->workersFinished = 0;
+	pthread_cond_broadcast(&(generator->roundStarted));
+	pthread_mutex_unlock(&(generator->lock));
+
+	processParallelClaims(&(generator->workers[0]));
+
+	pthread_mutex_lock(&(generator->lock));
+	while(generator->workersFinished < generator->numThreads - 1) {
+		pthread_cond_wait(&(generator->roundFinished), &(generator->lock));
+	}
+	pthread_mutex_unlock(&(generator->lock));
+
+	// A claim without an ideal color can't be committed, and committing only the others would make the result depend
+	// on which searches failed, so the whole round is abandoned.
+	for(int i = 0; i < generator->numThreads; i++) {
+		if(generator->workers[i].searchFailed) {
+			fprintf(
+				stderr,
+				"Error generating pixels in parallel: a color search failed, so the round was abandoned!\n"
+			);
+			returnParallelClaims(generator, 0);
+			return false;
+		}
+	}
+
+	// COMMIT
+	// Committing in claim order (rather than in whatever order the workers finish) keeps the result deterministic.
+	for(RB_Size i = 0; i < generator->numClaims; i++) {
+		ParallelClaim* claim = &(generator->claims[i]);
+		RB_Color color = claim->idealColor;
+
+		if(!RB_colorIsAvailableInPool(data->colorPool, color)) {
+			// The pixels committed so far this round might have changed this pixel's preferred color, too. The workers
+			// are all waiting for the next round, so the calling thread's search is free to use.
+			RB_Color preferredColor = RB_determinePreferredCoordColor(data->pixelMap, claim->coord);
+			generator->numConflicts++;
+
+			if(!RB_searchForIdealAvailableColor(
+				data->colorPool, generator->workers[0].search, preferredColor, &(data->random), &color
+			)) {
+				fprintf(
+					stderr,
+					"Error generating pixels in parallel: a color search failed, so the round was cut short!\n"
+				);
+				returnParallelClaims(generator, i);
+				return false;
+			}
+		}
+
+		RB_setCoordColor(data, claim->coord, color);
+	}
+
+	RB_TRACE_END_WITH_ARG(traceStart, "parallelRound", "claims", generator->numClaims);
+	return !RB_isQueueEmpty(data->assignmentQueue);
+}
+
+RB_Size RB_getParallelConflictCount(RB_ParallelGenerator* generator) {
+	return generator->numConflicts;
+}
@@ -0,0 +1,84 @@
+#include "headers/RB_PixelRing.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+struct RB_PixelRing_s {
+	// Both counters only ever increase, and wrap around together. Only the producer writes head, and only the consumer
+	// writes tail, so head - tail is always the number of updates in the ring.
+	// They are kept on separate cache lines so that the two threads don't keep stealing the line from each other.
+	_Alignas(64) atomic_size_t head;
+	_Alignas(64) atomic_size_t tail;
+
+	_Alignas(64) size_t mask;
+	RB_PixelUpdate* updates;
+};
+
+RB_PixelRing* RB_createPixelRing(size_t capacity) {
+	size_t roundedCapacity = 1;
+	while(roundedCapacity < capacity) {
+		roundedCapacity *= 2;
+	}
+
+	RB_PixelRing* ret = (RB_PixelRing*) aligned_alloc(64, sizeof(RB_PixelRing));
+
+	if(ret == NULL) {
+		fprintf(stderr, "Error creating pixel ring: cannot allocate ring!\n");
+		return NULL;
+	}
+
+	atomic_init(&(ret->head), 0);
+	atomic_init(&(ret->tail), 0);
+	ret->mask = roundedCapacity - 1;
+	ret->updates = (RB_PixelUpdate*) malloc(sizeof(RB_PixelUpdate) * roundedCapacity);
+
+	if(ret->updates == NULL) {
+		fprintf(stderr, "Error creating pixel ring: cannot allocate %zu updates!\n", roundedCapacity);
+		free(ret);
+		return NULL;
+	}
+
+	return ret;
+}
+
+void RB_freePixelRing(RB_PixelRing* ring) {
+	if(ring == NULL) {
+		return;
+	}
+
+	printf("Freeing RB_PixelRing!\n");
+	free(ring->updates);
+	free(ring);
+}
+
+bool RB_pushPixelUpdate(RB_PixelRing* ring, RB_PixelUpdate update) {
+	size_t head = atomic_load_explicit(&(ring->head), memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&(ring->tail), memory_order_acquire);
+
+	if(head - tail > ring->mask) {
+		return false;
+	}
+
+	ring->updates[head & ring->mask] = update;
+	// Publishes the update to the consumer.
+	atomic_store_explicit(&(ring->head), head + 1, memory_order_release);
+	return true;
+}
+
+size_t RB_popPixelUpdates(RB_PixelRing* ring, RB_PixelUpdate* updates, size_t maxUpdates) {
+	size_t tail = atomic_load_explicit(&(ring->tail), memory_order_relaxed);
+	size_t head = atomic_load_explicit(&(ring->head), memory_order_acquire);
+
+	size_t numUpdates = head - tail;
+	if(numUpdates > maxUpdates) {
+		numUpdates = maxUpdates;
+	}
+
+	for(size_t i = 0; i < numUpdates; i++) {
+		updates[i] = ring->updates[(tail + i) & ring->mask];
+	}
+
+	// Hands the slots back to the producer.
+	atomic_store_explicit(&(ring->tail), tail + numUpdates, memory_order_release);
+	return numUpdates;
+}
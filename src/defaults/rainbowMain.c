@@ -3,7 +3,9 @@
 #include "headers/RB_BasicTypes.h"
 #include "headers/RB_ColorPool.h"
 #include "headers/RB_PixelMap.h"
-#include "headers/RB_Display.h"
+#include "headers/RB_Clock.h"
+#include "headers/RB_Stats.h"
+#include "headers/RB_Trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -24,8 +26,17 @@ RB_Config* RB_newConfig() {
 
 	ret->mapDimensionsSet = false;
 	ret->colorResSet = false;
+	ret->palette = NULL;
+	ret->paletteLength = 0;
+	ret->paletteSet = false;
+	ret->repeatColors = false;
 	ret->windowDimensionsSet = false;
 	ret->seedSet = false;
+	ret->topologySet = false;
+	ret->mapLayoutSet = false;
+	ret->keepPristineColorPool = false;
+	ret->useArena = false;
+	ret->arenaPages = RB_ARENA_PAGES_NORMAL;
 
 	return ret;
 }
@@ -42,14 +53,14 @@ bool checkColorResAndMapDimCompatibility(
 	RB_Size width,
 	RB_Size height
 ) {
-	if(rRes * gRes * bRes != width * height) {
+	if((RB_Size) (rRes * gRes * bRes) != width * height) {
 		fprintf(
 			stderr,
 			"Error configuring rainbow! width * height must be equal to rRes * gRes * bRes!\n"
-			"width * height == %d * %d == %d\n"
-			"rRes * gRes * bRes == %d * %d * %d == %d\n",
-			width, height, width * height,
-			rRes, gRes, bRes, rRes * gRes * bRes
+			"width * height == %ld * %ld == %ld\n"
+			"rRes * gRes * bRes == %lu * %lu * %lu == %lu\n",
+			(long) width, (long) height, (long) (width * height),
+			(unsigned long) rRes, (unsigned long) gRes, (unsigned long) bRes, (unsigned long) (rRes * gRes * bRes)
 		);
 		return false;
 	}
@@ -57,9 +68,43 @@ bool checkColorResAndMapDimCompatibility(
 	return true;
 }
 
+bool checkPaletteAndMapDimCompatibility(RB_Size paletteLength, RB_Size width, RB_Size height) {
+	if(paletteLength != width * height) {
+		fprintf(
+			stderr,
+			"Error configuring rainbow! width * height must be equal to the palette's length!\n"
+			"width * height == %ld * %ld == %ld\n"
+			"palette length == %ld\n",
+			(long) width, (long) height, (long) (width * height),
+			(long) paletteLength
+		);
+		return false;
+	}
+
+	return true;
+}
+
+// The number of colors the rainbow will have, including a palette's duplicates.
+RB_Size getConfigNumColors(const RB_Config* config) {
+	return config->paletteSet?
+		(RB_Size) config->paletteLength
+		: (RB_Size) (config->rRes * config->gRes * config->bRes);
+}
+
+// Checks that the config's colors (its palette, or its color resolution) can fill a canvas of the specified size.
+bool checkColorsAndMapDimCompatibility(const RB_Config* config, RB_Size width, RB_Size height) {
+	if(config->paletteSet) {
+		return checkPaletteAndMapDimCompatibility(config->paletteLength, width, height);
+	}
+
+	// Repeated colors are shared out among however many pixels there are.
+	return config->repeatColors
+		|| checkColorResAndMapDimCompatibility(config->rRes, config->gRes, config->bRes, width, height);
+}
+
 void RB_setColorResolution(RB_Config* config, RB_ColorChannelSize rRes, RB_ColorChannelSize gRes, RB_ColorChannelSize bRes) {
 	if(
-		config->mapDimensionsSet
+		config->mapDimensionsSet && !config->repeatColors
 		&& !checkColorResAndMapDimCompatibility(rRes, gRes, bRes, config->width, config->height)
 	) {
 		return;
@@ -73,9 +118,9 @@ void RB_setColorResolution(RB_Config* config, RB_ColorChannelSize rRes, RB_Color
 		fprintf(
 			stderr,
 			"Error setting color resolution! All resolutions must be between 1 and %d, inclusive.\n"
-			"rRes = %d, gRes = %d, bRes = %d.\n",
+			"rRes = %lu, gRes = %lu, bRes = %lu.\n",
 			RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION,
-			rRes, gRes, bRes
+			(unsigned long) rRes, (unsigned long) gRes, (unsigned long) bRes
 		);
 		return;
 	}
@@ -84,13 +129,40 @@ void RB_setColorResolution(RB_Config* config, RB_ColorChannelSize rRes, RB_Color
 	config->gRes = gRes;
 	config->bRes = bRes;
 	config->colorResSet = true;
+	config->paletteSet = false;
+}
+
+void RB_setPalette(RB_Config* config, const RB_Color* palette, RB_Size length) {
+	if(palette == NULL || length < 1 || length > RB_MAXIMUM_NUMBER_OF_PIXELS) {
+		fprintf(
+			stderr,
+			"Error setting palette! It must have between 1 and %d colors, inclusive.\n"
+			"length = %ld\n",
+			RB_MAXIMUM_NUMBER_OF_PIXELS,
+			(long) length
+		);
+		return;
+	}
+
+	if(config->mapDimensionsSet && !checkPaletteAndMapDimCompatibility(length, config->width, config->height)) {
+		return;
+	}
+
+	config->rRes = RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION;
+	config->gRes = RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION;
+	config->bRes = RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION;
+	config->colorResSet = true;
+	config->palette = palette;
+	config->paletteLength = length;
+	config->paletteSet = true;
+}
+
+void RB_setRepeatColors(RB_Config* config, bool repeat) {
+	config->repeatColors = repeat;
 }
 
 void RB_setMapDimensions(RB_Config* config, RB_Size width, RB_Size height) {
-	if(
-		config->colorResSet
-		&& !checkColorResAndMapDimCompatibility(config->rRes, config->gRes, config->bRes, width, height)
-	) {
+	if(config->colorResSet && !checkColorsAndMapDimCompatibility(config, width, height)) {
 		return;
 	}
 
@@ -98,19 +170,19 @@ void RB_setMapDimensions(RB_Config* config, RB_Size width, RB_Size height) {
 		fprintf(
 			stderr,
 			"Error setting map dimensions! width and height must be at least 1!\n"
-			"width = %d, height = %d\n",
-			width, height
+			"width = %ld, height = %ld\n",
+			(long) width, (long) height
 		);
 		return;
 	}
 
-	if((RB_MAXIMUM_POSSIBLE_NUMBER_OF_COLORS / width) < height) {
+	if((RB_MAXIMUM_NUMBER_OF_PIXELS / width) < height) {
 		fprintf(
 			stderr,
 			"Error setting map dimensions! width * height must be less than %d!\n"
-			"width = %d, height = %d\n",
-			RB_MAXIMUM_POSSIBLE_NUMBER_OF_COLORS,
-			width, height
+			"width = %ld, height = %ld\n",
+			RB_MAXIMUM_NUMBER_OF_PIXELS,
+			(long) width, (long) height
 		);
 		return;
 	}
@@ -142,10 +214,45 @@ void RB_setRandomSeed(RB_Config* config, unsigned int seed) {
 }
 
 
-RB_Data* RB_init(RB_Config* config) {
+void RB_setTopology(RB_Config* config, RB_Topology topology, const RB_Coord* remapTable) {
+	if(topology == RB_TOPOLOGY_CUSTOM && remapTable == NULL) {
+		fprintf(stderr, "Error setting topology! Custom topologies require a remap table.\n");
+		return;
+	}
+
+	config->topology = topology;
+	config->topologyRemap = remapTable;
+	config->topologySet = true;
+}
+
+void RB_setMapLayout(RB_Config* config, RB_MapLayout layout) {
+	config->mapLayout = layout;
+	config->mapLayoutSet = true;
+}
+
+void RB_setKeepPristineColorPool(RB_Config* config, bool keep) {
+	config->keepPristineColorPool = keep;
+}
+
+void RB_useArena(RB_Config* config, RB_ArenaPages pages) {
+	config->useArena = true;
+	config->arenaPages = pages;
+}
+
+
+bool RB_resolveConfig(const RB_Config* config, RB_Config* resolved) {
 	if(!config->colorResSet) {
 		fprintf(stderr, "Error initializing rainbow: Color Resolution not set!\n");
-		return NULL;
+		return false;
+	}
+
+	RB_Topology topology = config->topologySet? config->topology : RB_TOPOLOGY_RECTANGLE;
+	const RB_Coord* topologyRemap = config->topologySet? config->topologyRemap : NULL;
+	RB_MapLayout mapLayout = config->mapLayoutSet? config->mapLayout : RB_MAP_LAYOUT_FLAT;
+
+	if(topology == RB_TOPOLOGY_CUSTOM && !config->mapDimensionsSet) {
+		fprintf(stderr, "Error initializing rainbow: Custom topologies require the map dimensions to be set!\n");
+		return false;
 	}
 
 	RB_Size width;
@@ -154,8 +261,14 @@ RB_Data* RB_init(RB_Config* config) {
 	if(config->mapDimensionsSet) {
 		width = config->width;
 		height = config->height;
+
+		// The dimensions were checked when they were set, but the colors (or whether they repeat) may have changed
+		// since.
+		if(!checkColorsAndMapDimCompatibility(config, width, height)) {
+			return false;
+		}
 	} else {
-		RB_Size numPixels = config->rRes * config->gRes * config->bRes;
+		RB_Size numPixels = getConfigNumColors(config);
 		RB_Size potentialWidth = (RB_Size) sqrt(numPixels);
 		while(potentialWidth * (numPixels / potentialWidth) != numPixels) {
 			potentialWidth++;
@@ -169,23 +282,71 @@ RB_Data* RB_init(RB_Config* config) {
 
 	unsigned int seed = config->seedSet? config->seed : time(NULL);
 
+	*resolved = (RB_Config) {
+		.rRes = config->rRes,
+		.gRes = config->gRes,
+		.bRes = config->bRes,
+		.colorResSet = true,
+		.palette = config->paletteSet? config->palette : NULL,
+		.paletteLength = config->paletteSet? config->paletteLength : 0,
+		.paletteSet = config->paletteSet,
+		.repeatColors = config->repeatColors,
+		.width = width,
+		.height = height,
+		.mapDimensionsSet = true,
+		.windowWidth = wWidth,
+		.windowHeight = wHeight,
+		.windowDimensionsSet = true,
+		.seed = seed,
+		.seedSet = true,
+		.topology = topology,
+		.topologyRemap = topologyRemap,
+		.topologySet = true,
+		.mapLayout = mapLayout,
+		.mapLayoutSet = true,
+		.keepPristineColorPool = config->keepPristineColorPool,
+		.useArena = config->useArena,
+		.arenaPages = config->arenaPages
+	};
+
+	return true;
+}
+
+RB_Data* RB_init(RB_Config* unresolvedConfig) {
+	RB_Config resolvedConfig;
+	if(!RB_resolveConfig(unresolvedConfig, &resolvedConfig)) {
+		return NULL;
+	}
+
+	RB_Config* config = &resolvedConfig;
+	RB_Size width = config->width;
+	RB_Size height = config->height;
+	int wWidth = config->windowWidth;
+	int wHeight = config->windowHeight;
+	unsigned int seed = config->seed;
+	RB_MapLayout mapLayout = config->mapLayout;
+
 	RB_Size numPixels = height * width;
 
 	printf(
 		"Initializing Rainbow Image Generator.\n"
-		"| Color Resolutions: %d, %d, %d.\n"
-		"| Pixel Map Dimensions: %d, %d.\n"
-		"| Total pixels: %d.\n"
+		"| Color Resolutions: %lu, %lu, %lu.\n"
+		"| Pixel Map Dimensions: %ld, %ld.\n"
+		"| Total pixels: %ld.\n"
 		"| Display Window Dimensions: %d, %d.\n"
 		"| Seed: %u.\n",
-		config->rRes, config->gRes, config->bRes,
-		width, height,
-		numPixels,
+		(unsigned long) config->rRes, (unsigned long) config->gRes, (unsigned long) config->bRes,
+		(long) width, (long) height,
+		(long) numPixels,
 		wWidth, wHeight,
 		seed
 	);
 
-	srand(seed);
+	if(config->paletteSet) {
+		printf("| Palette: %ld colors.\n", (long) config->paletteLength);
+	} else if(config->repeatColors) {
+		printf("| Each color is used about %.2f times.\n", (double) numPixels / getConfigNumColors(config));
+	}
 
 	RB_Data* ret = (RB_Data*) malloc(sizeof(RB_Data));
 
@@ -197,20 +358,48 @@ RB_Data* RB_init(RB_Config* config) {
 	ret->assignmentQueue = NULL;
 	ret->colorPool = NULL;
 	ret->pixelMap = NULL;
-	ret->display = NULL;
-
-	ret->config = (RB_Config) {
-		.rRes = config->rRes,
-		.gRes = config->gRes,
-		.bRes = config->bRes,
-		.width = width,
-		.height = height,
-		.windowWidth = wWidth,
-		.windowHeight = wHeight,
-		.seed = seed
-	};
+	ret->pristineColorPool = NULL;
+	ret->arena = NULL;
+	ret->numPixelObservers = 0;
+	ret->hasStarted = false;
+#ifdef RB_ENABLE_STATS
+	ret->stats = RB_createStats();
+
+	if(ret->stats == NULL) {
+		fprintf(stderr, "Failed to initialize Stats!\n");
+		RB_free(ret);
+		return NULL;
+	}
+#endif
+
+	RB_seedRandom(&(ret->random), seed);
+
+	ret->config = resolvedConfig;
+	// The remap table has been copied into the pixel map by the time anybody could use this, and it might not outlive
+	// the rainbow, so it isn't kept.
+	ret->config.topologyRemap = NULL;
+	// Likewise, the palette's colors are copied into the color pool.
+	ret->config.palette = NULL;
+
+	if(config->useArena) {
+		size_t budgets[RB_NUM_ARENA_SUBSYSTEMS];
+		budgets[RB_ARENA_ASSIGNMENT_QUEUE] = RB_getAssignmentQueueArenaBudget(numPixels, width, height, mapLayout);
+		size_t colorPoolBudget = config->paletteSet?
+			RB_getPaletteColorPoolArenaBudget(config->paletteLength)
+			: RB_getColorPoolArenaBudget(config->rRes, config->gRes, config->bRes);
+		budgets[RB_ARENA_COLOR_POOL] = colorPoolBudget * (config->keepPristineColorPool? 2 : 1);
+		budgets[RB_ARENA_PIXEL_MAP] = RB_getPixelMapArenaBudget(width, height, mapLayout);
+
+		ret->arena = RB_createArena(budgets, config->arenaPages);
+
+		if(ret->arena == NULL) {
+			fprintf(stderr, "Failed to initialize the Arena!\n");
+			RB_free(ret);
+			return NULL;
+		}
+	}
 	
-	ret->assignmentQueue = RB_createAssignmentQueue(numPixels, width, height);
+	ret->assignmentQueue = RB_createAssignmentQueueInArena(ret->arena, numPixels, width, height, mapLayout);
 
 	if(ret->assignmentQueue == NULL) {
 		fprintf(stderr, "Failed to initialize Assignment Queue!\n");
@@ -218,7 +407,9 @@ RB_Data* RB_init(RB_Config* config) {
 		return NULL;
 	}
 
-	ret->colorPool = RB_createColorPool(config->rRes, config->gRes, config->bRes);
+	ret->colorPool = config->paletteSet?
+		RB_createPaletteColorPoolInArena(ret->arena, config->palette, config->paletteLength)
+		: RB_createCountedColorPoolInArena(ret->arena, config->rRes, config->gRes, config->bRes, numPixels);
 
 	if(ret->colorPool == NULL) {
 		fprintf(stderr, "Failed to initialize Color Pool!\n");
@@ -226,7 +417,17 @@ RB_Data* RB_init(RB_Config* config) {
 		return NULL;
 	}
 
-	ret->pixelMap = RB_createPixelMap(width, height);
+	if(config->keepPristineColorPool) {
+		ret->pristineColorPool = RB_cloneColorPoolInArena(ret->arena, ret->colorPool);
+
+		if(ret->pristineColorPool == NULL) {
+			fprintf(stderr, "Failed to copy the pristine Color Pool!\n");
+			RB_free(ret);
+			return NULL;
+		}
+	}
+
+	ret->pixelMap = RB_createPixelMapInArena(ret->arena, width, height, mapLayout);
 
 	if(ret->pixelMap == NULL) {
 		fprintf(stderr, "Failed to initialize Pixel Map!\n");
@@ -234,14 +435,8 @@ RB_Data* RB_init(RB_Config* config) {
 		return NULL;
 	}
 
-	ret->display = RB_createDisplay(
-		wWidth, wHeight,
-		width, height,
-		config->rRes, config->gRes, config->bRes
-	);
-
-	if(ret->display == NULL) {
-		fprintf(stderr, "Failed to initialize Display!\n");
+	if(!RB_setPixelMapTopology(ret->pixelMap, config->topology, config->topologyRemap)) {
+		fprintf(stderr, "Failed to set the Pixel Map's topology!\n");
 		RB_free(ret);
 		return NULL;
 	}
@@ -252,27 +447,106 @@ RB_Data* RB_init(RB_Config* config) {
 void RB_free(RB_Data* data) {
 	if(data != NULL) {
 		printf("Freeing RB_Data!\n");
+		for(int i = 0; i < data->numPixelObservers; i++) {
+			if(data->pixelObservers[i].onFree != NULL) {
+				data->pixelObservers[i].onFree(data->pixelObservers[i].userData);
+			}
+		}
 		RB_freeAssignmentQueue(data->assignmentQueue);
 		RB_freeColorPool(data->colorPool);
+		RB_freeColorPool(data->pristineColorPool);
 		RB_freePixelMap(data->pixelMap);
-		RB_freeDisplay(data->display);
+		// Everything that was allocated from the arena has to be freed before it is.
+		RB_freeArena(data->arena);
+#ifdef RB_ENABLE_STATS
+		RB_freeStats(data->stats);
+#endif
 		free(data);
 	}
 }
 
+bool RB_reset(RB_Data* data, unsigned int seed) {
+	// The queue only resets the coords that are in it, which is much cheaper than clearing its whole index table.
+	RB_clearAssignmentQueue(data->assignmentQueue);
+	RB_clearPixelMap(data->pixelMap);
+
+	bool poolReset = (data->pristineColorPool != NULL)?
+		RB_copyColorPool(data->colorPool, data->pristineColorPool)
+		: RB_resetColorPool(data->colorPool);
+
+	if(!poolReset) {
+		fprintf(stderr, "Failed to reset the Color Pool!\n");
+		return false;
+	}
+
+	for(int i = 0; i < data->numPixelObservers; i++) {
+		if(data->pixelObservers[i].onReset != NULL) {
+			data->pixelObservers[i].onReset(data->pixelObservers[i].userData);
+		}
+	}
+
+	data->config.seed = seed;
+	RB_seedRandom(&(data->random), seed);
+	data->hasStarted = false;
+
+#ifdef RB_ENABLE_STATS
+	RB_clearStats(data->stats);
+#endif
+
+	return true;
+}
+
+
+bool RB_addPixelObserver(RB_Data* data, RB_PixelObserver observer) {
+	if(observer.onPixelSet == NULL) {
+		fprintf(stderr, "Error adding pixel observer: onPixelSet must not be NULL!\n");
+		return false;
+	}
+
+	if(data->numPixelObservers >= RB_MAX_PIXEL_OBSERVERS) {
+		fprintf(stderr, "Error adding pixel observer: a rainbow can't have more than %d!\n", RB_MAX_PIXEL_OBSERVERS);
+		return false;
+	}
+
+	data->pixelObservers[data->numPixelObservers] = observer;
+	data->numPixelObservers++;
+	return true;
+}
+
+bool RB_removePixelObserver(RB_Data* data, void* userData) {
+	for(int i = 0; i < data->numPixelObservers; i++) {
+		if(data->pixelObservers[i].userData == userData) {
+			// Keep the rest of the observers in the order they were added.
+			for(int j = i + 1; j < data->numPixelObservers; j++) {
+				data->pixelObservers[j - 1] = data->pixelObservers[j];
+			}
+			data->numPixelObservers--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
 
 RB_Color RB_getRandomColor(RB_Data* data) {
+	// A random one of the pool's uses, so that colors that can't be used at all are never chosen.
+	if(data->config.paletteSet || data->config.repeatColors) {
+		RB_Size index = RB_getRandomBelow(&(data->random), RB_getColorPoolSize(data->colorPool));
+		return RB_getColorPoolColor(data->colorPool, index);
+	}
+
 	return (RB_Color) {
-		.r = rand() % data->config.rRes,
-		.g = rand() % data->config.gRes,
-		.b = rand() % data->config.bRes
+		.r = RB_getRandomBelow(&(data->random), data->config.rRes),
+		.g = RB_getRandomBelow(&(data->random), data->config.gRes),
+		.b = RB_getRandomBelow(&(data->random), data->config.bRes)
 	};
 }
 
 RB_Coord RB_getRandomCoord(RB_Data* data) {
 	return (RB_Coord) {
-		.x = rand() % data->config.width,
-		.y = rand() % data->config.height
+		.x = RB_getRandomBelow(&(data->random), data->config.width),
+		.y = RB_getRandomBelow(&(data->random), data->config.height)
 	};
 }
 
@@ -283,36 +557,152 @@ void RB_setCoordColor(RB_Data* data, RB_Coord coord, RB_Color color) {
 		fprintf(
 			stderr,
 			"Attempting to set Pixel at (%d,%d) even though it is already set!\n"
-			"\tQueue size: %d\n",
-			toSet->loc.x,
-			toSet->loc.y,
-			RB_getQueueSize(data->assignmentQueue)
+			"\tQueue size: %ld\n",
+			coord.x,
+			coord.y,
+			(long) RB_getQueueSize(data->assignmentQueue)
 		);
 		return;
 	}
-	if(RB_coordIsInQueue(data->assignmentQueue, toSet->loc)) {
-		RB_removeCoordFromAssignmentQueue(data->assignmentQueue, toSet->loc);	
+	if(RB_coordIsInQueue(data->assignmentQueue, coord)) {
+		RB_removeCoordFromAssignmentQueue(data->assignmentQueue, coord);	
 	}
 	RB_removeColorFromPool(data->colorPool, color);
 
 	toSet->color = color;
 	toSet->status = RB_PIXEL_SET;
+	data->hasStarted = true;
 
-	RB_setDisplayedPixelColor(data->display, toSet->loc, color);
+	for(int i = 0; i < data->numPixelObservers; i++) {
+		data->pixelObservers[i].onPixelSet(data->pixelObservers[i].userData, coord, color);
+	}
 
-	RB_addResultantCoordsToQueue(data->pixelMap, data->assignmentQueue, toSet->loc);
+	RB_addResultantCoordsToQueue(data->pixelMap, data->assignmentQueue, coord);
 }
 
-bool RB_generateNextPixel(RB_Data* data) {
-	if(RB_isQueueEmpty(data->assignmentQueue)) {
+void reportPixelSearchFailure(RB_Coord coord) {
+	fprintf(stderr, "Error generating pixels: no color could be found for Coord(%d, %d)!\n", coord.x, coord.y);
+}
+
+#ifdef RB_ENABLE_STATS
+// The same as generatePixel, but times each phase and records it in the rainbow's stats.
+bool generatePixelWithStats(RB_Data* data) {
+	double phaseSeconds[RB_NUM_STATS_PHASES];
+	RB_Size frontierSize = RB_getQueueSize(data->assignmentQueue);
+	double phaseStart = RB_getMonotonicSeconds();
+	double phaseEnd;
+
+	RB_Coord nextCoord = RB_chooseCoordFromAssignmentQueue(data->assignmentQueue, &(data->random));
+	phaseEnd = RB_getMonotonicSeconds();
+	phaseSeconds[RB_STATS_PHASE_CHOOSE_COORD] = phaseEnd - phaseStart;
+	phaseStart = phaseEnd;
+
+	RB_Color preferredColor = RB_determinePreferredCoordColor(data->pixelMap, nextCoord);
+	phaseEnd = RB_getMonotonicSeconds();
+	phaseSeconds[RB_STATS_PHASE_PREFERRED_COLOR] = phaseEnd - phaseStart;
+	phaseStart = phaseEnd;
+
+	RB_Color idealColor;
+	if(!RB_findIdealAvailableColor(data->colorPool, preferredColor, &(data->random), &idealColor)) {
+		reportPixelSearchFailure(nextCoord);
 		return false;
 	}
+	phaseEnd = RB_getMonotonicSeconds();
+	phaseSeconds[RB_STATS_PHASE_FIND_COLOR] = phaseEnd - phaseStart;
+	phaseStart = phaseEnd;
+
+	uint64_t nodesVisited;
+	uint64_t searchPasses;
+	RB_getLastColorPoolSearchCounts(data->colorPool, &nodesVisited, &searchPasses);
 
-	RB_Coord nextCoord = RB_chooseCoordFromAssignmentQueue(data->assignmentQueue);
+	RB_setCoordColor(data, nextCoord, idealColor);
+	phaseSeconds[RB_STATS_PHASE_SET_COLOR] = RB_getMonotonicSeconds() - phaseStart;
+
+	RB_recordPixelStats(
+		data->stats,
+		phaseSeconds,
+		nodesVisited,
+		searchPasses,
+		preferredColor,
+		idealColor,
+		frontierSize
+	);
+	return true;
+}
+#endif
+
+// Generates a pixel. The queue must not be empty. Returns false, leaving the rainbow as it was, if no color could be
+// found for the pixel.
+bool generatePixel(RB_Data* data) {
+#ifdef RB_ENABLE_STATS
+	// Rainbows that weren't made by RB_init (such as a batch's) don't have any stats.
+	if(data->stats != NULL) {
+		return generatePixelWithStats(data);
+	}
+#endif
+
+	RB_Coord nextCoord = RB_chooseCoordFromAssignmentQueue(data->assignmentQueue, &(data->random));
 	RB_Color preferredColor = RB_determinePreferredCoordColor(data->pixelMap, nextCoord);
-	RB_Color idealColor = RB_findIdealAvailableColor(data->colorPool, preferredColor);
+	RB_Color idealColor;
+
+	// Setting a color that isn't in the pool would corrupt both the pool and the map, so nothing is set.
+	if(!RB_findIdealAvailableColor(data->colorPool, preferredColor, &(data->random), &idealColor)) {
+		reportPixelSearchFailure(nextCoord);
+		return false;
+	}
 
 	RB_setCoordColor(data, nextCoord, idealColor);
+	return true;
+}
+
+bool RB_generateNextPixel(RB_Data* data) {
+	if(RB_isQueueEmpty(data->assignmentQueue)) {
+		return false;
+	}
+
+	if(!generatePixel(data)) {
+		return false;
+	}
 
 	return !RB_isQueueEmpty(data->assignmentQueue);
+}
+
+RB_Size generatePixels(RB_Data* data, RB_Size maxPixels) {
+	RB_Size numGenerated = 0;
+
+	while(numGenerated < maxPixels && !RB_isQueueEmpty(data->assignmentQueue)) {
+		if(!generatePixel(data)) {
+			break;
+		}
+		numGenerated++;
+	}
+
+	return numGenerated;
+}
+
+RB_Size RB_generatePixels(RB_Data* data, RB_Size maxPixels) {
+	RB_TRACE_BEGIN(traceStart);
+	RB_Size numGenerated = generatePixels(data, maxPixels);
+	RB_TRACE_END_WITH_ARG(traceStart, "generatePixels", "pixels", numGenerated);
+
+	return numGenerated;
+}
+
+RB_Size RB_generatePixelsUntil(RB_Data* data, double deadline) {
+	RB_Size numGenerated = 0;
+	RB_TRACE_BEGIN(traceStart);
+
+	// Reading the clock costs about as much as a small part of a pixel, so it is only read every few pixels.
+	// The chunks are too small to be worth tracing on their own, so only the whole call is.
+	while(RB_getMonotonicSeconds() < deadline) {
+		RB_Size numInChunk = generatePixels(data, RB_DEADLINE_CHECK_INTERVAL);
+		numGenerated += numInChunk;
+
+		if(numInChunk < RB_DEADLINE_CHECK_INTERVAL) {
+			break;
+		}
+	}
+
+	RB_TRACE_END_WITH_ARG(traceStart, "generatePixelsUntil", "pixels", numGenerated);
+	return numGenerated;
 }
\ No newline at end of file
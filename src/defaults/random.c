@@ -0,0 +1,30 @@
+#include "headers/RB_Random.h"
+
+// This is SplitMix64. It is small, fast, and passes BigCrush, and its entire state is a single number, which makes
+// it trivial to give every thread its own generator (or to save and restore one).
+
+void RB_seedRandom(RB_Random* random, uint64_t seed) {
+	random->state = seed;
+}
+
+uint64_t RB_nextRandom(RB_Random* random) {
+	random->state += 0x9E3779B97F4A7C15;
+
+	uint64_t z = random->state;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+	return z ^ (z >> 31);
+}
+
+RB_USize RB_getRandomBelow(RB_Random* random, RB_USize bound) {
+	// Numbers at or above the largest multiple of bound would make the lower results slightly more likely than the
+	// higher ones, so they are rejected. At most half of the possible numbers can ever be rejected.
+	uint64_t limit = UINT64_MAX - (UINT64_MAX % bound);
+	uint64_t value;
+
+	do {
+		value = RB_nextRandom(random);
+	} while(value >= limit);
+
+	return (RB_USize) (value % bound);
+}
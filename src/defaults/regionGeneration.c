@@ -0,0 +1,295 @@
+#include "headers/RB_RegionGeneration.h"
+#include "headers/RB_AssignmentQueue.h"
+#include "headers/RB_ColorPool.h"
+#include "headers/RB_PixelMap.h"
+#include "headers/RB_Random.h"
+#include "headers/RB_Trace.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+// How many rows on each side of a boundary the blending pass is allowed to move colors across.
+#define RB_REGION_BLEND_DEPTH 4
+
+typedef struct {
+	// The region's own rainbow. It never has any observers.
+	RB_Data data;
+
+	// Where the region's band starts on the canvas, and where its slice starts in the red channel.
+	RB_Size yOffset;
+	RB_ColorChannelSize rOffset;
+} GenerationRegion;
+
+typedef struct {
+	GenerationRegion* regions;
+	int numRegions;
+	int numThreads;
+	// Thread i generates regions i, i + numThreads, i + (2 * numThreads), and so on.
+	int index;
+} RegionWorker;
+
+void freeGenerationRegion(GenerationRegion* region) {
+	RB_freeAssignmentQueue(region->data.assignmentQueue);
+	RB_freeColorPool(region->data.colorPool);
+	RB_freePixelMap(region->data.pixelMap);
+}
+
+void* runRegionWorker(void* workerPtr) {
+	RegionWorker* worker = (RegionWorker*) workerPtr;
+	// The calling thread is a worker too, so its own budget is restored afterwards.
+	int buildThreads = RB_setColorPoolBuildThreads(1);
+	RB_TRACE_THREAD_NAME("region worker");
+
+	for(int i = worker->index; i < worker->numRegions; i += worker->numThreads) {
+		RB_Data* regionData = &(worker->regions[i].data);
+
+		RB_setCoordColor(regionData, RB_getRandomCoord(regionData), RB_getRandomColor(regionData));
+		RB_generatePixels(regionData, regionData->config.width * regionData->config.height);
+	}
+
+	RB_setColorPoolBuildThreads(buildThreads);
+	return NULL;
+}
+
+// Returns the sum of the square distances between the color and the colors of the pixel's neighbors,
+// not counting the pixel at (ignoreX, ignoreY).
+RB_USize getNeighborhoodCost(
+	RB_Color* colors,
+	RB_Size width,
+	RB_Size height,
+	RB_Size x,
+	RB_Size y,
+	RB_Color color,
+	RB_Size ignoreX,
+	RB_Size ignoreY
+) {
+	RB_USize ret = 0;
+
+	for(RB_Size nx = x - 1; nx <= x + 1; nx++) {
+		for(RB_Size ny = y - 1; ny <= y + 1; ny++) {
+			if(nx < 0 || nx >= width || ny < 0 || ny >= height) continue;
+			if((nx == x && ny == y) || (nx == ignoreX && ny == ignoreY)) continue;
+
+			RB_Color neighbor = colors[(ny * width) + nx];
+			RB_ColorChannelDifference dR = color.r - neighbor.r;
+			RB_ColorChannelDifference dG = color.g - neighbor.g;
+			RB_ColorChannelDifference dB = color.b - neighbor.b;
+			ret += ((RB_USize) dR * dR) + ((RB_USize) dG * dG) + ((RB_USize) dB * dB);
+		}
+	}
+
+	return ret;
+}
+
+// Swaps vertically adjacent pixels near the boundary (which is between rows boundaryY - 1 and boundaryY)
+// wherever doing so makes both of them closer to their neighbors.
+void blendRegionBoundary(RB_Color* colors, RB_Size width, RB_Size height, RB_Size boundaryY) {
+	RB_Size minY = boundaryY - RB_REGION_BLEND_DEPTH;
+	RB_Size maxY = boundaryY + RB_REGION_BLEND_DEPTH - 1;
+	if(minY < 0) minY = 0;
+	if(maxY > height - 1) maxY = height - 1;
+
+	// Each pass can move a color one row further across the boundary.
+	for(int pass = 0; pass < RB_REGION_BLEND_DEPTH; pass++) {
+		for(RB_Size y = minY; y < maxY; y++) {
+			for(RB_Size x = 0; x < width; x++) {
+				RB_Color* upper = &(colors[(y * width) + x]);
+				RB_Color* lower = &(colors[((y + 1) * width) + x]);
+
+				RB_USize currentCost = getNeighborhoodCost(colors, width, height, x, y, *upper, x, y + 1)
+					+ getNeighborhoodCost(colors, width, height, x, y + 1, *lower, x, y);
+				RB_USize swappedCost = getNeighborhoodCost(colors, width, height, x, y, *lower, x, y + 1)
+					+ getNeighborhoodCost(colors, width, height, x, y + 1, *upper, x, y);
+
+				if(swappedCost < currentCost) {
+					RB_Color temp = *upper;
+					*upper = *lower;
+					*lower = temp;
+				}
+			}
+		}
+	}
+}
+
+bool RB_generateRegions(RB_Data* data, int numRegions, int numThreads, bool blendBoundaries) {
+	RB_Config config = data->config;
+
+	// Each band has to hold exactly its slice of the color cube, which a palette doesn't have, and which doesn't fit
+	// whole bands once colors are shared out among the pixels.
+	if(config.paletteSet || config.repeatColors) {
+		fprintf(
+			stderr,
+			"Error generating regions: rainbows with a palette or repeated colors can't be generated in regions!\n"
+		);
+		return false;
+	}
+
+	// numRegions is only compared with rRes once it is known to be positive, so the cast can't wrap.
+	if(numRegions < 1 || (RB_ColorChannelSize) numRegions > config.rRes || numThreads < 1) {
+		fprintf(
+			stderr,
+			"Error generating regions: there must be between 1 and rRes (%d) regions, and at least one thread!\n"
+			"numRegions = %d, numThreads = %d\n",
+			(int) config.rRes, numRegions, numThreads
+		);
+		return false;
+	}
+
+	if(data->hasStarted) {
+		fprintf(stderr, "Error generating regions: the rainbow has already started generating!\n");
+		return false;
+	}
+
+	// Every band must be made of whole rows.
+	for(int i = 0; i < numRegions; i++) {
+		RB_ColorChannelSize sliceSize = ((config.rRes * (i + 1)) / numRegions) - ((config.rRes * i) / numRegions);
+		RB_Size numColors = sliceSize * config.gRes * config.bRes;
+
+		if(numColors % config.width != 0) {
+			fprintf(
+				stderr,
+				"Error generating regions: region %d has %ld colors, which is not a multiple of the map width (%ld)!\n",
+				i, (long) numColors, (long) config.width
+			);
+			return false;
+		}
+	}
+
+	GenerationRegion* regions = (GenerationRegion*) malloc(sizeof(GenerationRegion) * numRegions);
+	RegionWorker* workers = (RegionWorker*) malloc(sizeof(RegionWorker) * numThreads);
+	pthread_t* threads = (pthread_t*) malloc(sizeof(pthread_t) * numThreads);
+	RB_Color* colors = (RB_Color*) malloc(sizeof(RB_Color) * config.width * config.height);
+
+	if(regions == NULL || workers == NULL || threads == NULL || colors == NULL) {
+		fprintf(stderr, "Error generating regions: cannot allocate regions!\n");
+		free(regions);
+		free(workers);
+		free(threads);
+		free(colors);
+		return false;
+	}
+
+	// SET UP
+	// Every region is seeded from the rainbow's generator before any of them start, so the result only depends on
+	// the rainbow's seed and the number of regions, and not on the number of threads.
+	int numAllocated = 0;
+	bool allocationFailed = false;
+	RB_Size yOffset = 0;
+
+	for(int i = 0; i < numRegions; i++) {
+		GenerationRegion* region = &(regions[i]);
+		RB_ColorChannelSize rOffset = (config.rRes * i) / numRegions;
+		RB_ColorChannelSize sliceSize = ((config.rRes * (i + 1)) / numRegions) - rOffset;
+		RB_Size bandHeight = (sliceSize * config.gRes * config.bRes) / config.width;
+
+		region->yOffset = yOffset;
+		region->rOffset = rOffset;
+		yOffset += bandHeight;
+
+		region->data.config = config;
+		region->data.config.rRes = sliceSize;
+		region->data.config.height = bandHeight;
+		region->data.config.topology = RB_TOPOLOGY_RECTANGLE;
+		region->data.numPixelObservers = 0;
+		region->data.hasStarted = false;
+		region->data.arena = NULL;
+		region->data.pristineColorPool = NULL;
+#ifdef RB_ENABLE_STATS
+		region->data.stats = NULL;
+#endif
+		RB_seedRandom(&(region->data.random), RB_nextRandom(&(data->random)));
+
+		region->data.assignmentQueue = RB_createAssignmentQueue(
+			config.width * bandHeight, config.width, bandHeight, config.mapLayout
+		);
+		region->data.colorPool = RB_createColorPool(sliceSize, config.gRes, config.bRes);
+		region->data.pixelMap = RB_createPixelMap(config.width, bandHeight, config.mapLayout);
+		numAllocated++;
+
+		if(
+			region->data.assignmentQueue == NULL
+			|| region->data.colorPool == NULL
+			|| region->data.pixelMap == NULL
+		) {
+			fprintf(stderr, "Error generating regions: cannot allocate region %d!\n", i);
+			allocationFailed = true;
+			break;
+		}
+	}
+
+	// GENERATE
+	bool* threadStarted = (bool*) calloc(numThreads, sizeof(bool));
+
+	if(!allocationFailed && threadStarted == NULL) {
+		fprintf(stderr, "Error generating regions: cannot allocate threads!\n");
+		allocationFailed = true;
+	}
+
+	if(!allocationFailed) {
+		for(int i = 0; i < numThreads; i++) {
+			workers[i] = (RegionWorker) {
+				.regions = regions,
+				.numRegions = numRegions,
+				.numThreads = numThreads,
+				.index = i
+			};
+		}
+
+		// The calling thread generates the first share itself.
+		for(int i = 1; i < numThreads; i++) {
+			threadStarted[i] = pthread_create(&(threads[i]), NULL, runRegionWorker, &(workers[i])) == 0;
+		}
+
+		runRegionWorker(&(workers[0]));
+
+		for(int i = 1; i < numThreads; i++) {
+			if(threadStarted[i]) {
+				pthread_join(threads[i], NULL);
+			} else {
+				// Regions don't depend on which thread generates them, so a thread that didn't start costs only time.
+				runRegionWorker(&(workers[i]));
+			}
+		}
+	}
+
+	free(threadStarted);
+
+	// COMBINE
+	if(!allocationFailed) {
+		for(int i = 0; i < numRegions; i++) {
+			GenerationRegion* region = &(regions[i]);
+
+			for(RB_Size y = 0; y < region->data.config.height; y++) {
+				for(RB_Size x = 0; x < config.width; x++) {
+					RB_Pixel* pixel = RB_getPixel(region->data.pixelMap, (RB_Coord) { .x = x, .y = y });
+					RB_Color color = pixel->color;
+					color.r += region->rOffset;
+					colors[((region->yOffset + y) * config.width) + x] = color;
+				}
+			}
+		}
+
+		if(blendBoundaries) {
+			for(int i = 1; i < numRegions; i++) {
+				blendRegionBoundary(colors, config.width, config.height, regions[i].yOffset);
+			}
+		}
+
+		for(RB_Size y = 0; y < config.height; y++) {
+			for(RB_Size x = 0; x < config.width; x++) {
+				RB_setCoordColor(data, (RB_Coord) { .x = x, .y = y }, colors[(y * config.width) + x]);
+			}
+		}
+	}
+
+	for(int i = 0; i < numAllocated; i++) {
+		freeGenerationRegion(&(regions[i]));
+	}
+
+	free(regions);
+	free(workers);
+	free(threads);
+	free(colors);
+
+	return !allocationFailed;
+}
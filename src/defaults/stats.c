@@ -0,0 +1,169 @@
+#include "headers/RB_Stats.h"
+
+#ifdef RB_ENABLE_STATS
+
+#include <stdlib.h>
+#include <string.h>
+
+const char* const statsPhaseNames[RB_NUM_STATS_PHASES] = {
+	"choose coord",
+	"preferred color",
+	"find color",
+	"set color"
+};
+
+RB_Stats* RB_createStats() {
+	RB_Stats* ret = (RB_Stats*) calloc(1, sizeof(RB_Stats));
+
+	if(ret == NULL) {
+		fprintf(stderr, "Error creating stats: calloc failed!\n");
+		return NULL;
+	}
+
+	return ret;
+}
+
+void RB_freeStats(RB_Stats* stats) {
+	if(stats == NULL) {
+		return;
+	}
+
+	printf("Freeing RB_Stats!\n");
+	free(stats->frontierSamples);
+	free(stats);
+}
+
+void RB_clearStats(RB_Stats* stats) {
+	// The samples' memory is kept for the next generation.
+	RB_StoredSize* frontierSamples = stats->frontierSamples;
+	size_t frontierSamplesCapacity = stats->frontierSamplesCapacity;
+
+	memset(stats, 0, sizeof(RB_Stats));
+
+	stats->frontierSamples = frontierSamples;
+	stats->frontierSamplesCapacity = frontierSamplesCapacity;
+}
+
+const RB_Stats* RB_getStats(RB_Data* data) {
+	return data->stats;
+}
+
+int RB_getStatsHistogramBucket(uint64_t value) {
+	int bucket = 0;
+	while(value > 0 && bucket < RB_STATS_HISTOGRAM_BUCKETS - 1) {
+		value >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+void recordFrontierSample(RB_Stats* stats, RB_Size frontierSize) {
+	if(stats->numFrontierSamples == stats->frontierSamplesCapacity) {
+		size_t newCapacity = (stats->frontierSamplesCapacity == 0)? 1024 : stats->frontierSamplesCapacity * 2;
+		RB_StoredSize* newSamples = (RB_StoredSize*) realloc(stats->frontierSamples, sizeof(RB_StoredSize) * newCapacity);
+
+		// Losing a sample isn't worth interrupting the generation for.
+		if(newSamples == NULL) {
+			return;
+		}
+
+		stats->frontierSamples = newSamples;
+		stats->frontierSamplesCapacity = newCapacity;
+	}
+
+	stats->frontierSamples[stats->numFrontierSamples] = frontierSize;
+	stats->numFrontierSamples++;
+}
+
+void RB_recordPixelStats(
+	RB_Stats* stats,
+	const double phaseSeconds[RB_NUM_STATS_PHASES],
+	uint64_t nodesVisited,
+	uint64_t searchPasses,
+	RB_Color preferred,
+	RB_Color assigned,
+	RB_Size frontierSize
+) {
+	if(stats->numPixels % RB_STATS_FRONTIER_SAMPLE_INTERVAL == 0) {
+		recordFrontierSample(stats, frontierSize);
+	}
+	stats->numPixels++;
+
+	for(int i = 0; i < RB_NUM_STATS_PHASES; i++) {
+		stats->phaseSeconds[i] += phaseSeconds[i];
+	}
+
+	int64_t dR = (int64_t) preferred.r - (int64_t) assigned.r;
+	int64_t dG = (int64_t) preferred.g - (int64_t) assigned.g;
+	int64_t dB = (int64_t) preferred.b - (int64_t) assigned.b;
+	uint64_t distance = (uint64_t) ((dR * dR) + (dG * dG) + (dB * dB));
+
+	stats->nodesVisited[RB_getStatsHistogramBucket(nodesVisited)]++;
+	stats->searchPasses[RB_getStatsHistogramBucket(searchPasses)]++;
+	stats->colorDistances[RB_getStatsHistogramBucket(distance)]++;
+
+	stats->totalNodesVisited += nodesVisited;
+	stats->totalSearchPasses += searchPasses;
+	stats->totalColorDistance += distance;
+}
+
+void printStatsHistogram(FILE* stream, const char* name, const uint64_t* histogram) {
+	fprintf(stream, "| %s:\n", name);
+	for(int i = 0; i < RB_STATS_HISTOGRAM_BUCKETS; i++) {
+		if(histogram[i] == 0) {
+			continue;
+		}
+
+		uint64_t lowest = (i == 0)? 0 : ((uint64_t) 1 << (i - 1));
+		fprintf(stream, "|   >= %-10llu %llu\n", (unsigned long long) lowest, (unsigned long long) histogram[i]);
+	}
+}
+
+void RB_printStats(FILE* stream, const RB_Stats* stats) {
+	double totalSeconds = 0;
+	for(int i = 0; i < RB_NUM_STATS_PHASES; i++) {
+		totalSeconds += stats->phaseSeconds[i];
+	}
+
+	// Averages of nothing are shown as 0 rather than NaN.
+	double numPixels = (stats->numPixels > 0)? (double) stats->numPixels : 1;
+
+	fprintf(stream, "Generation stats.\n| Pixels: %llu.\n", (unsigned long long) stats->numPixels);
+
+	for(int i = 0; i < RB_NUM_STATS_PHASES; i++) {
+		fprintf(
+			stream,
+			"| %s: %.3f s (%.1f%%).\n",
+			statsPhaseNames[i],
+			stats->phaseSeconds[i],
+			(totalSeconds > 0)? (100 * stats->phaseSeconds[i] / totalSeconds) : 0
+		);
+	}
+
+	fprintf(
+		stream,
+		"| Average nodes visited: %.1f, search passes: %.2f, color distance: %.2f.\n",
+		stats->totalNodesVisited / numPixels,
+		stats->totalSearchPasses / numPixels,
+		stats->totalColorDistance / numPixels
+	);
+
+	printStatsHistogram(stream, "Nodes visited", stats->nodesVisited);
+	printStatsHistogram(stream, "Search passes", stats->searchPasses);
+	printStatsHistogram(stream, "Color distances", stats->colorDistances);
+
+	RB_Size peakFrontier = 0;
+	for(size_t i = 0; i < stats->numFrontierSamples; i++) {
+		if(stats->frontierSamples[i] > peakFrontier) {
+			peakFrontier = stats->frontierSamples[i];
+		}
+	}
+	fprintf(
+		stream,
+		"| Frontier: peak of %ld over %llu samples.\n",
+		(long) peakFrontier,
+		(unsigned long long) stats->numFrontierSamples
+	);
+}
+
+#endif
@@ -0,0 +1,213 @@
+#include "headers/RB_Trace.h"
+
+#ifdef RB_ENABLE_TRACE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+	const char* name;
+	RB_TraceTimestamp start;
+	RB_TraceTimestamp duration;
+	const char* argName;
+	int64_t argValue;
+} TraceEvent;
+
+// The events of one thread. Once a thread has a buffer, it keeps it until the program exits, even after the thread
+// itself has, so that its events can still be written.
+typedef struct TraceBuffer_s {
+	int threadId;
+	const char* threadName;
+	TraceEvent* events;
+	size_t numEvents;
+	size_t capacity;
+	size_t numDropped;
+	unsigned int searchesUntilSample;
+	struct TraceBuffer_s* next;
+} TraceBuffer;
+
+// Every thread's buffer, which is only locked to add a new thread's buffer, or to write the trace.
+pthread_mutex_t traceBuffersLock = PTHREAD_MUTEX_INITIALIZER;
+TraceBuffer* traceBuffers = NULL;
+int numTraceThreads = 0;
+
+_Thread_local TraceBuffer* threadTraceBuffer = NULL;
+
+const char* traceOutputPath = NULL;
+
+RB_TraceTimestamp RB_getTraceTimestamp() {
+	/*
+	CLOCK_MONOTONIC rather than rdtsc, since the TSC's rate has to be calibrated (and isn't always constant or in sync
+	across cores), while reading this clock through the vDSO costs a few tens of nanoseconds, which is nothing next to
+	the events it times.
+	*/
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (RB_TraceTimestamp) time.tv_sec * 1000000000 + (RB_TraceTimestamp) time.tv_nsec;
+}
+
+// Returns the calling thread's buffer, creating it if this is the thread's first event. Returns NULL on failure.
+TraceBuffer* getThreadTraceBuffer() {
+	if(threadTraceBuffer != NULL) {
+		return threadTraceBuffer;
+	}
+
+	TraceBuffer* buffer = (TraceBuffer*) calloc(1, sizeof(TraceBuffer));
+	if(buffer == NULL) {
+		fprintf(stderr, "Error creating trace buffer: calloc failed!\n");
+		return NULL;
+	}
+	buffer->searchesUntilSample = RB_TRACE_SAMPLE_INTERVAL;
+
+	pthread_mutex_lock(&traceBuffersLock);
+	buffer->threadId = numTraceThreads++;
+	buffer->next = traceBuffers;
+	traceBuffers = buffer;
+	pthread_mutex_unlock(&traceBuffersLock);
+
+	threadTraceBuffer = buffer;
+	return buffer;
+}
+
+void RB_recordTraceEvent(const char* name, RB_TraceTimestamp start, const char* argName, int64_t argValue) {
+	RB_TraceTimestamp end = RB_getTraceTimestamp();
+	TraceBuffer* buffer = getThreadTraceBuffer();
+
+	if(buffer == NULL) {
+		return;
+	}
+
+	if(buffer->numEvents == buffer->capacity) {
+		size_t capacity = buffer->capacity == 0? 1024 : buffer->capacity * 2;
+		if(capacity > RB_TRACE_MAX_EVENTS_PER_THREAD) {
+			capacity = RB_TRACE_MAX_EVENTS_PER_THREAD;
+		}
+
+		TraceEvent* events = capacity > buffer->capacity?
+			(TraceEvent*) realloc(buffer->events, sizeof(TraceEvent) * capacity) : NULL;
+		if(events == NULL) {
+			buffer->numDropped++;
+			return;
+		}
+		buffer->events = events;
+		buffer->capacity = capacity;
+	}
+
+	TraceEvent* event = &(buffer->events[buffer->numEvents++]);
+	event->name = name;
+	event->start = start;
+	event->duration = end - start;
+	event->argName = argName;
+	event->argValue = argValue;
+}
+
+void RB_nameTraceThread(const char* name) {
+	TraceBuffer* buffer = getThreadTraceBuffer();
+
+	if(buffer != NULL) {
+		buffer->threadName = name;
+	}
+}
+
+bool RB_shouldSampleTrace() {
+	TraceBuffer* buffer = getThreadTraceBuffer();
+
+	if(buffer == NULL || --(buffer->searchesUntilSample) > 0) {
+		return false;
+	}
+
+	buffer->searchesUntilSample = RB_TRACE_SAMPLE_INTERVAL;
+	return true;
+}
+
+// Timestamps are written in microseconds since the earliest event, as the format expects.
+void writeTraceTime(FILE* file, RB_TraceTimestamp nanoseconds) {
+	fprintf(file, "%llu.%03llu", (unsigned long long) (nanoseconds / 1000), (unsigned long long) (nanoseconds % 1000));
+}
+
+bool RB_writeTrace(const char* path) {
+	FILE* file = fopen(path, "w");
+
+	if(file == NULL) {
+		fprintf(stderr, "Error writing trace: cannot open %s!\n", path);
+		return false;
+	}
+
+	pthread_mutex_lock(&traceBuffersLock);
+
+	RB_TraceTimestamp epoch = RB_getTraceTimestamp();
+	for(TraceBuffer* buffer = traceBuffers; buffer != NULL; buffer = buffer->next) {
+		for(size_t i = 0; i < buffer->numEvents; i++) {
+			if(buffer->events[i].start < epoch) {
+				epoch = buffer->events[i].start;
+			}
+		}
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	bool isFirstEvent = true;
+	size_t numEvents = 0;
+	size_t numDropped = 0;
+
+	for(TraceBuffer* buffer = traceBuffers; buffer != NULL; buffer = buffer->next) {
+		fprintf(
+			file,
+			"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+			isFirstEvent? "" : ",\n",
+			buffer->threadId,
+			buffer->threadName == NULL? "thread" : buffer->threadName,
+			buffer->threadId
+		);
+		isFirstEvent = false;
+
+		for(size_t i = 0; i < buffer->numEvents; i++) {
+			TraceEvent* event = &(buffer->events[i]);
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":", event->name, buffer->threadId);
+			writeTraceTime(file, event->start - epoch);
+			fprintf(file, ",\"dur\":");
+			writeTraceTime(file, event->duration);
+			if(event->argName != NULL) {
+				fprintf(file, ",\"args\":{\"%s\":%lld}", event->argName, (long long) event->argValue);
+			}
+			fprintf(file, "}");
+		}
+
+		numEvents += buffer->numEvents;
+		numDropped += buffer->numDropped;
+	}
+
+	fprintf(file, "\n]}\n");
+	pthread_mutex_unlock(&traceBuffersLock);
+
+	if(fclose(file) != 0) {
+		fprintf(stderr, "Error writing trace: cannot write %s!\n", path);
+		return false;
+	}
+
+	printf("Wrote %zu trace events to %s.\n", numEvents, path);
+	if(numDropped > 0) {
+		fprintf(stderr, "%zu trace events were dropped, since their threads' buffers were full.\n", numDropped);
+	}
+	return true;
+}
+
+void writeTraceOnExit() {
+	RB_writeTrace(traceOutputPath);
+}
+
+bool RB_writeTraceAtExit(const char* path) {
+	bool isRegistered = traceOutputPath != NULL;
+	traceOutputPath = path;
+
+	if(!isRegistered && atexit(writeTraceOnExit) != 0) {
+		fprintf(stderr, "Error registering the trace to be written at exit!\n");
+		traceOutputPath = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+#endif
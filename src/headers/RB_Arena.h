@@ -0,0 +1,68 @@
+#ifndef EKW_RAINBOW_RB_ARENA_H
+#define EKW_RAINBOW_RB_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// The kind of pages that back an arena.
+typedef enum {
+	// Ordinary pages.
+	RB_ARENA_PAGES_NORMAL,
+	// Ordinary pages, but the kernel is asked to back them with transparent huge pages wherever it can.
+	RB_ARENA_PAGES_TRANSPARENT_HUGE,
+	// Explicit huge pages (MAP_HUGETLB), which have to be reserved by the system beforehand. If there aren't enough of
+	// them, the arena falls back to transparent huge pages.
+	RB_ARENA_PAGES_HUGETLB
+} RB_ArenaPages;
+
+// The parts of a rainbow that can be allocated from an arena. Each of them has its own budget.
+typedef enum {
+	RB_ARENA_ASSIGNMENT_QUEUE,
+	RB_ARENA_COLOR_POOL,
+	RB_ARENA_PIXEL_MAP,
+	RB_NUM_ARENA_SUBSYSTEMS
+} RB_ArenaSubsystem;
+
+// Every allocation from an arena starts on a multiple of this many bytes.
+#define RB_ARENA_ALIGNMENT 64
+
+/*
+A single reservation of address space, split into a region for each subsystem, which is carved up by bumping a
+pointer. Allocations are never freed on their own; the whole arena is unmapped at once.
+
+The reservation is made with mmap, so nothing in it uses any memory until it is touched, and every page starts out
+filled with zeroes. Structures whose initial state is all zeroes (such as blank pixels and unqueued coords) are
+therefore ready to use as soon as they are allocated, without ever being written to, and a budget can safely cover
+the worst case (such as every tile of a tiled map) without costing anything when it isn't reached.
+*/
+typedef struct RB_Arena_s RB_Arena;
+
+// Reserves an arena with the specified budget (in bytes) for each subsystem. Returns NULL on failure.
+RB_Arena* RB_createArena(const size_t budgets[RB_NUM_ARENA_SUBSYSTEMS], RB_ArenaPages);
+
+void RB_freeArena(RB_Arena*);
+
+// Returns how much of a budget an allocation of the specified size uses up, including its alignment.
+size_t RB_getArenaAllocationSize(size_t bytes);
+
+// Allocates zeroed memory from the subsystem's region. Several threads can allocate at once.
+// Returns NULL if the subsystem's budget would be exceeded.
+void* RB_allocateFromArena(RB_Arena*, RB_ArenaSubsystem, size_t bytes);
+
+// Allocates zeroed memory from the arena if it isn't NULL, or with calloc otherwise. Large callocs are also served
+// straight from fresh (zeroed) pages, so either way, zeroed structures don't need initializing.
+void* RB_allocateZeroed(RB_Arena*, RB_ArenaSubsystem, size_t bytes);
+
+// Frees memory from RB_allocateZeroed. Memory from an arena is only released along with the arena, so this does
+// nothing if the arena isn't NULL.
+void RB_freeZeroed(RB_Arena*, void*);
+
+size_t RB_getArenaBytesUsed(RB_Arena*, RB_ArenaSubsystem);
+
+size_t RB_getArenaBudget(RB_Arena*, RB_ArenaSubsystem);
+
+// Prints how much of each subsystem's budget has been used, and what kind of pages back the arena.
+void RB_printArenaUsage(FILE*, RB_Arena*);
+
+#endif
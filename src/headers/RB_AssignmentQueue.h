@@ -3,13 +3,26 @@
 
 #include "RB_Main.h"
 #include "RB_BasicTypes.h"
+#include "RB_Random.h"
+#include "RB_Arena.h"
 
-// Allocates an assignmentQueue capable of storing the specified number of coords.
-RB_AssignmentQueue* RB_createAssignmentQueue(RB_Size, RB_Size, RB_Size);
+// Allocates an assignmentQueue capable of storing the specified number of coords, with the specified x and y ranges
+// and the specified layout for its membership table.
+RB_AssignmentQueue* RB_createAssignmentQueue(RB_Size, RB_Size, RB_Size, RB_MapLayout);
+
+// The same as RB_createAssignmentQueue, but the queue (and any tiles it allocates later) comes out of the arena's
+// assignment queue budget. The arena must outlive the queue.
+RB_AssignmentQueue* RB_createAssignmentQueueInArena(RB_Arena*, RB_Size, RB_Size, RB_Size, RB_MapLayout);
+
+// Returns how much of an arena's budget a queue with the specified capacity, ranges and layout can use, at most.
+size_t RB_getAssignmentQueueArenaBudget(RB_Size, RB_Size, RB_Size, RB_MapLayout);
 
 // Frees a previously allocated assignmentQueue
 void RB_freeAssignmentQueue(RB_AssignmentQueue*);
 
+// Removes every coord from the queue. This only touches the parts of the queue that are actually in use.
+void RB_clearAssignmentQueue(RB_AssignmentQueue*);
+
 // Returns true if the queue is empty. Otherwise, returns false.
 bool RB_isQueueEmpty(RB_AssignmentQueue*);
 
@@ -20,8 +33,13 @@ RB_Size RB_getQueueSize(RB_AssignmentQueue*);
 
 RB_Size RB_getQueueCapacity(RB_AssignmentQueue*);
 
+// Returns the coord at the specified position in the queue, which must be less than the queue's size. Adding a queue's
+// coords to an empty queue in the order of their positions gives every coord the same position it had before.
+RB_Coord RB_getQueuedCoord(RB_AssignmentQueue*, RB_Size index);
+
 // Chooses (using an implementation-specific method) a coord from the queue and returns it.
-RB_Coord RB_chooseCoordFromAssignmentQueue(RB_AssignmentQueue*);
+// Any randomness used to choose the coord comes from the specified generator.
+RB_Coord RB_chooseCoordFromAssignmentQueue(RB_AssignmentQueue*, RB_Random*);
 
 bool RB_coordIsWithinQueueBounds(RB_AssignmentQueue*, RB_Coord);
 
@@ -9,6 +9,10 @@
 // Equal to (bits_per_color_channel^channels_per_color)
 #define RB_MAXIMUM_POSSIBLE_NUMBER_OF_COLORS 0x1000000
 
+// The most pixels a canvas can have. Colors can be used more than once (see RB_setRepeatColors), so this is larger
+// than the number of colors: large enough for a 16K by 8K canvas, while leaving RB_Size several bits to spare.
+#define RB_MAXIMUM_NUMBER_OF_PIXELS 0x8000000
+
 #define RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION 0x100
 
 typedef uint_fast8_t RB_ColorChannel; 
@@ -57,14 +61,61 @@ typedef int_fast32_t RB_Size;
 //		- In other words, contains at least ((bits_per_color_channel * 3) + 8)
 typedef uint_fast32_t RB_USize;
 
+// The fast types above are meant for arithmetic, and may well be 64 bits wide. Values that are kept in memory (in
+// large numbers, such as in the pixel map, the assignment queue and the color pool) use these exact-width types
+// instead, which hold every value the fast types are guaranteed to, in as few bytes as possible. They are widened
+// back to the fast types when they are loaded.
+
+// Holds any RB_Size value. Exactly 32 bits.
+typedef int32_t RB_StoredSize;
+
+// Holds any RB_ColorChannelSize value. Exactly 16 bits.
+typedef uint16_t RB_StoredChannelSize;
+
 // In theory, one dimension of the screen could be only a single pixel large, meaning the other dimension would
-// need to be as wide as there are colors/pixels. Therefore, coordinate components need to be as large as RB_Size
+// need to be as wide as there are colors/pixels. Therefore, coordinate components need to hold any RB_Size.
+// Coords are stored by the million, so they use the stored type, which keeps a coord to 8 bytes.
 typedef struct {
-	RB_Size x;
-	RB_Size y;
+	RB_StoredSize x;
+	RB_StoredSize y;
 } RB_Coord;
 
 
+// The way that per-pixel data (such as the pixel map and the assignment queue's membership table) is laid out in memory.
+typedef enum {
+	// One contiguous array, one column after another.
+	RB_MAP_LAYOUT_FLAT,
+	// Square tiles, each stored in Morton (Z-curve) order and only allocated once something inside of it is touched.
+	// This keeps neighborhoods within a handful of pages and means untouched regions of huge canvases cost no memory.
+	RB_MAP_LAYOUT_TILED
+} RB_MapLayout;
+
+// Tiles are (1 << RB_MAP_TILE_SHIFT) pixels wide and tall.
+#define RB_MAP_TILE_SHIFT 6
+#define RB_MAP_TILE_SIZE (1 << RB_MAP_TILE_SHIFT)
+#define RB_MAP_TILE_MASK (RB_MAP_TILE_SIZE - 1)
+#define RB_MAP_TILE_AREA (RB_MAP_TILE_SIZE * RB_MAP_TILE_SIZE)
+
+// Spreads the low RB_MAP_TILE_SHIFT bits of a value out so that there is a zero bit between each of them.
+static inline RB_Size RB_spreadTileBits(RB_Size v) {
+	v &= RB_MAP_TILE_MASK;
+	v = (v | (v << 4)) & 0x0F0F;
+	v = (v | (v << 2)) & 0x3333;
+	v = (v | (v << 1)) & 0x5555;
+	return v;
+}
+
+// Returns the Morton-order position of a coordinate within its tile.
+static inline RB_Size RB_getTileOffset(RB_Size x, RB_Size y) {
+	return RB_spreadTileBits(x) | (RB_spreadTileBits(y) << 1);
+}
+
+// Returns the number of tiles needed to cover the specified number of pixels along one axis.
+static inline RB_Size RB_getNumTiles(RB_Size pixels) {
+	return (pixels + RB_MAP_TILE_MASK) >> RB_MAP_TILE_SHIFT;
+}
+
+
 // Functions!
 
 
@@ -74,4 +125,8 @@ bool RB_colorsAreEqual(RB_Color, RB_Color);
 // Returns true if the two coords are equal. Otherwise returns false.
 bool RB_coordsAreEqual(RB_Coord, RB_Coord);
 
+// Fills the lookup table with every value of a channel with the specified resolution, rescaled to 8 bits.
+// The table must have room for RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION entries.
+void RB_buildChannelLookup(uint8_t* lookup, RB_ColorChannelSize resolution);
+
 #endif
\ No newline at end of file
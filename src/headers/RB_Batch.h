@@ -0,0 +1,51 @@
+#ifndef EKW_RAINBOW_RB_BATCH_H
+#define EKW_RAINBOW_RB_BATCH_H
+
+#include "RB_Main.h"
+#include "RB_BasicTypes.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+	// The config to generate the image with. The config's own seed is ignored in favor of the job's seed.
+	// Any topology remap table or palette must stay valid until the batch is finished.
+	const RB_Config* config;
+	unsigned int seed;
+} RB_BatchJob;
+
+// Called once for every finished image, with the index of its job and the finished rainbow. The rainbow belongs to
+// the batch, and is reused for later jobs as soon as the callback returns, so anything that should be kept has to be
+// copied out of it. The callback is called from the worker threads, so it may be called for several jobs at once.
+typedef void (*RB_BatchCallback)(void* userData, int jobIndex, RB_Data*);
+
+typedef struct {
+	int numImages;
+	uint64_t numPixels;
+	double seconds;
+	double imagesPerHour;
+	double pixelsPerSecond;
+} RB_BatchReport;
+
+/*
+Generates an image for every job, using numThreads threads (including the calling thread).
+
+A pristine color pool and pixel map are built once for every distinct combination of color resolution (or palette),
+map dimensions, map layout and topology in the batch, and are never modified afterwards. Each thread allocates its own
+queue, pool and map once, and resets them for each job by copying the pristine pool and map, rather than
+building new ones. Threads only reallocate when they move on to a job with a different geometry.
+
+Images are not displayed. An image is identical to the one RB_init would generate with the same config and seed,
+when its first pixel is set to a random color at a random coord (chosen in that order).
+
+If report is not NULL, it is filled with the batch's throughput. Returns true if every job was generated.
+*/
+bool RB_runBatch(
+	const RB_BatchJob* jobs,
+	int numJobs,
+	int numThreads,
+	RB_BatchCallback callback,
+	void* userData,
+	RB_BatchReport* report
+);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef EKW_RAINBOW_RB_CHECKPOINT_H
+#define EKW_RAINBOW_RB_CHECKPOINT_H
+
+#include "RB_Main.h"
+#include <stdbool.h>
+
+// The version of the checkpoint format that RB_saveCheckpoint writes. RB_loadCheckpoint refuses any other version.
+#define RB_CHECKPOINT_VERSION 3
+
+/*
+Saves everything needed to carry on generating the rainbow later to a file: its config, the state of its random
+number generator, every pixel that has been set, the assignment queue (in order), and which colors are still
+available. Observers (such as displays) aren't saved. Returns true on success.
+
+The file starts with the 4 bytes "RBCP", then the version, then the config, the generator's state, the length of the
+queue, the length of the palette (0 if there isn't one) and whether colors repeat. After that come the palette's
+colors (in the pool's order, see RB_getColorPoolColor), a custom topology's remap table (if any), a bitmap of which
+pixels are set and the colors of those pixels (both a column at a time), the queued coords, and how many more times
+each color can be used (see RB_getColorPoolAvailability, which is a bitmap of the available colors unless colors
+repeat). Every number is little-endian, and the color channels are single bytes.
+*/
+bool RB_saveCheckpoint(RB_Data*, const char* path);
+
+/*
+Allocates a rainbow in the state a checkpoint was saved in. The rainbow has no observers, so anything that displays
+or records it has to be attached again. Returns NULL on failure.
+
+The color pool is rebuilt from the availability bitmap in a single pass, so loading takes about as long as reading
+the file. A pool's tree only depends on which colors are left in it (see RB_removeColorFromPool), so the rebuilt pool
+is the same as the saved one, and the resumed rainbow carries on exactly as the saved one would have.
+*/
+RB_Data* RB_loadCheckpoint(const char* path);
+
+#endif
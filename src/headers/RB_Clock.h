@@ -0,0 +1,9 @@
+#ifndef EKW_RAINBOW_RB_CLOCK_H
+#define EKW_RAINBOW_RB_CLOCK_H
+
+// Returns the number of seconds since some fixed point in the past, according to a monotonic wall clock. Only the
+// differences between values are meaningful. Unlike clock(), this measures real time rather than CPU time, and unlike
+// time(), it never jumps when the system clock is changed.
+double RB_getMonotonicSeconds();
+
+#endif
@@ -3,21 +3,197 @@
 
 #include "RB_Main.h"
 #include "RB_BasicTypes.h"
+#include "RB_Random.h"
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-// Allocates a colorPool with the specified range of colors.
+// The scratch space used while searching a color pool. A pool can be searched by several threads at once (as long as
+// nothing is removing colors from it at the same time), but each of them needs its own search.
+typedef struct RB_ColorPoolSearch_s RB_ColorPoolSearch;
+
+// Allocates a colorPool with the specified range of colors, each of which can be taken once.
 RB_ColorPool* RB_createColorPool(RB_ColorChannelSize, RB_ColorChannelSize, RB_ColorChannelSize);
 
+// The same as RB_createColorPool, but the pool's colors and octants come out of the arena's color pool budget.
+// The arena must outlive the pool.
+RB_ColorPool* RB_createColorPoolInArena(RB_Arena*, RB_ColorChannelSize, RB_ColorChannelSize, RB_ColorChannelSize);
+
+/*
+Allocates a pool with the specified range of colors, whose colors can be taken totalCount times altogether (up to
+RB_MAXIMUM_NUMBER_OF_PIXELS). Every color's count is either totalCount divided by the number of colors, rounded down,
+or one more than that, and the colors with one more are spread evenly through the range. If totalCount is less than
+the number of colors, some colors can't be taken at all.
+
+Each color is stored once, along with how many more times it can be taken, so the pool takes up no more memory than
+RB_createColorPool's. A color stays in the tree until its count reaches zero.
+*/
+RB_ColorPool* RB_createCountedColorPool(
+	RB_ColorChannelSize,
+	RB_ColorChannelSize,
+	RB_ColorChannelSize,
+	RB_Size totalCount
+);
+
+// The same as RB_createCountedColorPool, but the pool comes out of the arena's color pool budget.
+RB_ColorPool* RB_createCountedColorPoolInArena(
+	RB_Arena*,
+	RB_ColorChannelSize,
+	RB_ColorChannelSize,
+	RB_ColorChannelSize,
+	RB_Size totalCount
+);
+
+// Returns how much of an arena's budget a pool with the specified range of colors uses, whatever its total count.
+size_t RB_getColorPoolArenaBudget(RB_ColorChannelSize, RB_ColorChannelSize, RB_ColorChannelSize);
+
+/*
+Allocates a pool of the colors in the palette (such as the colors of an image), instead of a whole range of them. A
+color can be taken as many times as it appears in the palette, and each distinct color is stored once. The palette's
+channels are used as they are, so they go up to RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION - 1, and the pool's range is
+RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION in every channel. The palette can have up to RB_MAXIMUM_NUMBER_OF_PIXELS colors.
+It isn't kept, so it can be freed as soon as this returns.
+
+The colors are sorted and the pool's tree is built from them in a single pass, so even palettes of every possible
+color only take a couple of seconds. Apart from RB_getColorPoolAvailability's order, a palette pool works exactly like
+any other pool.
+*/
+RB_ColorPool* RB_createPaletteColorPool(const RB_Color* palette, RB_Size length);
+
+// The same as RB_createPaletteColorPool, but the pool comes out of the arena's color pool budget.
+RB_ColorPool* RB_createPaletteColorPoolInArena(RB_Arena*, const RB_Color* palette, RB_Size length);
+
+// Returns how much of an arena's budget a pool of a palette with the specified length uses.
+size_t RB_getPaletteColorPoolArenaBudget(RB_Size length);
+
 // Frees a previously allocated color pool
 void RB_freeColorPool(RB_ColorPool*);
 
-RB_Color RB_findIdealAvailableColor(RB_ColorPool*, RB_Color);
+// Makes every color in the pool available again, reusing the pool's memory. Returns true on success.
+bool RB_resetColorPool(RB_ColorPool*);
+
+// Overwrites the destination pool with the state of the source pool. Both pools must have the same range of colors
+// and total count (or both be palette pools with the same length and number of distinct colors, in which case the
+// destination takes on the source's palette).
+// This is much cheaper than building a new pool, so a pristine pool can be kept around and copied from.
+// Returns true on success.
+bool RB_copyColorPool(RB_ColorPool* dest, const RB_ColorPool* src);
+
+// Allocates a new pool with the same state as the specified pool, without building a tree of its own.
+RB_ColorPool* RB_cloneColorPool(const RB_ColorPool*);
+
+// The same as RB_cloneColorPool, but the new pool comes out of the arena's color pool budget.
+RB_ColorPool* RB_cloneColorPoolInArena(RB_Arena*, const RB_ColorPool*);
+
+// Returns how many times the pool's colors can be taken altogether, when all of them are available (which, for palette
+// pools, is the palette's length).
+size_t RB_getColorPoolSize(const RB_ColorPool*);
+
+// Returns the color that the specified one of the pool's RB_getColorPoolSize uses belongs to, whether it has been
+// taken or not. Every color takes up as many consecutive indexes as its count, in the same order as
+// RB_getColorPoolAvailability, so a random index picks a color in proportion to its count.
+RB_Color RB_getColorPoolColor(const RB_ColorPool*, size_t index);
+
+// Returns the size, in bytes, of the pool's availability array.
+size_t RB_getColorPoolAvailabilitySize(const RB_ColorPool*);
+
+/*
+Fills the array with how many more times each of the pool's colors can be taken, in the order of its red, then green,
+then blue component. A palette pool's colors are in the order of their Morton codes instead (which is the same for any
+ordering of the same palette).
+
+If no color can be taken more than once, the array is a bitmap, with one bit for every color, starting from the lowest
+bit of the first byte. Otherwise, every color's count takes up the fewest whole bytes that hold the largest color's
+count (1, 2 or 4 of them), and is little-endian.
+*/
+void RB_getColorPoolAvailability(const RB_ColorPool*, uint8_t* availability);
+
+// Rebuilds the pool so that each color can be taken as many times as the availability array says, in a single pass
+// over the tree, reusing the pool's memory. Returns false if any color's count is more than it started out with.
+// The rebuilt tree may hold its colors in a different order than the original pool did, so if several colors are
+// equally close to a desired color, a search of the rebuilt pool may choose a different one of them.
+bool RB_rebuildColorPool(RB_ColorPool*, const uint8_t* availability);
+
+/*
+Sets how many threads (including itself) the calling thread may use to build a pool's tree, whenever it creates,
+resets or rebuilds one. The budget belongs to the calling thread alone, and 0 (the default) means one thread per online
+processor, up to 64. Batch and region workers build with a budget of one, since the other workers already keep the
+processors busy. Returns the previous budget, so that it can be restored.
+*/
+int RB_setColorPoolBuildThreads(int numThreads);
+
+// Allocates the scratch space needed to search a color pool.
+RB_ColorPoolSearch* RB_createColorPoolSearch();
+
+void RB_freeColorPoolSearch(RB_ColorPoolSearch*);
+
+// Puts the available color that is closest to the desired color in found, using the pool's own search. If several
+// colors are equally close, one of them is chosen using the specified random number generator. Returns false (leaving
+// found alone) if the pool is empty, or if the search's scratch space can't grow to hold every node it needs to look at.
+bool RB_findIdealAvailableColor(RB_ColorPool*, RB_Color desired, RB_Random*, RB_Color* found);
+
+// The same as RB_findIdealAvailableColor, but uses the specified search instead of the pool's own.
+bool RB_searchForIdealAvailableColor(
+	RB_ColorPool*,
+	RB_ColorPoolSearch*,
+	RB_Color desired,
+	RB_Random*,
+	RB_Color* found
+);
+
+#ifdef RB_ENABLE_STATS
+// Gets how many nodes the last RB_findIdealAvailableColor looked at, and how many passes over its node queue it took.
+void RB_getLastColorPoolSearchCounts(RB_ColorPool*, uint64_t* nodesVisited, uint64_t* passes);
+#endif
 
 bool RB_colorIsAvailableInPool(RB_ColorPool*, RB_Color);
 
+// Returns how many more times the color can be taken from the pool (0 if the pool doesn't have it at all).
+RB_Size RB_getColorCountInPool(RB_ColorPool*, RB_Color);
+
 // Attempts to remove the specified color from the pool.
-// If the specified color is contained by the Color Pool, removes it and returns true.
+// If the specified color is contained by the Color Pool, takes one of its uses and returns true. The color stays in
+// the pool until its last use is taken.
 // If the specified color is not contained by the Color Pool, returns false.
+// The pool's tree ends up the same whatever order its colors were removed in, and the same as a tree rebuilt from the
+// colors that are left (see RB_rebuildColorPool), so searches of either find equally close colors in the same order.
 bool RB_removeColorFromPool(RB_ColorPool*, RB_Color);
 
+// Checks that the pool's tree is consistent: every available color is in it exactly once, every octant has between
+// two and eight children whose parent data points back at it, and every octant's bounds are exactly those of its
+// children. Describes anything that is wrong on stderr. Returns true if nothing is. This walks the whole tree, so it is
+// meant for tests.
+bool RB_checkColorPoolInvariants(RB_ColorPool*);
+
+
+// CONCURRENT POOLS
+// A concurrent pool supports any number of threads searching it and claiming colors from it at the same time.
+// Each thread needs its own RB_ColorPoolSearch.
+typedef struct RB_ConcurrentColorPool_s RB_ConcurrentColorPool;
+
+// Allocates a concurrent pool with the specified range of colors, each of which can be claimed once.
+RB_ConcurrentColorPool* RB_createConcurrentColorPool(RB_ColorChannelSize, RB_ColorChannelSize, RB_ColorChannelSize);
+
+void RB_freeConcurrentColorPool(RB_ConcurrentColorPool*);
+
+bool RB_colorIsAvailableInConcurrentPool(RB_ConcurrentColorPool*, RB_Color);
+
+// Attempts to claim the specified color. Exactly one thread can successfully claim each color.
+// Returns true if this call claimed the color, or false if it had already been claimed.
+bool RB_claimColorFromConcurrentPool(RB_ConcurrentColorPool*, RB_Color);
+
+// Finds the available color closest to the desired color and claims it, searching again whenever another thread
+// claims the color first. Returns the claimed color.
+RB_Color RB_takeIdealAvailableColorFromConcurrentPool(
+	RB_ConcurrentColorPool*,
+	RB_ColorPoolSearch*,
+	RB_Color,
+	RB_Random*
+);
+
+// Checks the pool's tree (see RB_checkColorPoolInvariants), and that every octant's count and bounds agree with the
+// colors still available beneath it. Only meaningful while no thread is claiming colors. Returns true if nothing is
+// wrong, and otherwise describes what is on stderr.
+bool RB_checkConcurrentColorPoolInvariants(RB_ConcurrentColorPool*);
+
 #endif
\ No newline at end of file
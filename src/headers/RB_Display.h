@@ -4,6 +4,9 @@
 #include "RB_BasicTypes.h"
 #include "RB_Main.h"
 #include <stdbool.h>
+
+typedef struct RB_Display_s RB_Display;
+
 /*
 Allocates a display object.
 Parameters:
@@ -22,6 +25,11 @@ RB_Display* RB_createDisplay(
 
 void RB_freeDisplay(RB_Display*);
 
+// Creates a display for the rainbow, using the window dimensions in its config, and adds it to the rainbow as a pixel
+// observer. Pixels that were set before the display was attached aren't shown. The display belongs to the rainbow, and
+// is freed by RB_free. Returns NULL on failure.
+RB_Display* RB_attachDisplay(RB_Data*);
+
 
 // Forces the display to update immediately.
 // If the boolean is true, it will interrupt the frame rate, meaning the next unforced update will not happen until
@@ -36,8 +44,12 @@ bool RB_updateDisplay(RB_Display*);
 // Handles window events. If the window is closing, returns 0. Otherwise, returns 1.
 int RB_handleWindowEvents(RB_Display*);
 
+// Clears every displayed pixel back to the background color.
+void RB_clearDisplay(RB_Display*);
+
 // Sets the pixel at the specified coordinate to the specified color
 // Note: This function will convert the color to the displayed color format. You should NOT do that beforehand.
+// The pixel is only drawn into the display's framebuffer, which is uploaded to the window by the next update.
 void RB_setDisplayedPixelColor(RB_Display*, RB_Coord, RB_Color);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef EKW_RAINBOW_RB_FIXED_CONFIG_H
+#define EKW_RAINBOW_RB_FIXED_CONFIG_H
+
+/*
+Fixed-configuration builds. When the library is compiled with RB_FIXED_CONFIG defined, along with RB_FIXED_WIDTH and
+RB_FIXED_HEIGHT (for instance, with `make headless RB_DEFINES="-DRB_FIXED_CONFIG -DRB_FIXED_WIDTH=512
+-DRB_FIXED_HEIGHT=512"`), the pixel map's neighborhood scans (the preferred color of a pixel, and queueing the
+neighbors of a pixel that was just set) are compiled a second time with the map's dimensions as constants, so that
+their bounds checks and strides fold away. Only the dimensions are fixed, so the colors can come from any resolution,
+palette or repeated set of colors.
+
+Those scans are the only size-dependent work done for every neighbor of every pixel. Most of a generation is spent
+searching the color pool, which walks the tree rather than indexing into anything, so it has nothing to specialize,
+and the pool, the queue and whole-map lookups are left as they are.
+
+Maps whose dimensions match the fixed config use the constant versions. Everything else (such as the slices used by
+region generation) still uses the runtime-configured versions, so a fixed build can run any config. Without
+RB_FIXED_CONFIG, only the runtime-configured versions exist.
+*/
+
+#include <stdbool.h>
+
+#ifdef RB_FIXED_CONFIG
+
+#if !defined(RB_FIXED_WIDTH) || !defined(RB_FIXED_HEIGHT)
+#error "RB_FIXED_CONFIG needs RB_FIXED_WIDTH and RB_FIXED_HEIGHT."
+#endif
+
+#define RB_isFixedMapDimensions(width, height) ((width) == RB_FIXED_WIDTH && (height) == RB_FIXED_HEIGHT)
+
+#else
+
+#define RB_isFixedMapDimensions(width, height) false
+
+#endif
+
+// Marks a function that takes a structure's sizes as parameters, and is called both with the fixed config's sizes and
+// with the structure's own. It is always inlined, so that the fixed config's sizes fold into constants.
+#define RB_SPECIALIZED static inline __attribute__((always_inline))
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef EKW_RAINBOW_RB_FRAME_EXPORT_H
+#define EKW_RAINBOW_RB_FRAME_EXPORT_H
+
+#include "RB_Main.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum {
+	// Every frame is width * height * 3 bytes of 8-bit RGB, one row after another, with no header.
+	RB_FRAME_FORMAT_RAW_RGB,
+	// A YUV4MPEG2 stream (4:4:4, 30 frames per second), which most video tools (such as ffmpeg) can read directly.
+	RB_FRAME_FORMAT_Y4M,
+	/*
+	Only the pixels that changed since the previous frame. The stream starts with the 8 bytes "RBDELTA1", then the
+	width and the height. Each frame is a flags byte (if bit 0 is set, every pixel is black again before the frame's
+	pixels are applied), the number of pixels in the frame, and then each pixel's x, y, r, g and b.
+	Every number is a little-endian uint32, except for r, g, b and the flags, which are single bytes.
+	*/
+	RB_FRAME_FORMAT_DELTA
+} RB_FrameFormat;
+
+typedef struct RB_FrameExporter_s RB_FrameExporter;
+
+/*
+Adds an exporter to the rainbow as a pixel observer, which writes a frame to the output every pixelsPerFrame pixels.
+Colors are rescaled to 8 bits per channel, and blank pixels are black.
+
+Frames are encoded and written by a background thread. The generating thread only records which pixels changed,
+and hands them over once per frame, so it never waits for the output. If the output falls so far behind that the
+previous frame hasn't even been picked up yet, the two frames are merged into one instead (see
+RB_getDroppedFrameCount).
+
+The output can be any stream, such as a file or a pipe to an encoder. It isn't closed by the exporter. The exporter
+belongs to the rainbow: RB_free writes the last (partial) frame, waits for everything to be written, and frees it.
+Returns NULL on failure.
+*/
+RB_FrameExporter* RB_attachFrameExporter(RB_Data*, FILE* output, RB_FrameFormat, RB_Size pixelsPerFrame);
+
+// Returns how many frames have been written so far.
+uint64_t RB_getWrittenFrameCount(RB_FrameExporter*);
+
+// Returns how many frames were merged into the following frame, because the writer was too far behind.
+uint64_t RB_getDroppedFrameCount(RB_FrameExporter*);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef EKW_RAINBOW_RB_GENERATION_PIPELINE_H
+#define EKW_RAINBOW_RB_GENERATION_PIPELINE_H
+
+#include "RB_Main.h"
+#include "RB_Display.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct RB_GenerationPipeline_s RB_GenerationPipeline;
+
+/*
+Allocates a pipeline that generates a rainbow on its own thread while the calling thread displays it.
+
+The pipeline adds itself to the rainbow as a pixel observer, and passes every pixel that is set to the display thread
+through a lock-free ring buffer of ringCapacity updates. Generation never waits for the display: if the ring is
+full, updates are kept in a backlog on the generation thread until there is room for them, so no update is ever lost.
+
+The display must not also be attached to the rainbow as an observer (so it should come from RB_createDisplay, not
+RB_attachDisplay), since it may only be used by the display thread. It is not freed by the pipeline.
+
+Generation doesn't start until RB_startGenerationPipeline is called, so starting pixels can be set first. Once it
+has started, nothing else may touch the rainbow until the pipeline is freed.
+*/
+RB_GenerationPipeline* RB_createGenerationPipeline(RB_Data*, RB_Display*, size_t ringCapacity);
+
+// Starts generating on the pipeline's thread. Returns true on success.
+bool RB_startGenerationPipeline(RB_GenerationPipeline*);
+
+// Draws every update that the generation thread has published into the display, and updates the display if it is
+// time for a new frame. Must be called from the thread that created the pipeline.
+// Returns false once the rainbow is finished and every one of its pixels has been drawn. Otherwise, returns true.
+bool RB_drainGenerationPipeline(RB_GenerationPipeline*);
+
+// Stops generating (if the rainbow isn't finished yet), waits for the generation thread to exit, and frees the
+// pipeline. The pipeline is removed from the rainbow's observers.
+void RB_freeGenerationPipeline(RB_GenerationPipeline*);
+
+#endif
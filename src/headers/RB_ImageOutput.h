@@ -0,0 +1,29 @@
+#ifndef EKW_RAINBOW_RB_IMAGE_OUTPUT_H
+#define EKW_RAINBOW_RB_IMAGE_OUTPUT_H
+
+#include "RB_Main.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+	uint64_t numBytes;
+	double seconds;
+	double megapixelsPerSecond;
+	double megabytesPerSecond;
+} RB_ImageReport;
+
+/*
+Writes the rainbow's pixel map to a file as an 8-bit RGB image. Colors are rescaled from the rainbow's color
+resolution to 8 bits per channel the same way the display rescales them, and blank pixels are black.
+
+The image is streamed a band of rows at a time, so no full-size copy of it is ever made. If report is not NULL, it is
+filled with how long writing took. Both functions return true on success.
+*/
+// Writes a binary (P6) PPM.
+bool RB_writePPM(RB_Data*, const char* path, RB_ImageReport* report);
+
+// Writes a PNG. The image data is stored rather than compressed, which makes writing very fast (and needs no
+// compression library), at the cost of a file about as large as a PPM.
+bool RB_writePNG(RB_Data*, const char* path, RB_ImageReport* report);
+
+#endif
@@ -2,6 +2,8 @@
 #define EKW_RAINBOW_RB_DATA_H
 
 #include "RB_BasicTypes.h"
+#include "RB_Random.h"
+#include "RB_Arena.h"
 #include <stdbool.h>
 
 // forward declaring structs here because the public-facing part of the library doesn't need to know their functions.
@@ -9,13 +11,44 @@
 typedef struct RB_AssignmentQueue_s RB_AssignmentQueue;
 typedef struct RB_ColorPool_s RB_ColorPool;
 typedef struct RB_PixelMap_s RB_PixelMap;
-typedef struct RB_Display_s RB_Display;
 
 typedef struct RB_Data_s RB_Data;
 
 typedef struct RB_Config_s RB_Config;
 
-// TODO: Decouple display from the rest of rainbow so that these structs don't need to be visible.
+#ifdef RB_ENABLE_STATS
+// See RB_Stats.h.
+typedef struct RB_Stats_s RB_Stats;
+#endif
+
+// The shape of the canvas, which determines which pixels are considered neighbors of the pixels on its edges.
+typedef enum {
+	// Pixels on the edges of the canvas have no neighbors beyond those edges.
+	RB_TOPOLOGY_RECTANGLE,
+	// The left edge wraps around to the right edge, and the top edge wraps around to the bottom edge.
+	RB_TOPOLOGY_TORUS,
+	// Like a torus, except that wrapping around the left or right edge also flips the canvas vertically.
+	RB_TOPOLOGY_KLEIN_BOTTLE,
+	// The neighbors beyond each edge are specified by a user-supplied remap table. See RB_PixelMap.h.
+	RB_TOPOLOGY_CUSTOM
+} RB_Topology;
+
+// The most observers that can be added to a rainbow at once.
+#define RB_MAX_PIXEL_OBSERVERS 4
+
+// Something that is told about every pixel a rainbow sets, such as a display. The rainbow knows nothing else about it,
+// so rainbows with no observers don't depend on anything that observers might use.
+typedef struct {
+	// Called every time a pixel is set.
+	void (*onPixelSet)(void* userData, RB_Coord, RB_Color);
+	// Called when the rainbow is reset, after which every pixel is blank. May be NULL.
+	void (*onReset)(void* userData);
+	// Called when the rainbow is freed. May be NULL.
+	void (*onFree)(void* userData);
+	void* userData;
+} RB_PixelObserver;
+
+// TODO: Consider making these structs opaque.
 struct RB_Config_s {
 	RB_Size width;
 	RB_Size height;
@@ -26,21 +59,60 @@ struct RB_Config_s {
 	RB_ColorChannelSize bRes;
 	bool colorResSet;
 
+	// The palette is only read by RB_init, so a rainbow's config doesn't keep it, but it does keep its length.
+	const RB_Color* palette;
+	RB_Size paletteLength;
+	bool paletteSet;
+
+	bool repeatColors;
+
 	int windowWidth;
 	int windowHeight;
 	bool windowDimensionsSet;
 
 	unsigned int seed;
 	bool seedSet;
+
+	RB_Topology topology;
+	const RB_Coord* topologyRemap;
+	bool topologySet;
+
+	RB_MapLayout mapLayout;
+	bool mapLayoutSet;
+
+	bool keepPristineColorPool;
+
+	bool useArena;
+	RB_ArenaPages arenaPages;
 };
 
 struct RB_Data_s {
 	RB_AssignmentQueue* assignmentQueue; // the queue of coordinates that should be assigned a color.
 	RB_ColorPool* colorPool;
 	RB_PixelMap* pixelMap;
-	RB_Display* display;
+	// An untouched copy of the color pool that RB_reset restores the pool from. May be NULL, in which case RB_reset
+	// rebuilds the pool instead.
+	RB_ColorPool* pristineColorPool;
+
+	// Told about every pixel that is set, in the order they were added. A rainbow starts out without any observers.
+	RB_PixelObserver pixelObservers[RB_MAX_PIXEL_OBSERVERS];
+	int numPixelObservers;
+
+	// Every random choice made while generating comes from here, so a generation depends only on its seed.
+	RB_Random random;
+
+	// Whether any pixel has been set since RB_init or the last RB_reset. The queue can't tell, since it is empty again
+	// once the rainbow is finished.
+	bool hasStarted;
 
 	RB_Config config;
+
+	// Where the queue, the pools and the pixel map are allocated from, or NULL if they are allocated on their own.
+	RB_Arena* arena;
+
+#ifdef RB_ENABLE_STATS
+	RB_Stats* stats;
+#endif
 };
 
 // CONFIG FUNCTIONS:
@@ -49,18 +121,69 @@ void RB_freeConfig(RB_Config*);
 
 void RB_setColorResolution(RB_Config*, RB_ColorChannelSize, RB_ColorChannelSize, RB_ColorChannelSize);
 
+// Makes the rainbow use the colors of the palette (duplicates included), rather than every color of a resolution.
+// The canvas must have exactly as many pixels as the palette has colors, so each color is used as many times as it
+// appears in the palette (and RB_setRepeatColors doesn't apply). The palette's channels are used as they are,
+// so this also sets every channel's resolution to RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION. Setting the color resolution
+// afterwards stops the palette from being used. The palette is not copied, so it must remain valid until RB_init is
+// called. See RB_createPaletteColorPool.
+void RB_setPalette(RB_Config*, const RB_Color* palette, RB_Size length);
+
+/*
+If true, the canvas doesn't need to have exactly as many pixels as there are colors. The pixels are shared out among
+the colors as evenly as possible instead (see RB_createCountedColorPool), so that on an 8K canvas with a color
+resolution of 128, for instance, every color is used either 15 or 16 times. The canvas can have up to
+RB_MAXIMUM_NUMBER_OF_PIXELS pixels. Without map dimensions, the canvas still has one pixel for every color.
+Region generation can't be used with repeated colors. Defaults to false.
+*/
+void RB_setRepeatColors(RB_Config*, bool);
+
 void RB_setMapDimensions(RB_Config*, RB_Size, RB_Size);
 
 void RB_setWindowDimensions(RB_Config*, int, int);
 
 void RB_setRandomSeed(RB_Config*, unsigned int);
 
+// Sets the topology of the canvas. The remap table is only used by RB_TOPOLOGY_CUSTOM, and is not copied, so it must
+// remain valid until RB_init is called. Custom topologies require the map dimensions to be set.
+void RB_setTopology(RB_Config*, RB_Topology, const RB_Coord* remapTable);
+
+// Sets the memory layout of the pixel map and the assignment queue. Tiled layouts are meant for very large canvases.
+void RB_setMapLayout(RB_Config*, RB_MapLayout);
+
+// If true, RB_init keeps an untouched copy of the color pool, which makes RB_reset faster at the cost of the copy's
+// memory. Defaults to false.
+void RB_setKeepPristineColorPool(RB_Config*, bool);
+
+// Makes RB_init allocate the assignment queue, the color pools and the pixel map from a single arena backed by the
+// specified kind of pages (see RB_Arena.h), instead of allocating each of them on its own. Defaults to off.
+void RB_useArena(RB_Config*, RB_ArenaPages);
+
+
+// Fills in the defaults for everything the config doesn't set (such as the map dimensions and the seed), exactly as
+// RB_init would. Returns false if the config can't be used to initialize a rainbow.
+bool RB_resolveConfig(const RB_Config*, RB_Config* resolved);
+
 
 // ALLOCATION FUNCTIONS:
+// Allocates a rainbow. The rainbow is headless: nothing is displayed unless a display is attached (see RB_Display.h).
 RB_Data* RB_init(RB_Config*);
 
 void RB_free(RB_Data*);
 
+// Returns the rainbow to the state RB_init left it in, as if it had been initialized with the specified seed, without
+// freeing or reallocating any of its memory. Returns true on success.
+bool RB_reset(RB_Data*, unsigned int seed);
+
+
+// OBSERVER FUNCTIONS:
+// Adds an observer to the rainbow. Returns false if the rainbow already has RB_MAX_PIXEL_OBSERVERS observers.
+bool RB_addPixelObserver(RB_Data*, RB_PixelObserver);
+
+// Removes the observer with the specified userData from the rainbow, without calling its onFree. Returns false if the
+// rainbow has no such observer.
+bool RB_removePixelObserver(RB_Data*, void* userData);
+
 
 // HELPER FUNCTIONS
 RB_Color RB_getRandomColor(RB_Data*);
@@ -70,7 +193,21 @@ RB_Coord RB_getRandomCoord(RB_Data*);
 // GENERATION FUNCTIONS:
 void RB_setCoordColor(RB_Data*, RB_Coord, RB_Color);
 
-// Sets the color for another pixel. Returns true if there are pixels left to generate, otherwise returns false.
+// Sets the color for another pixel. Returns true if there are pixels left to generate, otherwise returns false. Also
+// returns false, without setting anything, if no color could be found for the pixel.
 bool RB_generateNextPixel(RB_Data*);
 
+// Generates up to maxPixels pixels, stopping early if there are no pixels left to generate, or if no color could be
+// found for a pixel. Returns how many pixels were generated, which is less than maxPixels only once the rainbow is
+// finished, or once it can't go on.
+RB_Size RB_generatePixels(RB_Data*, RB_Size maxPixels);
+
+// How many pixels RB_generatePixelsUntil generates between checks of the clock.
+#define RB_DEADLINE_CHECK_INTERVAL 64
+
+// Generates pixels until the deadline (in the seconds of RB_getMonotonicSeconds, see RB_Clock.h) has passed, or until
+// there are no pixels left to generate. The deadline can be overrun by up to RB_DEADLINE_CHECK_INTERVAL pixels.
+// Returns how many pixels were generated.
+RB_Size RB_generatePixelsUntil(RB_Data*, double deadline);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef EKW_RAINBOW_RB_MAPPED_CANVAS_H
+#define EKW_RAINBOW_RB_MAPPED_CANVAS_H
+
+#include "RB_Main.h"
+#include <stdbool.h>
+
+typedef struct RB_MappedCanvas_s RB_MappedCanvas;
+
+/*
+Creates a binary (P6) PPM file at the path, maps it into memory, and adds it to the rainbow as a pixel observer.
+From then on, every pixel the rainbow sets is written straight into its place in the file, rescaled to 8 bits per
+channel the same way RB_writePPM rescales it, so the finished image never has to be encoded or copied. Since the
+file is a shared mapping, a crash still leaves everything generated so far on disk, as a viewable (partly black) PPM.
+
+Pixels that were set before the canvas was attached are copied into it. Resetting the rainbow blacks out the canvas.
+The canvas belongs to the rainbow, and is unmapped by RB_free. Returns NULL on failure. If the file was opened (and
+so truncated) before the failure, it is removed.
+*/
+RB_MappedCanvas* RB_attachMappedCanvas(RB_Data*, const char* path);
+
+// Blocks until everything written to the canvas so far is on disk. Returns true on success.
+bool RB_syncMappedCanvas(RB_MappedCanvas*);
+
+#endif
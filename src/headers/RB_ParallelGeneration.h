@@ -0,0 +1,35 @@
+#ifndef EKW_RAINBOW_RB_PARALLEL_GENERATION_H
+#define EKW_RAINBOW_RB_PARALLEL_GENERATION_H
+
+#include "RB_Main.h"
+#include "RB_BasicTypes.h"
+#include <stdbool.h>
+
+typedef struct RB_ParallelGenerator_s RB_ParallelGenerator;
+
+/*
+Allocates a generator that generates the pixels of a rainbow using several threads.
+
+Pixels are generated in rounds. At the start of each round, (numThreads * claimsPerThread) coords are claimed from the
+assignment queue. The threads then determine the preferred and ideal colors of the claimed coords at the same time,
+after which the claims are committed one at a time, in the order they were claimed. If an earlier claim in the same
+round took a claim's ideal color, that claim searches for a new color when it is committed.
+
+The result does not match single-threaded generation, but it is deterministic for a given seed, numThreads, and
+claimsPerThread. Larger values of claimsPerThread spend less time waiting for the other threads, but each pixel in
+a round is colored without knowing the colors of the other pixels in the same round.
+*/
+RB_ParallelGenerator* RB_createParallelGenerator(RB_Data*, int numThreads, RB_Size claimsPerThread);
+
+// Stops the generator's threads and frees the generator. Does not free the rainbow it was generating.
+void RB_freeParallelGenerator(RB_ParallelGenerator*);
+
+// Generates a round of pixels. Returns true if there are pixels left to generate, otherwise returns false. Also
+// returns false if a color search fails (which can only happen if its scratch space can't grow), in which case the
+// round stops there, and the claimed pixels that weren't set are put back in the queue.
+bool RB_generateNextPixelsInParallel(RB_ParallelGenerator*);
+
+// Returns the number of claims whose ideal color was taken by an earlier claim in the same round.
+RB_Size RB_getParallelConflictCount(RB_ParallelGenerator*);
+
+#endif
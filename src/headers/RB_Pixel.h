@@ -4,17 +4,19 @@
 #include "RB_BasicTypes.h"
 
 
+// Blank pixels are all zeroes (including their color), so zeroed memory is a map of blank pixels.
 typedef enum {
-	RB_PIXEL_BLANK,
+	RB_PIXEL_BLANK = 0,
 	RB_PIXEL_SET
 } RB_PixelStatus;
 
+// A pixel doesn't store its own coordinate, so that it stays small and so that a zeroed pixel is a valid blank pixel.
+// Its status is stored in a single byte, so that a whole pixel fits in 4 bytes.
 typedef struct {
-	RB_Coord loc;
-
 	RB_Color color;
 	
-	RB_PixelStatus status;
+	// An RB_PixelStatus.
+	uint8_t status;
 } RB_Pixel;
 
 #endif
\ No newline at end of file
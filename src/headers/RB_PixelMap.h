@@ -4,9 +4,55 @@
 #include "RB_Main.h"
 #include "RB_BasicTypes.h"
 #include "RB_Pixel.h"
+#include "RB_Arena.h"
 
-// allocates a pixel map with the specified dimensions
-RB_PixelMap* RB_createPixelMap(RB_Size, RB_Size);
+// allocates a pixel map with the specified dimensions and memory layout
+RB_PixelMap* RB_createPixelMap(RB_Size, RB_Size, RB_MapLayout);
+
+// The same as RB_createPixelMap, but the map (and any tiles it allocates later) comes out of the arena's pixel map
+// budget. The arena must outlive the map.
+RB_PixelMap* RB_createPixelMapInArena(RB_Arena*, RB_Size, RB_Size, RB_MapLayout);
+
+// Returns how much of an arena's budget a pixel map with the specified dimensions and layout can use, at most.
+size_t RB_getPixelMapArenaBudget(RB_Size, RB_Size, RB_MapLayout);
+
+/*
+Sets the topology of the pixel map. Returns true on success, or false if the topology could not be set.
+
+A remap table describes the ring of coordinates just outside of the map, from (-1, -1) to (width, height).
+Each entry holds the in-map coordinate that the outside coordinate is considered to be, or a coordinate with a
+negative x if the outside coordinate has no counterpart. RB_getTopologyRemapIndex gives the position in the
+table of each outside coordinate. The table is only read for RB_TOPOLOGY_CUSTOM, and it is copied.
+*/
+bool RB_setPixelMapTopology(RB_PixelMap*, RB_Topology, const RB_Coord* remapTable);
+
+// Returns the number of entries in a topology remap table for a map with the specified dimensions.
+RB_Size RB_getTopologyRemapLength(RB_Size width, RB_Size height);
+
+// Returns the position in a topology remap table of a coordinate just outside of a map with the specified dimensions.
+// If the coordinate is not just outside of the map, returns -1.
+RB_Size RB_getTopologyRemapIndex(RB_Size width, RB_Size height, RB_Coord);
+
+// Copies the colors of length pixels, going down the column from (x, y), into the array. Blank pixels are black.
+// Unlike RB_getPixel, this never allocates anything, and the pixels are read in the order they are stored in.
+void RB_readPixelMapColumn(RB_PixelMap*, RB_Size x, RB_Size y, RB_Size length, RB_Color* colors);
+
+// Like RB_readPixelMapColumn, but copies whether each pixel has been set instead of its color.
+void RB_readPixelMapColumnStatuses(RB_PixelMap*, RB_Size x, RB_Size y, RB_Size length, RB_PixelStatus* statuses);
+
+// Returns the remap table that the map's topology uses, or NULL if the map doesn't have one. See
+// RB_setPixelMapTopology.
+const RB_Coord* RB_getPixelMapTopologyRemap(RB_PixelMap*);
+
+// Marks every pixel in the map as blank, reusing the map's memory. The map's topology is kept.
+void RB_clearPixelMap(RB_PixelMap*);
+
+// Overwrites the destination map with the state (including the topology) of the source map. Both maps must have the
+// same dimensions and layout. Returns true on success.
+bool RB_copyPixelMap(RB_PixelMap* dest, const RB_PixelMap* src);
+
+// Allocates a new pixel map with the same state as the specified map.
+RB_PixelMap* RB_clonePixelMap(const RB_PixelMap*);
 
 // deallocates the pixel map
 void RB_freePixelMap(RB_PixelMap*);
@@ -15,6 +61,7 @@ void RB_freePixelMap(RB_PixelMap*);
 RB_Pixel* RB_getPixel(RB_PixelMap*, RB_Coord);
 
 // Determines, based on the current state of the pixelMap, the preferred color for the specified coordinate.
+// This never modifies the pixelMap, so several threads can call it at once as long as no pixels are being set.
 RB_Color RB_determinePreferredCoordColor(RB_PixelMap*, RB_Coord);
 
 // Add cords to the queue in an implementation-defined pattern relative to the given coord
@@ -0,0 +1,30 @@
+#ifndef EKW_RAINBOW_RB_PIXEL_RING_H
+#define EKW_RAINBOW_RB_PIXEL_RING_H
+
+#include "RB_BasicTypes.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+	RB_Coord coord;
+	RB_Color color;
+} RB_PixelUpdate;
+
+// A fixed-size, lock-free queue of pixel updates, for passing them from exactly one producer thread to exactly one
+// consumer thread. Neither side ever waits for the other.
+typedef struct RB_PixelRing_s RB_PixelRing;
+
+// Allocates a ring that can hold at least the specified number of updates. The capacity is rounded up to a power of two.
+RB_PixelRing* RB_createPixelRing(size_t capacity);
+
+void RB_freePixelRing(RB_PixelRing*);
+
+// Adds an update to the ring. Returns false (and doesn't add the update) if the ring is full.
+// Must only be called by the producer.
+bool RB_pushPixelUpdate(RB_PixelRing*, RB_PixelUpdate);
+
+// Removes up to maxUpdates of the oldest updates from the ring, in the order they were pushed, and copies them into the
+// array. Returns how many were removed. Must only be called by the consumer.
+size_t RB_popPixelUpdates(RB_PixelRing*, RB_PixelUpdate* updates, size_t maxUpdates);
+
+#endif
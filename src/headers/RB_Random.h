@@ -0,0 +1,23 @@
+#ifndef EKW_RAINBOW_RB_RANDOM_H
+#define EKW_RAINBOW_RB_RANDOM_H
+
+#include "RB_BasicTypes.h"
+#include <stdint.h>
+
+// The state of a random number generator. Every generator is independent of every other generator (and of rand()),
+// so each thread can own one, and a generator's output depends only on its seed.
+typedef struct {
+	uint64_t state;
+} RB_Random;
+
+// Seeds the generator. Generators with the same seed produce the same sequence of numbers.
+void RB_seedRandom(RB_Random*, uint64_t seed);
+
+// Returns a uniformly distributed random 64-bit number.
+uint64_t RB_nextRandom(RB_Random*);
+
+// Returns a uniformly distributed random number between 0 (inclusive) and bound (exclusive), without modulo bias.
+// bound must be positive.
+RB_USize RB_getRandomBelow(RB_Random*, RB_USize bound);
+
+#endif
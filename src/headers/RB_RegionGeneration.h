@@ -0,0 +1,28 @@
+#ifndef EKW_RAINBOW_RB_REGION_GENERATION_H
+#define EKW_RAINBOW_RB_REGION_GENERATION_H
+
+#include "RB_Main.h"
+#include "RB_BasicTypes.h"
+#include <stdbool.h>
+
+/*
+Generates an entire rainbow as several independent regions, which can all be generated at the same time.
+
+The canvas is split into numRegions horizontal bands, and the red channel is split into numRegions slices. Each band
+gets its own color pool (containing only its slice of the color cube), its own assignment queue, its own pixel map,
+and its own seed, so the bands share no mutable state at all and scale with the number of threads. The result is
+visibly structured into bands.
+
+Once every band is finished, the results are written into the rainbow using RB_setCoordColor. If blendBoundaries is
+true, pixels near the boundaries between bands are first swapped across the boundaries wherever that makes them
+closer to their new neighbors, which softens the seams without changing which colors are used.
+
+The rainbow must not have any pixels set yet. Each band must contain exactly as many pixels as its slice contains
+colors, so (sliceSize * gRes * bRes) must be divisible by the map width for every slice; if it isn't, nothing is
+generated and false is returned. Regions use rectangular topologies, regardless of the rainbow's topology, and
+rainbows with a palette or repeated colors can't be split into regions.
+Returns true on success.
+*/
+bool RB_generateRegions(RB_Data*, int numRegions, int numThreads, bool blendBoundaries);
+
+#endif
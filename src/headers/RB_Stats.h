@@ -0,0 +1,84 @@
+#ifndef EKW_RAINBOW_RB_STATS_H
+#define EKW_RAINBOW_RB_STATS_H
+
+/*
+Statistics about where a rainbow's generation spends its time. They are only collected when the library is compiled
+with RB_ENABLE_STATS defined (for instance, with `make headless RB_DEFINES=-DRB_ENABLE_STATS`). Otherwise, nothing in
+this header exists, and generating doesn't do any extra work at all.
+
+Only pixels generated by RB_generateNextPixel, RB_generatePixels and RB_generatePixelsUntil, for rainbows made by
+RB_init (or RB_loadCheckpoint), are counted. Batches, parallel generation and region generation aren't.
+*/
+#ifdef RB_ENABLE_STATS
+
+#include "RB_Main.h"
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum {
+	// RB_chooseCoordFromAssignmentQueue
+	RB_STATS_PHASE_CHOOSE_COORD,
+	// RB_determinePreferredCoordColor
+	RB_STATS_PHASE_PREFERRED_COLOR,
+	// RB_findIdealAvailableColor
+	RB_STATS_PHASE_FIND_COLOR,
+	// RB_setCoordColor, including the observers and queueing the pixel's neighbors
+	RB_STATS_PHASE_SET_COLOR,
+	RB_NUM_STATS_PHASES
+} RB_StatsPhase;
+
+// Bucket 0 of a histogram counts zeroes, and bucket i counts values from 2^(i - 1) up to (but not including) 2^i.
+// The last bucket also counts everything larger.
+#define RB_STATS_HISTOGRAM_BUCKETS 32
+
+// How many pixels are generated between samples of the size of the frontier (the assignment queue).
+#define RB_STATS_FRONTIER_SAMPLE_INTERVAL 1024
+
+struct RB_Stats_s {
+	uint64_t numPixels;
+	double phaseSeconds[RB_NUM_STATS_PHASES];
+
+	// How many nodes of the color pool's tree each color query looked at.
+	uint64_t nodesVisited[RB_STATS_HISTOGRAM_BUCKETS];
+	// How many passes over its node queue each color query took.
+	uint64_t searchPasses[RB_STATS_HISTOGRAM_BUCKETS];
+	// The square distance between the color each pixel preferred and the color it was given.
+	uint64_t colorDistances[RB_STATS_HISTOGRAM_BUCKETS];
+
+	uint64_t totalNodesVisited;
+	uint64_t totalSearchPasses;
+	uint64_t totalColorDistance;
+
+	// The size of the frontier before every RB_STATS_FRONTIER_SAMPLE_INTERVAL-th pixel.
+	RB_StoredSize* frontierSamples;
+	size_t numFrontierSamples;
+	size_t frontierSamplesCapacity;
+};
+
+// Returns the rainbow's statistics, which are collected from RB_init onwards, and start over on RB_reset.
+const RB_Stats* RB_getStats(RB_Data*);
+
+// Returns the histogram bucket that the value is counted in.
+int RB_getStatsHistogramBucket(uint64_t value);
+
+// Prints a human-readable summary of the statistics.
+void RB_printStats(FILE*, const RB_Stats*);
+
+// Used by the rainbow to keep its statistics. None of these need to be called by anything else.
+RB_Stats* RB_createStats();
+void RB_freeStats(RB_Stats*);
+void RB_clearStats(RB_Stats*);
+// Records a pixel that was just generated. The durations of the phases are given in seconds.
+void RB_recordPixelStats(
+	RB_Stats*,
+	const double phaseSeconds[RB_NUM_STATS_PHASES],
+	uint64_t nodesVisited,
+	uint64_t searchPasses,
+	RB_Color preferred,
+	RB_Color assigned,
+	RB_Size frontierSize
+);
+
+#endif
+
+#endif
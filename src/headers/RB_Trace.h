@@ -0,0 +1,67 @@
+#ifndef EKW_RAINBOW_RB_TRACE_H
+#define EKW_RAINBOW_RB_TRACE_H
+
+/*
+A trace of where a rainbow's time goes, in the Chrome trace event format, which chrome://tracing and Perfetto
+(ui.perfetto.dev) can open. Events are only recorded when the library is compiled with RB_ENABLE_TRACE defined (for
+instance, with `make headless RB_DEFINES=-DRB_ENABLE_TRACE`). Otherwise, the macros below expand to nothing, and
+nothing else in this header exists.
+
+Every thread records its events into a buffer of its own, so recording an event never takes a lock. The traced
+events are:
+- building color pool trees (including resets and rebuilds)
+- every call to RB_generatePixels and RB_generatePixelsUntil (so every chunk of the generation pipeline)
+- parallel generation rounds, region generation regions and batch jobs
+- display flushes, frame exports, and checkpoint saves and loads
+- one in every RB_TRACE_SAMPLE_INTERVAL calls to RB_findIdealAvailableColor (on each thread), with how many nodes of
+  the tree it looked at. Timing every search would cost far more than the searches themselves.
+*/
+
+#ifdef RB_ENABLE_TRACE
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Nanoseconds, according to the monotonic clock.
+typedef uint64_t RB_TraceTimestamp;
+
+// One in this many color searches on each thread is traced.
+#define RB_TRACE_SAMPLE_INTERVAL 1024
+
+// The most events a single thread records. Any more are counted, but dropped.
+#define RB_TRACE_MAX_EVENTS_PER_THREAD (1 << 20)
+
+RB_TraceTimestamp RB_getTraceTimestamp();
+
+// Records an event from start until now, on the calling thread. The name and argName must be string literals (or
+// otherwise outlive the trace). If argName is NULL, the event has no argument.
+void RB_recordTraceEvent(const char* name, RB_TraceTimestamp start, const char* argName, int64_t argValue);
+
+// Names the calling thread in the trace. The name must outlive the trace.
+void RB_nameTraceThread(const char* name);
+
+// Returns true once every RB_TRACE_SAMPLE_INTERVAL calls on each thread.
+bool RB_shouldSampleTrace();
+
+// Writes every event recorded so far to the file. Returns false if the file couldn't be written.
+bool RB_writeTrace(const char* path);
+
+// Makes the trace be written to the file when the program exits. The path must outlive the program.
+bool RB_writeTraceAtExit(const char* path);
+
+#define RB_TRACE_BEGIN(startVar) RB_TraceTimestamp startVar = RB_getTraceTimestamp()
+#define RB_TRACE_END(startVar, name) RB_recordTraceEvent(name, startVar, NULL, 0)
+#define RB_TRACE_END_WITH_ARG(startVar, name, argName, argValue) \
+	RB_recordTraceEvent(name, startVar, argName, (int64_t) (argValue))
+#define RB_TRACE_THREAD_NAME(name) RB_nameTraceThread(name)
+
+#else
+
+#define RB_TRACE_BEGIN(startVar)
+#define RB_TRACE_END(startVar, name)
+#define RB_TRACE_END_WITH_ARG(startVar, name, argName, argValue)
+#define RB_TRACE_THREAD_NAME(name)
+
+#endif
+
+#endif
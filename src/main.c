@@ -1,33 +1,126 @@
 #include "headers/RB_Main.h"
+#include "headers/RB_Clock.h"
+#include "headers/RB_ImageOutput.h"
+#include "headers/RB_MappedCanvas.h"
+#include "headers/RB_Stats.h"
+#include "headers/RB_Trace.h"
+#ifndef RB_HEADLESS
 #include "headers/RB_Display.h"
+#include "headers/RB_GenerationPipeline.h"
+#endif
 #include <stdbool.h>
+#include <stdio.h>
 #include <time.h>
 #include <stdlib.h>
+#include <string.h>
+
+bool pathHasExtension(const char* path, const char* extension) {
+	size_t pathLength = strlen(path);
+	size_t extensionLength = strlen(extension);
+	return pathLength >= extensionLength && strcmp(path + pathLength - extensionLength, extension) == 0;
+}
 
 int main(int argc, char** argv) {
+	// The only argument is the output path, so anything that looks like an option (such as --help) is refused rather
+	// than being written to.
+	if(argc > 2 || (argc > 1 && argv[1][0] == '-')) {
+		fprintf(stderr, "Usage: %s [output path (.png, or .ppm otherwise)]\n", argv[0]);
+		return 1;
+	}
+
+#ifdef RB_ENABLE_TRACE
+	RB_TRACE_THREAD_NAME("main");
+	RB_writeTraceAtExit("rainbowTrace.json");
+#endif
+
 	RB_Config* config = RB_newConfig();
 	RB_setColorResolution(config, 64, 64, 64);
 	RB_setWindowDimensions(config, 512, 512);
+	RB_useArena(config, RB_ARENA_PAGES_TRANSPARENT_HUGE);
 
 	RB_Data* rainbow = RB_init(config);
 
+	if(rainbow == NULL) {
+		RB_freeConfig(config);
+		return 1;
+	}
+
+	// Headless PPMs are generated straight into the output file, so they never have to be written out at the end.
+	bool outputIsMapped = false;
+
+#ifdef RB_HEADLESS
+	if(argc > 1 && pathHasExtension(argv[1], ".ppm")) {
+		outputIsMapped = RB_attachMappedCanvas(rainbow, argv[1]) != NULL;
+	}
+
+	double startTime = RB_getMonotonicSeconds();
+
 	RB_setCoordColor(rainbow, RB_getRandomCoord(rainbow), RB_getRandomColor(rainbow));
+	RB_generatePixels(rainbow, rainbow->config.width * rainbow->config.height);
+
+	printf("Generated the rainbow in %.3f seconds.\n", RB_getMonotonicSeconds() - startTime);
+	RB_printArenaUsage(stdout, rainbow->arena);
+#else
+	// The display is driven by this thread, while the rainbow is generated on the pipeline's thread.
+	RB_Display* display = RB_createDisplay(
+		rainbow->config.windowWidth, rainbow->config.windowHeight,
+		rainbow->config.width, rainbow->config.height,
+		rainbow->config.rRes, rainbow->config.gRes, rainbow->config.bRes
+	);
+
+	if(display == NULL) {
+		fprintf(stderr, "Failed to initialize Display!\n");
+		RB_free(rainbow);
+		RB_freeConfig(config);
+		return 1;
+	}
 
-	bool shouldQuit = false;
+	RB_GenerationPipeline* pipeline = RB_createGenerationPipeline(rainbow, display, 1 << 16);
 
-	while(RB_generateNextPixel(rainbow)) {
-		RB_updateDisplay(rainbow->display);
-		if(RB_handleWindowEvents(rainbow->display) == 0) {
+	if(pipeline == NULL) {
+		fprintf(stderr, "Failed to initialize Generation Pipeline!\n");
+		RB_freeDisplay(display);
+		RB_free(rainbow);
+		RB_freeConfig(config);
+		return 1;
+	}
+
+	RB_setCoordColor(rainbow, RB_getRandomCoord(rainbow), RB_getRandomColor(rainbow));
+
+	bool shouldQuit = !RB_startGenerationPipeline(pipeline);
+	struct timespec pause = { .tv_sec = 0, .tv_nsec = 1000000 };
+
+	while(!shouldQuit && RB_drainGenerationPipeline(pipeline)) {
+		if(RB_handleWindowEvents(display) == 0) {
 			shouldQuit = true;
 			break;
 		}
+		nanosleep(&pause, NULL);
 	}
 
+	RB_freeGenerationPipeline(pipeline);
+
 	if(!shouldQuit) {
-		RB_forceUpdateDisplay(rainbow->display, false);
-		while(RB_handleWindowEvents(rainbow->display) != 0);
+		while(RB_handleWindowEvents(display) != 0) {
+			nanosleep(&pause, NULL);
+		}
+	}
+
+	RB_freeDisplay(display);
+#endif
+
+#ifdef RB_ENABLE_STATS
+	RB_printStats(stdout, RB_getStats(rainbow));
+#endif
+
+	// If an output path is given, the image is saved there, as a PNG if the path ends in .png, or as a PPM otherwise.
+	if(argc > 1 && !outputIsMapped) {
+		if(pathHasExtension(argv[1], ".png")) {
+			RB_writePNG(rainbow, argv[1], NULL);
+		} else {
+			RB_writePPM(rainbow, argv[1], NULL);
+		}
 	}
-	
 
 	RB_free(rainbow);
 	RB_freeConfig(config);
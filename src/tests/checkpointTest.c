@@ -0,0 +1,214 @@
+#include "headers/RB_Main.h"
+#include "headers/RB_Checkpoint.h"
+#include "headers/RB_PixelMap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+Saves rainbows partway through generating them, loads them back, and finishes them, and checks that every resumed
+rainbow ends up exactly the same as the same rainbow generated without stopping. Lattice, palette and repeated-color
+rainbows are each saved at several points, with both map layouts and several topologies.
+
+Usage: checkpointTest [checkpoint path]
+
+Returns 0 if every check passed.
+*/
+
+typedef enum {
+	RB_TEST_CONFIG_LATTICE,
+	// A palette with many duplicated colors, so that pixels often have several equally close colors to choose from.
+	RB_TEST_CONFIG_PALETTE,
+	RB_TEST_CONFIG_REPEAT
+} CheckpointTestKind;
+
+typedef struct {
+	const char* name;
+	CheckpointTestKind kind;
+	RB_Topology topology;
+	RB_MapLayout mapLayout;
+} CheckpointTestCase;
+
+const CheckpointTestCase checkpointTestCases[] = {
+	{ "lattice", RB_TEST_CONFIG_LATTICE, RB_TOPOLOGY_RECTANGLE, RB_MAP_LAYOUT_FLAT },
+	{ "lattice", RB_TEST_CONFIG_LATTICE, RB_TOPOLOGY_TORUS, RB_MAP_LAYOUT_TILED },
+	{ "palette", RB_TEST_CONFIG_PALETTE, RB_TOPOLOGY_RECTANGLE, RB_MAP_LAYOUT_FLAT },
+	{ "palette", RB_TEST_CONFIG_PALETTE, RB_TOPOLOGY_KLEIN_BOTTLE, RB_MAP_LAYOUT_TILED },
+	{ "repeat", RB_TEST_CONFIG_REPEAT, RB_TOPOLOGY_RECTANGLE, RB_MAP_LAYOUT_FLAT },
+	{ "repeat", RB_TEST_CONFIG_REPEAT, RB_TOPOLOGY_TORUS, RB_MAP_LAYOUT_TILED }
+};
+#define RB_NUM_CHECKPOINT_TEST_CASES (sizeof(checkpointTestCases) / sizeof(checkpointTestCases[0]))
+
+// How far through each rainbow it is saved, in percent. A rainbow is never saved before its first pixel is set.
+const int checkpointTestPercents[] = { 0, 10, 50, 99 };
+#define RB_NUM_CHECKPOINT_TEST_PERCENTS (sizeof(checkpointTestPercents) / sizeof(checkpointTestPercents[0]))
+
+#define RB_TEST_PALETTE_WIDTH 128
+#define RB_TEST_PALETTE_HEIGHT 96
+
+int numFailures = 0;
+
+void reportFailure(const CheckpointTestCase* test, int percent, const char* message) {
+	numFailures++;
+	// Anything after the first few failures is almost always the same bug.
+	if(numFailures <= 20) {
+		fprintf(
+			stderr, "FAILED (%s, topology %d, layout %d, saved at %d%%): %s.\n",
+			test->name, (int) test->topology, (int) test->mapLayout, percent, message
+		);
+	}
+}
+
+// The palette must stay valid until RB_init is called.
+RB_Config* createCheckpointTestConfig(const CheckpointTestCase* test, RB_Color* palette) {
+	RB_Config* config = RB_newConfig();
+
+	if(test->kind == RB_TEST_CONFIG_LATTICE) {
+		RB_setColorResolution(config, 32, 32, 32);
+		RB_setMapDimensions(config, 256, 128);
+	} else if(test->kind == RB_TEST_CONFIG_PALETTE) {
+		// Every color appears several times, and the colors are coarse enough to often be the same distance apart.
+		for(int i = 0; i < RB_TEST_PALETTE_WIDTH * RB_TEST_PALETTE_HEIGHT; i++) {
+			int index = i / 3;
+			palette[i] = (RB_Color) { .r = (index * 16) & 255, .g = ((index / 16) * 16) & 255, .b = (index / 256) * 16 };
+		}
+		RB_setPalette(config, palette, RB_TEST_PALETTE_WIDTH * RB_TEST_PALETTE_HEIGHT);
+		RB_setMapDimensions(config, RB_TEST_PALETTE_WIDTH, RB_TEST_PALETTE_HEIGHT);
+	} else {
+		RB_setColorResolution(config, 8, 8, 8);
+		RB_setRepeatColors(config, true);
+		RB_setMapDimensions(config, 200, 100);
+	}
+
+	RB_setRandomSeed(config, 99);
+	RB_setTopology(config, test->topology, NULL);
+	RB_setMapLayout(config, test->mapLayout);
+	return config;
+}
+
+// Starts the rainbow, and generates up to numPixels of it (including the first).
+void startCheckpointTestRainbow(RB_Data* data, RB_Size numPixels) {
+	RB_setCoordColor(data, RB_getRandomCoord(data), RB_getRandomColor(data));
+	RB_generatePixels(data, numPixels - 1);
+}
+
+// Returns true if the two rainbows have exactly the same pixels.
+bool rainbowsAreIdentical(RB_Data* a, RB_Data* b) {
+	RB_Size width = a->config.width;
+	RB_Size height = a->config.height;
+
+	if(b->config.width != width || b->config.height != height) {
+		return false;
+	}
+
+	RB_Color* aColumn = (RB_Color*) malloc(sizeof(RB_Color) * height);
+	RB_Color* bColumn = (RB_Color*) malloc(sizeof(RB_Color) * height);
+	RB_PixelStatus* aStatuses = (RB_PixelStatus*) malloc(sizeof(RB_PixelStatus) * height);
+	RB_PixelStatus* bStatuses = (RB_PixelStatus*) malloc(sizeof(RB_PixelStatus) * height);
+	bool identical = aColumn != NULL && bColumn != NULL && aStatuses != NULL && bStatuses != NULL;
+
+	for(RB_Size x = 0; x < width && identical; x++) {
+		RB_readPixelMapColumn(a->pixelMap, x, 0, height, aColumn);
+		RB_readPixelMapColumn(b->pixelMap, x, 0, height, bColumn);
+		RB_readPixelMapColumnStatuses(a->pixelMap, x, 0, height, aStatuses);
+		RB_readPixelMapColumnStatuses(b->pixelMap, x, 0, height, bStatuses);
+
+		for(RB_Size y = 0; y < height; y++) {
+			if(!RB_colorsAreEqual(aColumn[y], bColumn[y]) || aStatuses[y] != bStatuses[y]) {
+				identical = false;
+				break;
+			}
+		}
+	}
+
+	free(aColumn);
+	free(bColumn);
+	free(aStatuses);
+	free(bStatuses);
+	return identical;
+}
+
+void runCheckpointTest(const CheckpointTestCase* test, const char* path) {
+	RB_Color* palette = (RB_Color*) malloc(sizeof(RB_Color) * RB_TEST_PALETTE_WIDTH * RB_TEST_PALETTE_HEIGHT);
+	if(palette == NULL) {
+		reportFailure(test, 0, "the palette could not be allocated");
+		return;
+	}
+
+	RB_Config* config = createCheckpointTestConfig(test, palette);
+	RB_Data* uninterrupted = RB_init(config);
+
+	if(uninterrupted == NULL) {
+		reportFailure(test, 0, "the rainbow could not be initialized");
+		RB_freeConfig(config);
+		free(palette);
+		return;
+	}
+
+	RB_Size numPixels = uninterrupted->config.width * uninterrupted->config.height;
+	startCheckpointTestRainbow(uninterrupted, numPixels);
+
+	for(size_t i = 0; i < RB_NUM_CHECKPOINT_TEST_PERCENTS; i++) {
+		int percent = checkpointTestPercents[i];
+		RB_Data* saved = RB_init(config);
+
+		if(saved == NULL) {
+			reportFailure(test, percent, "the rainbow could not be initialized");
+			continue;
+		}
+
+		startCheckpointTestRainbow(saved, 1 + ((numPixels - 1) * percent) / 100);
+		bool wasSaved = RB_saveCheckpoint(saved, path);
+		RB_free(saved);
+
+		RB_Data* resumed = wasSaved? RB_loadCheckpoint(path) : NULL;
+		if(resumed == NULL) {
+			reportFailure(test, percent, "the checkpoint could not be saved and loaded");
+			continue;
+		}
+
+		RB_generatePixels(resumed, numPixels);
+
+		if(!rainbowsAreIdentical(uninterrupted, resumed)) {
+			reportFailure(test, percent, "the resumed rainbow differs from the uninterrupted one");
+		}
+
+		RB_free(resumed);
+	}
+
+	remove(path);
+	RB_free(uninterrupted);
+	RB_freeConfig(config);
+	free(palette);
+}
+
+int main(int argc, char** argv) {
+	if(argc > 2) {
+		fprintf(stderr, "Usage: %s [checkpoint path]\n", argv[0]);
+		return 1;
+	}
+
+	const char* path = (argc > 1)? argv[1] : "checkpointTest.rbcp";
+
+	for(size_t i = 0; i < RB_NUM_CHECKPOINT_TEST_CASES; i++) {
+		const CheckpointTestCase* test = &(checkpointTestCases[i]);
+		int failuresBefore = numFailures;
+
+		runCheckpointTest(test, path);
+
+		fprintf(
+			stderr,
+			"%s %s, topology %d, layout %d\n",
+			(numFailures == failuresBefore)? "ok    " : "FAILED",
+			test->name, (int) test->topology, (int) test->mapLayout
+		);
+	}
+
+	if(numFailures > 0) {
+		fprintf(stderr, "%d checks failed.\n", numFailures);
+		return 1;
+	}
+
+	fprintf(stderr, "Every check passed.\n");
+	return 0;
+}
@@ -0,0 +1,1031 @@
+#include "headers/RB_ColorPool.h"
+#include "headers/RB_Random.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+A differential fuzz test of the color pools. Random sequences of searches and removals are run against each pool, and
+every color a search returns is checked against a brute-force scan of the colors that are still available. The pool's
+tree invariants are checked along the way, and so are pools rebuilt from the same availability. Palette pools are
+tested the same way, against a brute-force scan of the palette, and so are pools whose colors can be taken several
+times, against a count of how many times each color is left. Concurrent pools are also emptied by several threads at
+once, and every claim is checked against the colors that were still available while it was being made.
+
+Usage: colorPoolTest [seed] [operations per resolution]
+
+Returns 0 if every check passed.
+*/
+
+typedef struct {
+	RB_ColorChannelSize rRes;
+	RB_ColorChannelSize gRes;
+	RB_ColorChannelSize bRes;
+} TestResolution;
+
+// Tiny pools, powers of two, non-powers of two, and unequal resolutions (including single-value channels).
+const TestResolution testResolutions[] = {
+	{ 1, 1, 1 },
+	{ 1, 1, 2 },
+	{ 2, 2, 2 },
+	{ 3, 3, 3 },
+	{ 1, 17, 4 },
+	{ 3, 5, 7 },
+	{ 7, 3, 2 },
+	{ 16, 16, 16 },
+	{ 31, 29, 37 },
+	{ 64, 1, 64 },
+	{ 50, 40, 30 },
+	{ 64, 64, 64 }
+};
+#define RB_NUM_TEST_RESOLUTIONS (sizeof(testResolutions) / sizeof(testResolutions[0]))
+
+typedef enum {
+	RB_TEST_PALETTE_RANDOM,
+	RB_TEST_PALETTE_CLUSTERED,
+	RB_TEST_PALETTE_FEW_DISTINCT
+} TestPaletteKind;
+
+typedef struct {
+	const char* name;
+	TestPaletteKind kind;
+	RB_Size length;
+} TestPalette;
+
+// A single color, runs of duplicates, colors crowded into a few small clusters, and colors spread over the whole cube.
+const TestPalette testPalettes[] = {
+	{ "single color", RB_TEST_PALETTE_FEW_DISTINCT, 1 },
+	{ "one color repeated", RB_TEST_PALETTE_FEW_DISTINCT, 300 },
+	{ "few distinct colors", RB_TEST_PALETTE_FEW_DISTINCT, 3000 },
+	{ "clustered", RB_TEST_PALETTE_CLUSTERED, 4000 },
+	{ "random", RB_TEST_PALETTE_RANDOM, 5000 }
+};
+#define RB_NUM_TEST_PALETTES (sizeof(testPalettes) / sizeof(testPalettes[0]))
+
+typedef struct {
+	TestResolution res;
+	size_t totalCount;
+} TestCountedPool;
+
+// Pools with more uses than colors (with 8, 16 and 32-bit counts), an uneven share, and fewer uses than colors.
+const TestCountedPool testCountedPools[] = {
+	{ { 4, 4, 4 }, 1000 },
+	{ { 3, 5, 7 }, 500 },
+	{ { 8, 8, 8 }, 3000 },
+	{ { 16, 16, 16 }, 2000 },
+	{ { 2, 2, 2 }, 3000 },
+	{ { 1, 1, 1 }, 70000 }
+};
+#define RB_NUM_TEST_COUNTED_POOLS (sizeof(testCountedPools) / sizeof(testCountedPools[0]))
+
+// Checking every claim against every color takes time proportional to the square of the number of colors, so the
+// concurrent pools that are stressed by several threads are kept small.
+const TestResolution testConcurrentResolutions[] = {
+	{ 1, 1, 2 },
+	{ 1, 17, 4 },
+	{ 3, 5, 7 },
+	{ 16, 16, 16 },
+	{ 20, 24, 12 }
+};
+#define RB_NUM_TEST_CONCURRENT_RESOLUTIONS (sizeof(testConcurrentResolutions) / sizeof(testConcurrentResolutions[0]))
+
+// How many threads claim colors from a concurrent pool at once.
+#define RB_TEST_CONCURRENT_THREADS 8
+// A pool that has lost track of its colors can keep its threads searching forever, so after this long, they are
+// assumed to be stuck.
+#define RB_TEST_CONCURRENT_TIMEOUT_SECONDS 60
+
+// How many operations are run between checks of the tree's invariants.
+#define RB_TEST_INVARIANT_INTERVAL 97
+
+// How many threads pools are rebuilt by.
+#define RB_TEST_REBUILD_THREADS 5
+
+int numFailures = 0;
+
+void reportFailure(const char* poolName, const char* message, RB_Color color) {
+	numFailures++;
+	// Anything after the first few failures is almost always the same bug.
+	if(numFailures <= 20) {
+		fprintf(stderr, "FAILED (%s): %s, Color(%d, %d, %d).\n", poolName, message, color.r, color.g, color.b);
+	}
+}
+
+void reportTestFailure(const TestResolution* res, const char* message, RB_Color color) {
+	char poolName[64];
+	snprintf(poolName, sizeof(poolName), "%d x %d x %d", (int) res->rRes, (int) res->gRes, (int) res->bRes);
+	reportFailure(poolName, message, color);
+}
+
+RB_ColorSquareDistance getTestDistance(RB_Color a, RB_Color b) {
+	int dR = (int) a.r - (int) b.r;
+	int dG = (int) a.g - (int) b.g;
+	int dB = (int) a.b - (int) b.b;
+	return (RB_ColorSquareDistance) ((dR * dR) + (dG * dG) + (dB * dB));
+}
+
+// Returns the distance to the closest color that is still available, according to the availability array, or -1 if
+// no colors are available.
+int64_t findClosestDistanceByBruteForce(const TestResolution* res, const bool* available, RB_Color desired) {
+	int64_t best = -1;
+	size_t i = 0;
+
+	for(RB_ColorChannelSize r = 0; r < res->rRes; r++) {
+		for(RB_ColorChannelSize g = 0; g < res->gRes; g++) {
+			for(RB_ColorChannelSize b = 0; b < res->bRes; b++) {
+				if(available[i]) {
+					int64_t distance = getTestDistance(desired, (RB_Color) { .r = r, .g = g, .b = b });
+					if(best < 0 || distance < best) {
+						best = distance;
+					}
+				}
+				i++;
+			}
+		}
+	}
+
+	return best;
+}
+
+size_t getTestColorIndex(const TestResolution* res, RB_Color color) {
+	return (((size_t) color.r * res->gRes) + color.g) * res->bRes + color.b;
+}
+
+RB_Color getRandomTestColor(const TestResolution* res, RB_Random* random) {
+	return (RB_Color) {
+		.r = RB_getRandomBelow(random, res->rRes),
+		.g = RB_getRandomBelow(random, res->gRes),
+		.b = RB_getRandomBelow(random, res->bRes)
+	};
+}
+
+// Checks that a pool rebuilt from the pool's availability is consistent, and has the same colors available. The pool
+// is rebuilt by several threads whatever the number of processors, so that large layers are always split into slabs.
+void checkRebuiltPool(const TestResolution* res, RB_ColorPool* pool, RB_ColorPool* rebuilt, uint8_t* availability) {
+	RB_getColorPoolAvailability(pool, availability);
+
+	int buildThreads = RB_setColorPoolBuildThreads(RB_TEST_REBUILD_THREADS);
+	bool wasRebuilt = RB_copyColorPool(rebuilt, pool) && RB_rebuildColorPool(rebuilt, availability);
+	RB_setColorPoolBuildThreads(buildThreads);
+
+	if(!wasRebuilt) {
+		reportTestFailure(res, "the pool could not be rebuilt", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+		return;
+	}
+
+	if(!RB_checkColorPoolInvariants(rebuilt)) {
+		reportTestFailure(res, "the rebuilt pool's invariants are broken", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+	}
+
+	for(RB_ColorChannelSize r = 0; r < res->rRes; r++) {
+		for(RB_ColorChannelSize g = 0; g < res->gRes; g++) {
+			for(RB_ColorChannelSize b = 0; b < res->bRes; b++) {
+				RB_Color color = { .r = r, .g = g, .b = b };
+				if(RB_colorIsAvailableInPool(pool, color) != RB_colorIsAvailableInPool(rebuilt, color)) {
+					reportTestFailure(res, "the rebuilt pool has different colors available", color);
+				}
+			}
+		}
+	}
+}
+
+// Runs random searches and removals against a pool, checking every result.
+void fuzzColorPool(const TestResolution* res, RB_Random* random, int numOperations) {
+	size_t numColors = (size_t) res->rRes * res->gRes * res->bRes;
+	size_t numAvailable = numColors;
+
+	RB_ColorPool* pool = RB_createColorPool(res->rRes, res->gRes, res->bRes);
+	RB_ColorPool* rebuilt = RB_createColorPool(res->rRes, res->gRes, res->bRes);
+	bool* available = (bool*) malloc(sizeof(bool) * numColors);
+	uint8_t* availability = (uint8_t*) malloc(RB_getColorPoolAvailabilitySize(pool));
+
+	if(pool == NULL || rebuilt == NULL || available == NULL || availability == NULL) {
+		reportTestFailure(res, "the pool could not be allocated", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+		return;
+	}
+
+	for(size_t i = 0; i < numColors; i++) {
+		available[i] = true;
+	}
+
+	if(!RB_checkColorPoolInvariants(pool)) {
+		reportTestFailure(res, "the new pool's invariants are broken", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+	}
+
+	for(int operation = 0; operation < numOperations && numAvailable > 0; operation++) {
+		RB_Color desired = getRandomTestColor(res, random);
+		RB_Color found;
+
+		if(!RB_findIdealAvailableColor(pool, desired, random, &found)) {
+			reportTestFailure(res, "a search of a pool with colors left failed", desired);
+			break;
+		}
+		if(!available[getTestColorIndex(res, found)]) {
+			reportTestFailure(res, "a search returned a color that isn't available", found);
+		} else if(
+			(int64_t) getTestDistance(desired, found) != findClosestDistanceByBruteForce(res, available, desired)
+		) {
+			reportTestFailure(res, "a search returned a color that isn't the closest", found);
+		}
+
+		// Most removals take the color that was found, like the generator does, but some take a random color, which
+		// may already have been removed.
+		RB_Color toRemove = (RB_getRandomBelow(random, 4) == 0)? getRandomTestColor(res, random) : found;
+		size_t removeIndex = getTestColorIndex(res, toRemove);
+
+		if(RB_removeColorFromPool(pool, toRemove) != available[removeIndex]) {
+			reportTestFailure(res, "a removal returned the wrong result", toRemove);
+		}
+		if(available[removeIndex]) {
+			available[removeIndex] = false;
+			numAvailable--;
+		}
+
+		if(operation % RB_TEST_INVARIANT_INTERVAL == 0 && !RB_checkColorPoolInvariants(pool)) {
+			reportTestFailure(res, "the pool's invariants are broken after removing", toRemove);
+		}
+		if(operation % (RB_TEST_INVARIANT_INTERVAL * 10) == 0) {
+			checkRebuiltPool(res, pool, rebuilt, availability);
+		}
+	}
+
+	if(!RB_checkColorPoolInvariants(pool)) {
+		reportTestFailure(res, "the pool's invariants are broken at the end", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+	}
+	checkRebuiltPool(res, pool, rebuilt, availability);
+
+	free(availability);
+	free(available);
+	RB_freeColorPool(rebuilt);
+	RB_freeColorPool(pool);
+}
+
+// Takes colors from a concurrent pool on a single thread until it is empty, checking each of them.
+void fuzzConcurrentColorPool(const TestResolution* res, RB_Random* random, int numOperations) {
+	size_t numColors = (size_t) res->rRes * res->gRes * res->bRes;
+
+	RB_ConcurrentColorPool* pool = RB_createConcurrentColorPool(res->rRes, res->gRes, res->bRes);
+	RB_ColorPoolSearch* search = RB_createColorPoolSearch();
+	bool* available = (bool*) malloc(sizeof(bool) * numColors);
+
+	if(pool == NULL || search == NULL || available == NULL) {
+		reportTestFailure(res, "the concurrent pool could not be allocated", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+		return;
+	}
+
+	for(size_t i = 0; i < numColors; i++) {
+		available[i] = true;
+	}
+
+	for(int operation = 0; operation < numOperations && (size_t) operation < numColors; operation++) {
+		RB_Color desired = getRandomTestColor(res, random);
+		int64_t closest = findClosestDistanceByBruteForce(res, available, desired);
+		RB_Color taken = RB_takeIdealAvailableColorFromConcurrentPool(pool, search, desired, random);
+		size_t takenIndex = getTestColorIndex(res, taken);
+
+		if(!available[takenIndex]) {
+			reportTestFailure(res, "the concurrent pool gave out a color twice", taken);
+		} else if((int64_t) getTestDistance(desired, taken) != closest) {
+			reportTestFailure(res, "the concurrent pool gave out a color that isn't the closest", taken);
+		}
+		available[takenIndex] = false;
+
+		if(RB_colorIsAvailableInConcurrentPool(pool, taken) || RB_claimColorFromConcurrentPool(pool, taken)) {
+			reportTestFailure(res, "a color taken from the concurrent pool is still available", taken);
+		}
+	}
+
+	free(available);
+	RB_freeColorPoolSearch(search);
+	RB_freeConcurrentColorPool(pool);
+}
+
+typedef struct {
+	RB_Color desired;
+	RB_Color claimed;
+	// Ticks of a clock shared by every thread, taken just before the claim started and just after it finished.
+	uint64_t start;
+	uint64_t end;
+} ConcurrentTestClaim;
+
+// Everything the threads of a stress test share. If the threads get stuck, it is never freed, since they still use it.
+typedef struct {
+	const TestResolution* res;
+	RB_ConcurrentColorPool* pool;
+	ConcurrentTestClaim* claims;
+	// The current phase's claims follow the earlier phases'.
+	size_t firstClaim;
+	// Counts down the claims left in the current phase. Each thread takes one before every claim it makes, so no more
+	// claims are made than there are colors, and every one of them has to succeed.
+	atomic_long claimsLeft;
+	atomic_uint_fast64_t clock;
+
+	pthread_mutex_t lock;
+	pthread_cond_t threadFinished;
+	int numRunning;
+} ConcurrentTest;
+
+typedef struct {
+	ConcurrentTest* test;
+	pthread_t thread;
+	RB_Random random;
+	bool failed;
+} ConcurrentTestThread;
+
+void* runConcurrentTestThread(void* threadPtr) {
+	ConcurrentTestThread* thread = (ConcurrentTestThread*) threadPtr;
+	ConcurrentTest* test = thread->test;
+	RB_ColorPoolSearch* search = RB_createColorPoolSearch();
+
+	long claimIndex;
+	while(search != NULL && (claimIndex = atomic_fetch_sub(&(test->claimsLeft), 1)) > 0) {
+		ConcurrentTestClaim* claim = &(test->claims[test->firstClaim + claimIndex - 1]);
+		claim->desired = getRandomTestColor(test->res, &(thread->random));
+		claim->start = atomic_fetch_add(&(test->clock), 1);
+		claim->claimed = RB_takeIdealAvailableColorFromConcurrentPool(
+			test->pool, search, claim->desired, &(thread->random)
+		);
+		claim->end = atomic_fetch_add(&(test->clock), 1);
+	}
+
+	thread->failed = search == NULL;
+	RB_freeColorPoolSearch(search);
+
+	pthread_mutex_lock(&(test->lock));
+	test->numRunning--;
+	pthread_cond_signal(&(test->threadFinished));
+	pthread_mutex_unlock(&(test->lock));
+	return NULL;
+}
+
+// Waits for every thread to finish. Returns false if they haven't after RB_TEST_CONCURRENT_TIMEOUT_SECONDS.
+bool waitForConcurrentTestThreads(ConcurrentTest* test) {
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += RB_TEST_CONCURRENT_TIMEOUT_SECONDS;
+
+	pthread_mutex_lock(&(test->lock));
+	int waitResult = 0;
+	while(test->numRunning > 0 && waitResult != ETIMEDOUT) {
+		waitResult = pthread_cond_timedwait(&(test->threadFinished), &(test->lock), &deadline);
+	}
+	bool finished = test->numRunning == 0;
+	pthread_mutex_unlock(&(test->lock));
+
+	return finished;
+}
+
+// Returns true if a color closer to the claim's desired color than the one it claimed was available for the whole time
+// the claim was being made. A color was, if it was never claimed at all, or if the claim that took it only started
+// after this claim had finished.
+bool claimPassedOverAvailableColor(
+	const TestResolution* res,
+	const ConcurrentTestClaim* claims,
+	const int64_t* claimedBy,
+	const ConcurrentTestClaim* claim
+) {
+	RB_ColorSquareDistance claimedDistance = getTestDistance(claim->desired, claim->claimed);
+	size_t colorIndex = 0;
+
+	for(RB_ColorChannelSize r = 0; r < res->rRes; r++) {
+		for(RB_ColorChannelSize g = 0; g < res->gRes; g++) {
+			for(RB_ColorChannelSize b = 0; b < res->bRes; b++) {
+				int64_t taker = claimedBy[colorIndex];
+				colorIndex++;
+
+				if(
+					getTestDistance(claim->desired, (RB_Color) { .r = r, .g = g, .b = b }) < claimedDistance
+					&& (taker < 0 || claims[taker].start > claim->end)
+				) {
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+// Checks the claims made so far (claims[firstClaim] up to claims[numClaims]): that no color was claimed twice, and
+// that every claim took one of the closest colors that were available while it was being made.
+void checkConcurrentClaims(
+	const TestResolution* res,
+	const ConcurrentTestClaim* claims,
+	size_t firstClaim,
+	size_t numClaims,
+	int64_t* claimedBy
+) {
+	for(size_t i = firstClaim; i < numClaims; i++) {
+		size_t colorIndex = getTestColorIndex(res, claims[i].claimed);
+		if(claimedBy[colorIndex] >= 0) {
+			reportTestFailure(res, "the concurrent pool gave out a color twice", claims[i].claimed);
+		}
+		claimedBy[colorIndex] = (int64_t) i;
+	}
+
+	for(size_t i = firstClaim; i < numClaims; i++) {
+		if(claimPassedOverAvailableColor(res, claims, claimedBy, &(claims[i]))) {
+			reportTestFailure(res, "a concurrent claim passed over a closer available color", claims[i].claimed);
+		}
+	}
+}
+
+// Empties a concurrent pool from several threads at once, in two phases, checking every claim and the pool's
+// invariants after each phase.
+void stressConcurrentColorPool(const TestResolution* res, RB_Random* random) {
+	size_t numColors = (size_t) res->rRes * res->gRes * res->bRes;
+	RB_Color black = { .r = 0, .g = 0, .b = 0 };
+
+	ConcurrentTest* test = (ConcurrentTest*) malloc(sizeof(ConcurrentTest));
+	ConcurrentTestThread* threads = (ConcurrentTestThread*) malloc(
+		sizeof(ConcurrentTestThread) * RB_TEST_CONCURRENT_THREADS
+	);
+	int64_t* claimedBy = (int64_t*) malloc(sizeof(int64_t) * numColors);
+
+	if(test == NULL || threads == NULL || claimedBy == NULL) {
+		reportTestFailure(res, "the concurrent test could not be allocated", black);
+		return;
+	}
+
+	test->res = res;
+	test->pool = RB_createConcurrentColorPool(res->rRes, res->gRes, res->bRes);
+	test->claims = (ConcurrentTestClaim*) malloc(sizeof(ConcurrentTestClaim) * numColors);
+	atomic_init(&(test->clock), 0);
+	pthread_mutex_init(&(test->lock), NULL);
+	pthread_cond_init(&(test->threadFinished), NULL);
+
+	if(test->pool == NULL || test->claims == NULL) {
+		reportTestFailure(res, "the concurrent pool could not be allocated", black);
+		return;
+	}
+
+	for(size_t i = 0; i < numColors; i++) {
+		claimedBy[i] = -1;
+	}
+
+	// The first phase leaves the pool half empty, so that its counts and bounds are checked partway through, too.
+	size_t numClaimed = 0;
+	size_t phaseEnds[2] = { numColors / 2, numColors };
+	for(int phase = 0; phase < 2; phase++) {
+		atomic_init(&(test->claimsLeft), (long) (phaseEnds[phase] - numClaimed));
+		test->firstClaim = numClaimed;
+		test->numRunning = RB_TEST_CONCURRENT_THREADS;
+
+		for(int i = 0; i < RB_TEST_CONCURRENT_THREADS; i++) {
+			threads[i].test = test;
+			threads[i].failed = false;
+			RB_seedRandom(&(threads[i].random), RB_nextRandom(random));
+		}
+
+		int numStarted = 0;
+		for(int i = 0; i < RB_TEST_CONCURRENT_THREADS; i++) {
+			if(pthread_create(&(threads[i].thread), NULL, runConcurrentTestThread, &(threads[i])) != 0) {
+				break;
+			}
+			numStarted++;
+		}
+
+		pthread_mutex_lock(&(test->lock));
+		test->numRunning -= RB_TEST_CONCURRENT_THREADS - numStarted;
+		pthread_mutex_unlock(&(test->lock));
+
+		if(!waitForConcurrentTestThreads(test)) {
+			// The threads are still using the test, so it is left to them.
+			reportTestFailure(res, "the threads are still claiming colors, so the pool has lost track of them", black);
+			return;
+		}
+
+		for(int i = 0; i < numStarted; i++) {
+			pthread_join(threads[i].thread, NULL);
+			if(threads[i].failed) {
+				reportTestFailure(res, "a thread couldn't allocate a color pool search", black);
+			}
+		}
+
+		// Unless every claim was made, some of them are empty, and can't be checked.
+		if(numStarted < RB_TEST_CONCURRENT_THREADS || atomic_load(&(test->claimsLeft)) > 0) {
+			reportTestFailure(res, "not every thread could claim colors from the concurrent pool", black);
+			break;
+		}
+
+		checkConcurrentClaims(res, test->claims, numClaimed, phaseEnds[phase], claimedBy);
+		numClaimed = phaseEnds[phase];
+
+		if(!RB_checkConcurrentColorPoolInvariants(test->pool)) {
+			reportTestFailure(res, "the concurrent pool's invariants are broken after the threads joined", black);
+		}
+	}
+
+	// Unless every color was claimed exactly once, there are colors that weren't claimed at all.
+	for(size_t i = 0; i < numColors; i++) {
+		if(claimedBy[i] < 0) {
+			reportTestFailure(res, "a color was never claimed from the concurrent pool", black);
+			break;
+		}
+	}
+	for(RB_ColorChannelSize r = 0; r < res->rRes; r++) {
+		for(RB_ColorChannelSize g = 0; g < res->gRes; g++) {
+			for(RB_ColorChannelSize b = 0; b < res->bRes; b++) {
+				RB_Color color = { .r = r, .g = g, .b = b };
+				if(RB_colorIsAvailableInConcurrentPool(test->pool, color)) {
+					reportTestFailure(res, "a color is still available in the emptied concurrent pool", color);
+				}
+			}
+		}
+	}
+
+	pthread_cond_destroy(&(test->threadFinished));
+	pthread_mutex_destroy(&(test->lock));
+	RB_freeConcurrentColorPool(test->pool);
+	free(test->claims);
+	free(test);
+	free(threads);
+	free(claimedBy);
+}
+
+RB_Color getRandomFullColor(RB_Random* random) {
+	return (RB_Color) {
+		.r = RB_getRandomBelow(random, RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION),
+		.g = RB_getRandomBelow(random, RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION),
+		.b = RB_getRandomBelow(random, RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION)
+	};
+}
+
+RB_ColorChannelSize clampTestChannel(int value) {
+	if(value < 0) {
+		return 0;
+	}
+
+	if(value >= RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION) {
+		return RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION - 1;
+	}
+
+	return (RB_ColorChannelSize) value;
+}
+
+void generateTestPalette(const TestPalette* test, RB_Random* random, RB_Color* palette) {
+	RB_Color centers[8];
+	int numCenters = (test->kind == RB_TEST_PALETTE_FEW_DISTINCT)? (test->length < 300? 1 : 8) : 4;
+	for(int i = 0; i < numCenters; i++) {
+		centers[i] = getRandomFullColor(random);
+	}
+
+	for(RB_Size i = 0; i < test->length; i++) {
+		RB_Color center = centers[RB_getRandomBelow(random, numCenters)];
+
+		switch(test->kind) {
+			case RB_TEST_PALETTE_RANDOM:
+				palette[i] = getRandomFullColor(random);
+				break;
+			case RB_TEST_PALETTE_CLUSTERED:
+				palette[i] = (RB_Color) {
+					.r = clampTestChannel(center.r + (int) RB_getRandomBelow(random, 9) - 4),
+					.g = clampTestChannel(center.g + (int) RB_getRandomBelow(random, 9) - 4),
+					.b = clampTestChannel(center.b + (int) RB_getRandomBelow(random, 9) - 4)
+				};
+				break;
+			case RB_TEST_PALETTE_FEW_DISTINCT:
+				palette[i] = center;
+				break;
+		}
+	}
+}
+
+bool colorsAreEqual(RB_Color a, RB_Color b) {
+	return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+// Returns the index of an available palette entry with the color, or -1 if there isn't one.
+int64_t findAvailablePaletteEntry(const RB_Color* palette, const bool* available, RB_Size length, RB_Color color) {
+	for(RB_Size i = 0; i < length; i++) {
+		if(available[i] && colorsAreEqual(palette[i], color)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+int64_t findClosestPaletteDistanceByBruteForce(
+	const RB_Color* palette,
+	const bool* available,
+	RB_Size length,
+	RB_Color desired
+) {
+	int64_t best = -1;
+
+	for(RB_Size i = 0; i < length; i++) {
+		if(available[i]) {
+			int64_t distance = getTestDistance(desired, palette[i]);
+			if(best < 0 || distance < best) {
+				best = distance;
+			}
+		}
+	}
+
+	return best;
+}
+
+int compareTestColors(const void* aPtr, const void* bPtr) {
+	const RB_Color* a = (const RB_Color*) aPtr;
+	const RB_Color* b = (const RB_Color*) bPtr;
+	int aKey = (a->r << 16) | (a->g << 8) | a->b;
+	int bKey = (b->r << 16) | (b->g << 8) | b->b;
+	return (aKey > bKey) - (aKey < bKey);
+}
+
+// Checks that the pool holds exactly the palette's colors, duplicates included.
+void checkPaletteColors(const TestPalette* test, RB_ColorPool* pool, const RB_Color* palette) {
+	RB_Color* expected = (RB_Color*) malloc(sizeof(RB_Color) * test->length);
+	RB_Color* actual = (RB_Color*) malloc(sizeof(RB_Color) * test->length);
+
+	if(expected == NULL || actual == NULL || RB_getColorPoolSize(pool) != (size_t) test->length) {
+		RB_Color black = { .r = 0, .g = 0, .b = 0 };
+		reportFailure(test->name, "the pool doesn't have as many colors as the palette", black);
+		free(expected);
+		free(actual);
+		return;
+	}
+
+	for(RB_Size i = 0; i < test->length; i++) {
+		expected[i] = palette[i];
+		actual[i] = RB_getColorPoolColor(pool, i);
+	}
+	qsort(expected, test->length, sizeof(RB_Color), compareTestColors);
+	qsort(actual, test->length, sizeof(RB_Color), compareTestColors);
+
+	for(RB_Size i = 0; i < test->length; i++) {
+		if(!colorsAreEqual(expected[i], actual[i])) {
+			reportFailure(test->name, "the pool's colors aren't the palette's", actual[i]);
+			break;
+		}
+	}
+
+	free(expected);
+	free(actual);
+}
+
+// Checks that a palette pool rebuilt from the pool's availability has the same colors available.
+void checkRebuiltPalettePool(
+	const TestPalette* test,
+	RB_ColorPool* pool,
+	RB_ColorPool* rebuilt,
+	uint8_t* availability,
+	const RB_Color* palette
+) {
+	RB_getColorPoolAvailability(pool, availability);
+
+	if(!RB_copyColorPool(rebuilt, pool) || !RB_rebuildColorPool(rebuilt, availability)) {
+		reportFailure(test->name, "the pool could not be rebuilt", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+		return;
+	}
+
+	if(!RB_checkColorPoolInvariants(rebuilt)) {
+		reportFailure(test->name, "the rebuilt pool's invariants are broken", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+	}
+
+	for(RB_Size i = 0; i < test->length; i++) {
+		if(RB_colorIsAvailableInPool(pool, palette[i]) != RB_colorIsAvailableInPool(rebuilt, palette[i])) {
+			reportFailure(test->name, "the rebuilt pool has different colors available", palette[i]);
+		}
+	}
+}
+
+// Runs random searches and removals against a palette pool, checking every result against the palette.
+void fuzzPaletteColorPool(const TestPalette* test, RB_Random* random, int numOperations) {
+	RB_Color* palette = (RB_Color*) malloc(sizeof(RB_Color) * test->length);
+	bool* available = (bool*) malloc(sizeof(bool) * test->length);
+
+	if(palette == NULL || available == NULL) {
+		reportFailure(test->name, "the palette could not be allocated", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+		return;
+	}
+
+	generateTestPalette(test, random, palette);
+	for(RB_Size i = 0; i < test->length; i++) {
+		available[i] = true;
+	}
+
+	RB_ColorPool* pool = RB_createPaletteColorPool(palette, test->length);
+	RB_ColorPool* rebuilt = RB_createPaletteColorPool(palette, test->length);
+	uint8_t* availability = (pool == NULL)? NULL : (uint8_t*) malloc(RB_getColorPoolAvailabilitySize(pool));
+
+	if(pool == NULL || rebuilt == NULL || availability == NULL) {
+		reportFailure(test->name, "the pool could not be allocated", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+		return;
+	}
+
+	if(!RB_checkColorPoolInvariants(pool)) {
+		reportFailure(test->name, "the new pool's invariants are broken", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+	}
+	checkPaletteColors(test, pool, palette);
+
+	RB_Size numAvailable = test->length;
+	for(int operation = 0; operation < numOperations && numAvailable > 0; operation++) {
+		RB_Color desired = getRandomFullColor(random);
+		RB_Color found;
+
+		if(!RB_findIdealAvailableColor(pool, desired, random, &found)) {
+			reportFailure(test->name, "a search of a pool with colors left failed", desired);
+			break;
+		}
+		if(findAvailablePaletteEntry(palette, available, test->length, found) < 0) {
+			reportFailure(test->name, "a search returned a color that isn't available", found);
+		} else if(
+			(int64_t) getTestDistance(desired, found)
+			!= findClosestPaletteDistanceByBruteForce(palette, available, test->length, desired)
+		) {
+			reportFailure(test->name, "a search returned a color that isn't the closest", found);
+		}
+
+		// Some removals take a color from anywhere in the palette, which may already have been removed, and some take
+		// a color that probably isn't in the palette at all.
+		RB_Size choice = RB_getRandomBelow(random, 8);
+		RB_Color toRemove = (choice == 0)? getRandomFullColor(random)
+			: ((choice == 1)? palette[RB_getRandomBelow(random, test->length)] : found);
+		int64_t removeIndex = findAvailablePaletteEntry(palette, available, test->length, toRemove);
+
+		if(RB_colorIsAvailableInPool(pool, toRemove) != (removeIndex >= 0)) {
+			reportFailure(test->name, "the pool has the wrong availability", toRemove);
+		}
+		if(RB_removeColorFromPool(pool, toRemove) != (removeIndex >= 0)) {
+			reportFailure(test->name, "a removal returned the wrong result", toRemove);
+		}
+		if(removeIndex >= 0) {
+			available[removeIndex] = false;
+			numAvailable--;
+		}
+
+		if(operation % RB_TEST_INVARIANT_INTERVAL == 0 && !RB_checkColorPoolInvariants(pool)) {
+			reportFailure(test->name, "the pool's invariants are broken after removing", toRemove);
+		}
+		if(operation % (RB_TEST_INVARIANT_INTERVAL * 10) == 0) {
+			checkRebuiltPalettePool(test, pool, rebuilt, availability, palette);
+		}
+	}
+
+	if(!RB_checkColorPoolInvariants(pool)) {
+		reportFailure(test->name, "the pool's invariants are broken at the end", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+	}
+	checkRebuiltPalettePool(test, pool, rebuilt, availability, palette);
+
+	// Resetting makes every duplicate available again.
+	if(!RB_resetColorPool(pool) || !RB_checkColorPoolInvariants(pool)) {
+		reportFailure(test->name, "the pool could not be reset", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+	}
+	for(RB_Size i = 0; i < test->length; i++) {
+		if(!RB_removeColorFromPool(pool, palette[i])) {
+			reportFailure(test->name, "a color wasn't available after resetting", palette[i]);
+			break;
+		}
+	}
+
+	free(availability);
+	free(available);
+	free(palette);
+	RB_freeColorPool(rebuilt);
+	RB_freeColorPool(pool);
+}
+
+void reportCountedTestFailure(const TestCountedPool* test, const char* message, RB_Color color) {
+	char poolName[64];
+	snprintf(
+		poolName,
+		sizeof(poolName),
+		"%d x %d x %d, %zu uses",
+		(int) test->res.rRes, (int) test->res.gRes, (int) test->res.bRes,
+		test->totalCount
+	);
+	reportFailure(poolName, message, color);
+}
+
+// Fills counts with how many times each color can be taken from a new pool, according to RB_getColorPoolColor, and
+// checks that the counts are shared out as evenly as they can be.
+void checkInitialColorCounts(const TestCountedPool* test, RB_ColorPool* pool, uint32_t* counts) {
+	const TestResolution* res = &(test->res);
+	size_t numColors = (size_t) res->rRes * res->gRes * res->bRes;
+	RB_Color black = { .r = 0, .g = 0, .b = 0 };
+
+	if(RB_getColorPoolSize(pool) != test->totalCount) {
+		reportCountedTestFailure(test, "the pool's size isn't its total count", black);
+		return;
+	}
+
+	for(size_t i = 0; i < numColors; i++) {
+		counts[i] = 0;
+	}
+
+	size_t previousIndex = 0;
+	for(size_t i = 0; i < test->totalCount; i++) {
+		RB_Color color = RB_getColorPoolColor(pool, i);
+		size_t index = getTestColorIndex(res, color);
+		if(index < previousIndex) {
+			reportCountedTestFailure(test, "a color's uses aren't consecutive", color);
+			return;
+		}
+		previousIndex = index;
+		counts[index]++;
+	}
+
+	for(size_t i = 0; i < numColors; i++) {
+		if(counts[i] != test->totalCount / numColors && counts[i] != (test->totalCount + numColors - 1) / numColors) {
+			reportCountedTestFailure(test, "the uses aren't shared out evenly", RB_getColorPoolColor(pool, 0));
+			return;
+		}
+	}
+}
+
+// Checks that a counted pool rebuilt from the pool's availability has the same counts left.
+void checkRebuiltCountedPool(
+	const TestCountedPool* test,
+	RB_ColorPool* pool,
+	RB_ColorPool* rebuilt,
+	uint8_t* availability
+) {
+	const TestResolution* res = &(test->res);
+	RB_getColorPoolAvailability(pool, availability);
+
+	if(!RB_copyColorPool(rebuilt, pool) || !RB_rebuildColorPool(rebuilt, availability)) {
+		reportCountedTestFailure(test, "the pool could not be rebuilt", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+		return;
+	}
+
+	if(!RB_checkColorPoolInvariants(rebuilt)) {
+		reportCountedTestFailure(
+			test,
+			"the rebuilt pool's invariants are broken",
+			(RB_Color) { .r = 0, .g = 0, .b = 0 }
+		);
+	}
+
+	for(RB_ColorChannelSize r = 0; r < res->rRes; r++) {
+		for(RB_ColorChannelSize g = 0; g < res->gRes; g++) {
+			for(RB_ColorChannelSize b = 0; b < res->bRes; b++) {
+				RB_Color color = { .r = r, .g = g, .b = b };
+				if(RB_getColorCountInPool(pool, color) != RB_getColorCountInPool(rebuilt, color)) {
+					reportCountedTestFailure(test, "the rebuilt pool has different counts left", color);
+				}
+			}
+		}
+	}
+}
+
+// Runs random searches and removals against a pool whose colors can be taken several times, checking every result
+// against how many times each color is left.
+void fuzzCountedColorPool(const TestCountedPool* test, RB_Random* random, int numOperations) {
+	const TestResolution* res = &(test->res);
+	size_t numColors = (size_t) res->rRes * res->gRes * res->bRes;
+	size_t numUsesLeft = test->totalCount;
+
+	RB_ColorPool* pool = RB_createCountedColorPool(res->rRes, res->gRes, res->bRes, test->totalCount);
+	RB_ColorPool* rebuilt = RB_createCountedColorPool(res->rRes, res->gRes, res->bRes, test->totalCount);
+	uint32_t* counts = (uint32_t*) malloc(sizeof(uint32_t) * numColors);
+	bool* available = (bool*) malloc(sizeof(bool) * numColors);
+	uint8_t* availability = (pool == NULL)? NULL : (uint8_t*) malloc(RB_getColorPoolAvailabilitySize(pool));
+
+	if(pool == NULL || rebuilt == NULL || counts == NULL || available == NULL || availability == NULL) {
+		reportCountedTestFailure(test, "the pool could not be allocated", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+		return;
+	}
+
+	if(!RB_checkColorPoolInvariants(pool)) {
+		reportCountedTestFailure(test, "the new pool's invariants are broken", (RB_Color) { .r = 0, .g = 0, .b = 0 });
+	}
+	checkInitialColorCounts(test, pool, counts);
+	for(size_t i = 0; i < numColors; i++) {
+		available[i] = counts[i] > 0;
+	}
+
+	for(int operation = 0; operation < numOperations && numUsesLeft > 0; operation++) {
+		RB_Color desired = getRandomTestColor(res, random);
+		RB_Color found;
+
+		if(!RB_findIdealAvailableColor(pool, desired, random, &found)) {
+			reportCountedTestFailure(test, "a search of a pool with colors left failed", desired);
+			break;
+		}
+		if(!available[getTestColorIndex(res, found)]) {
+			reportCountedTestFailure(test, "a search returned a color that isn't available", found);
+		} else if(
+			(int64_t) getTestDistance(desired, found) != findClosestDistanceByBruteForce(res, available, desired)
+		) {
+			reportCountedTestFailure(test, "a search returned a color that isn't the closest", found);
+		}
+
+		RB_Color toRemove = (RB_getRandomBelow(random, 4) == 0)? getRandomTestColor(res, random) : found;
+		size_t removeIndex = getTestColorIndex(res, toRemove);
+
+		if(RB_getColorCountInPool(pool, toRemove) != counts[removeIndex]) {
+			reportCountedTestFailure(test, "the pool has the wrong count left", toRemove);
+		}
+		if(RB_removeColorFromPool(pool, toRemove) != available[removeIndex]) {
+			reportCountedTestFailure(test, "a removal returned the wrong result", toRemove);
+		}
+		if(available[removeIndex]) {
+			counts[removeIndex]--;
+			available[removeIndex] = counts[removeIndex] > 0;
+			numUsesLeft--;
+		}
+
+		if(operation % RB_TEST_INVARIANT_INTERVAL == 0 && !RB_checkColorPoolInvariants(pool)) {
+			reportCountedTestFailure(test, "the pool's invariants are broken after removing", toRemove);
+		}
+		if(operation % (RB_TEST_INVARIANT_INTERVAL * 10) == 0) {
+			checkRebuiltCountedPool(test, pool, rebuilt, availability);
+		}
+	}
+
+	if(!RB_checkColorPoolInvariants(pool)) {
+		reportCountedTestFailure(
+			test,
+			"the pool's invariants are broken at the end",
+			(RB_Color) { .r = 0, .g = 0, .b = 0 }
+		);
+	}
+	checkRebuiltCountedPool(test, pool, rebuilt, availability);
+
+	free(availability);
+	free(available);
+	free(counts);
+	RB_freeColorPool(rebuilt);
+	RB_freeColorPool(pool);
+}
+
+int main(int argc, char** argv) {
+	unsigned int seed = argc > 1? (unsigned int) atoi(argv[1]) : 1;
+	int numOperations = argc > 2? atoi(argv[2]) : 5000;
+
+	if(numOperations < 1) {
+		fprintf(stderr, "Usage: %s [seed] [operations per resolution]\n", argv[0]);
+		return 1;
+	}
+
+	RB_Random random;
+	RB_seedRandom(&random, seed);
+
+	for(size_t i = 0; i < RB_NUM_TEST_RESOLUTIONS; i++) {
+		const TestResolution* res = &(testResolutions[i]);
+		int failuresBefore = numFailures;
+
+		fuzzColorPool(res, &random, numOperations);
+		fuzzConcurrentColorPool(res, &random, numOperations);
+
+		fprintf(
+			stderr,
+			"%s %d x %d x %d\n",
+			(numFailures == failuresBefore)? "ok    " : "FAILED",
+			(int) res->rRes, (int) res->gRes, (int) res->bRes
+		);
+	}
+
+	for(size_t i = 0; i < RB_NUM_TEST_CONCURRENT_RESOLUTIONS; i++) {
+		const TestResolution* res = &(testConcurrentResolutions[i]);
+		int failuresBefore = numFailures;
+
+		stressConcurrentColorPool(res, &random);
+
+		fprintf(
+			stderr,
+			"%s %d x %d x %d, %d threads\n",
+			(numFailures == failuresBefore)? "ok    " : "FAILED",
+			(int) res->rRes, (int) res->gRes, (int) res->bRes,
+			RB_TEST_CONCURRENT_THREADS
+		);
+	}
+
+	for(size_t i = 0; i < RB_NUM_TEST_PALETTES; i++) {
+		const TestPalette* test = &(testPalettes[i]);
+		int failuresBefore = numFailures;
+
+		fuzzPaletteColorPool(test, &random, numOperations);
+
+		fprintf(stderr, "%s palette: %s\n", (numFailures == failuresBefore)? "ok    " : "FAILED", test->name);
+	}
+
+	for(size_t i = 0; i < RB_NUM_TEST_COUNTED_POOLS; i++) {
+		const TestCountedPool* test = &(testCountedPools[i]);
+		int failuresBefore = numFailures;
+
+		fuzzCountedColorPool(test, &random, numOperations);
+
+		fprintf(
+			stderr,
+			"%s %d x %d x %d, %zu uses\n",
+			(numFailures == failuresBefore)? "ok    " : "FAILED",
+			(int) test->res.rRes, (int) test->res.gRes, (int) test->res.bRes,
+			test->totalCount
+		);
+	}
+
+	if(numFailures > 0) {
+		fprintf(stderr, "%d checks failed (seed %u).\n", numFailures, seed);
+		return 1;
+	}
+
+	fprintf(stderr, "Every check passed (seed %u).\n", seed);
+	return 0;
+}
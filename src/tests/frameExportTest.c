@@ -0,0 +1,554 @@
+#include "headers/RB_Main.h"
+#include "headers/RB_FrameExport.h"
+#include "headers/RB_PixelMap.h"
+#include "headers/RB_PixelRing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+Generates small rainbows with a raw, a Y4M and a delta frame exporter attached, and decodes all three streams.
+
+Whether the generating thread hands a frame over or merges it into the next one depends on how far behind the writer
+is, but the generating thread is also the one that counts the merged frames. So a last observer, attached after the
+exporters, follows every pixel and reset, and works out exactly which pixels each exporter's frames must hold. Every
+frame of every stream is checked against that, and the last frame of every stream is checked against the pixel map.
+
+Usage: frameExportTest
+
+Returns 0 if every check passed.
+*/
+
+typedef struct {
+	RB_ColorChannelSize rRes;
+	RB_ColorChannelSize gRes;
+	RB_ColorChannelSize bRes;
+	RB_Size width;
+	RB_Size height;
+	RB_Size pixelsPerFrame;
+	// If true, the rainbow is reset halfway through, and then generated again from scratch.
+	bool resetHalfway;
+} FrameTestCase;
+
+// A frame per pixel (which the writer can't keep up with), frames that don't divide the canvas, frames too big for the
+// delta writer's buffer, and a single frame.
+const FrameTestCase frameTestCases[] = {
+	{ 8, 8, 8, 32, 16, 1, false },
+	{ 8, 8, 8, 32, 16, 1, true },
+	{ 16, 16, 16, 64, 64, 97, false },
+	{ 16, 16, 16, 64, 64, 97, true },
+	{ 3, 5, 7, 15, 7, 10, true },
+	{ 32, 32, 32, 256, 128, 10000, false },
+	{ 16, 16, 16, 64, 64, 5000, false },
+	{ 16, 16, 16, 64, 64, 5000, true }
+};
+#define RB_NUM_FRAME_TEST_CASES (sizeof(frameTestCases) / sizeof(frameTestCases[0]))
+
+#define RB_NUM_TEST_FORMATS 3
+const RB_FrameFormat testFormats[RB_NUM_TEST_FORMATS] = {
+	RB_FRAME_FORMAT_RAW_RGB, RB_FRAME_FORMAT_Y4M, RB_FRAME_FORMAT_DELTA
+};
+const char* testFormatNames[RB_NUM_TEST_FORMATS] = { "raw", "y4m", "delta" };
+
+// A frame holds the pixels from start to end of the log, on top of the previous frame, or of a black canvas.
+typedef struct {
+	size_t start;
+	size_t end;
+	bool clearsCanvas;
+} ExpectedFrame;
+
+// Follows an exporter the way it follows the rainbow, to work out which frames it has to write.
+typedef struct {
+	RB_FrameExporter* exporter;
+	FILE* output;
+
+	RB_Size pixelsInFrame;
+	uint64_t numDropped;
+	size_t liveStart;
+	bool liveClearsCanvas;
+
+	ExpectedFrame* frames;
+	size_t numFrames;
+	size_t framesCapacity;
+} ExporterModel;
+
+typedef struct {
+	const FrameTestCase* test;
+	// Every pixel that was set, in order.
+	RB_PixelUpdate* log;
+	size_t logLength;
+	size_t logCapacity;
+
+	ExporterModel models[RB_NUM_TEST_FORMATS];
+	bool failed;
+
+	uint8_t rLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint8_t gLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint8_t bLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+} FrameTest;
+
+int numFailures = 0;
+
+void reportFailure(const FrameTestCase* test, const char* format, const char* message, size_t frame) {
+	numFailures++;
+	// Anything after the first few failures is almost always the same bug.
+	if(numFailures <= 20) {
+		fprintf(
+			stderr, "FAILED (%d x %d x %d, %ld x %ld, %ld pixels per frame, %s): %s, frame %zu.\n",
+			(int) test->rRes, (int) test->gRes, (int) test->bRes, (long) test->width, (long) test->height,
+			(long) test->pixelsPerFrame, format, message, frame
+		);
+	}
+}
+
+void addExpectedFrame(FrameTest* frameTest, ExporterModel* model) {
+	if(model->numFrames == model->framesCapacity) {
+		size_t newCapacity = (model->framesCapacity == 0)? 64 : model->framesCapacity * 2;
+		ExpectedFrame* newFrames = (ExpectedFrame*) realloc(model->frames, sizeof(ExpectedFrame) * newCapacity);
+
+		if(newFrames == NULL) {
+			frameTest->failed = true;
+			return;
+		}
+
+		model->frames = newFrames;
+		model->framesCapacity = newCapacity;
+	}
+
+	model->frames[model->numFrames] = (ExpectedFrame) {
+		.start = model->liveStart,
+		.end = frameTest->logLength,
+		.clearsCanvas = model->liveClearsCanvas
+	};
+	model->numFrames++;
+	model->liveStart = frameTest->logLength;
+	model->liveClearsCanvas = false;
+}
+
+// Called after every exporter has seen the pixel, so the frame they handed over (or merged) has already been counted.
+void frameTestPixelObserver(void* frameTestPtr, RB_Coord coord, RB_Color color) {
+	FrameTest* frameTest = (FrameTest*) frameTestPtr;
+
+	if(frameTest->logLength == frameTest->logCapacity) {
+		size_t newCapacity = (frameTest->logCapacity == 0)? 1024 : frameTest->logCapacity * 2;
+		RB_PixelUpdate* newLog = (RB_PixelUpdate*) realloc(frameTest->log, sizeof(RB_PixelUpdate) * newCapacity);
+
+		if(newLog == NULL) {
+			frameTest->failed = true;
+			return;
+		}
+
+		frameTest->log = newLog;
+		frameTest->logCapacity = newCapacity;
+	}
+
+	frameTest->log[frameTest->logLength] = (RB_PixelUpdate) { .coord = coord, .color = color };
+	frameTest->logLength++;
+
+	for(int i = 0; i < RB_NUM_TEST_FORMATS; i++) {
+		ExporterModel* model = &(frameTest->models[i]);
+		model->pixelsInFrame++;
+
+		if(model->pixelsInFrame >= frameTest->test->pixelsPerFrame) {
+			model->pixelsInFrame = 0;
+			uint64_t numDropped = RB_getDroppedFrameCount(model->exporter);
+
+			if(numDropped > model->numDropped) {
+				model->numDropped = numDropped;
+			} else {
+				addExpectedFrame(frameTest, model);
+			}
+		}
+	}
+}
+
+void frameTestResetObserver(void* frameTestPtr) {
+	FrameTest* frameTest = (FrameTest*) frameTestPtr;
+
+	for(int i = 0; i < RB_NUM_TEST_FORMATS; i++) {
+		frameTest->models[i].liveStart = frameTest->logLength;
+		frameTest->models[i].liveClearsCanvas = true;
+	}
+}
+
+// Applies a frame's pixels to an RGB canvas, rescaled the way the exporter rescales them.
+void applyExpectedFrame(FrameTest* frameTest, const ExpectedFrame* frame, uint8_t* canvas) {
+	size_t canvasSize = (size_t) frameTest->test->width * frameTest->test->height * 3;
+
+	if(frame->clearsCanvas) {
+		memset(canvas, 0, canvasSize);
+	}
+
+	for(size_t i = frame->start; i < frame->end; i++) {
+		RB_PixelUpdate update = frameTest->log[i];
+		uint8_t* out = canvas + ((((size_t) update.coord.y * frameTest->test->width) + update.coord.x) * 3);
+		out[0] = frameTest->rLookup[update.color.r];
+		out[1] = frameTest->gLookup[update.color.g];
+		out[2] = frameTest->bLookup[update.color.b];
+	}
+}
+
+// Converts an RGB canvas into Y, U and V planes, with BT.601 in the limited range.
+void convertCanvasToY4M(const uint8_t* rgb, uint8_t* yuv, size_t planeSize) {
+	for(size_t i = 0; i < planeSize; i++) {
+		int r = rgb[i * 3];
+		int g = rgb[(i * 3) + 1];
+		int b = rgb[(i * 3) + 2];
+		yuv[i] = (uint8_t) ((((66 * r) + (129 * g) + (25 * b) + 128) >> 8) + 16);
+		yuv[planeSize + i] = (uint8_t) ((((-38 * r) - (74 * g) + (112 * b) + 128) >> 8) + 128);
+		yuv[(2 * planeSize) + i] = (uint8_t) ((((112 * r) - (94 * g) - (18 * b) + 128) >> 8) + 128);
+	}
+}
+
+uint32_t loadLittleEndian(const uint8_t* bytes) {
+	return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+// Reads the whole stream back. Returns NULL if it can't be read.
+uint8_t* readTestStream(FILE* stream, size_t* length) {
+	if(fseek(stream, 0, SEEK_END) != 0) {
+		return NULL;
+	}
+
+	long end = ftell(stream);
+	if(end < 0 || fseek(stream, 0, SEEK_SET) != 0) {
+		return NULL;
+	}
+
+	*length = (size_t) end;
+	// At least a byte, so that an empty stream can be told apart from a failure.
+	uint8_t* bytes = (uint8_t*) malloc(*length + 1);
+	if(bytes != NULL && fread(bytes, 1, *length, stream) != *length) {
+		free(bytes);
+		return NULL;
+	}
+
+	return bytes;
+}
+
+// Checks a raw or Y4M stream, frame by frame. Both are whole canvases, so only their headers differ.
+void checkCanvasStream(
+	FrameTest* frameTest,
+	int formatIndex,
+	const uint8_t* stream,
+	size_t length,
+	const uint8_t* finalCanvas
+) {
+	const FrameTestCase* test = frameTest->test;
+	const char* formatName = testFormatNames[formatIndex];
+	const ExporterModel* model = &(frameTest->models[formatIndex]);
+	bool isY4M = testFormats[formatIndex] == RB_FRAME_FORMAT_Y4M;
+	size_t planeSize = (size_t) test->width * test->height;
+	size_t canvasSize = planeSize * 3;
+
+	size_t position = 0;
+	if(isY4M) {
+		char header[128];
+		int headerLength = snprintf(
+			header, sizeof(header), "YUV4MPEG2 W%ld H%ld F30:1 Ip A1:1 C444\n", (long) test->width, (long) test->height
+		);
+
+		if(length < (size_t) headerLength || memcmp(stream, header, headerLength) != 0) {
+			reportFailure(test, formatName, "the stream header is wrong", 0);
+			return;
+		}
+		position = headerLength;
+	}
+
+	size_t frameHeaderLength = isY4M? 6 : 0;
+	uint8_t* expected = (uint8_t*) calloc(canvasSize, 1);
+	uint8_t* converted = (uint8_t*) malloc(canvasSize);
+	if(expected == NULL || converted == NULL) {
+		reportFailure(test, formatName, "the expected frames could not be allocated", 0);
+		free(expected);
+		free(converted);
+		return;
+	}
+
+	size_t numFrames = 0;
+	const uint8_t* lastFrame = NULL;
+	while(position < length && numFrames < model->numFrames) {
+		if(length - position < frameHeaderLength + canvasSize) {
+			reportFailure(test, formatName, "the stream ends partway through a frame", numFrames);
+			break;
+		}
+		if(isY4M && memcmp(stream + position, "FRAME\n", 6) != 0) {
+			reportFailure(test, formatName, "the frame header is wrong", numFrames);
+			break;
+		}
+		position += frameHeaderLength;
+
+		applyExpectedFrame(frameTest, &(model->frames[numFrames]), expected);
+		const uint8_t* expectedFrame = expected;
+		if(isY4M) {
+			convertCanvasToY4M(expected, converted, planeSize);
+			expectedFrame = converted;
+		}
+
+		if(memcmp(stream + position, expectedFrame, canvasSize) != 0) {
+			reportFailure(test, formatName, "the frame doesn't hold the pixels set since the frame before", numFrames);
+		}
+
+		lastFrame = stream + position;
+		position += canvasSize;
+		numFrames++;
+	}
+
+	if(numFrames != model->numFrames || position != length) {
+		reportFailure(test, formatName, "the stream doesn't have as many frames as were handed over", numFrames);
+	}
+
+	const uint8_t* expectedFinal = finalCanvas;
+	if(isY4M) {
+		convertCanvasToY4M(finalCanvas, converted, planeSize);
+		expectedFinal = converted;
+	}
+	if(lastFrame == NULL || memcmp(lastFrame, expectedFinal, canvasSize) != 0) {
+		reportFailure(test, formatName, "the last frame doesn't match the pixel map", numFrames);
+	}
+
+	free(expected);
+	free(converted);
+}
+
+// Checks a delta stream, frame by frame, and rebuilds the canvas from it.
+void checkDeltaStream(
+	FrameTest* frameTest,
+	int formatIndex,
+	const uint8_t* stream,
+	size_t length,
+	const uint8_t* finalCanvas
+) {
+	const FrameTestCase* test = frameTest->test;
+	const char* formatName = testFormatNames[formatIndex];
+	const ExporterModel* model = &(frameTest->models[formatIndex]);
+	size_t canvasSize = (size_t) test->width * test->height * 3;
+
+	if(
+		length < 16 || memcmp(stream, "RBDELTA1", 8) != 0
+		|| loadLittleEndian(stream + 8) != (uint32_t) test->width
+		|| loadLittleEndian(stream + 12) != (uint32_t) test->height
+	) {
+		reportFailure(test, formatName, "the stream header is wrong", 0);
+		return;
+	}
+
+	uint8_t* canvas = (uint8_t*) calloc(canvasSize, 1);
+	if(canvas == NULL) {
+		reportFailure(test, formatName, "the canvas could not be allocated", 0);
+		return;
+	}
+
+	size_t position = 16;
+	size_t numFrames = 0;
+	while(position < length && numFrames < model->numFrames) {
+		const ExpectedFrame* frame = &(model->frames[numFrames]);
+
+		if(length - position < 5) {
+			reportFailure(test, formatName, "the stream ends partway through a frame header", numFrames);
+			break;
+		}
+
+		bool clearsCanvas = stream[position] & 1;
+		size_t numPixels = loadLittleEndian(stream + position + 1);
+		position += 5;
+
+		if(clearsCanvas != frame->clearsCanvas || numPixels != frame->end - frame->start) {
+			reportFailure(test, formatName, "the frame header doesn't match the pixels handed over", numFrames);
+			break;
+		}
+		if((length - position) / 11 < numPixels) {
+			reportFailure(test, formatName, "the stream ends partway through a frame", numFrames);
+			break;
+		}
+
+		if(clearsCanvas) {
+			memset(canvas, 0, canvasSize);
+		}
+
+		for(size_t i = 0; i < numPixels; i++) {
+			const uint8_t* record = stream + position;
+			RB_PixelUpdate update = frameTest->log[frame->start + i];
+			uint32_t x = loadLittleEndian(record);
+			uint32_t y = loadLittleEndian(record + 4);
+
+			if(
+				x != (uint32_t) update.coord.x || y != (uint32_t) update.coord.y
+				|| record[8] != frameTest->rLookup[update.color.r]
+				|| record[9] != frameTest->gLookup[update.color.g]
+				|| record[10] != frameTest->bLookup[update.color.b]
+			) {
+				reportFailure(test, formatName, "a pixel doesn't match the one that was set", numFrames);
+			} else {
+				memcpy(canvas + ((((size_t) y * test->width) + x) * 3), record + 8, 3);
+			}
+
+			position += 11;
+		}
+
+		numFrames++;
+	}
+
+	if(numFrames != model->numFrames || position != length) {
+		reportFailure(test, formatName, "the stream doesn't have as many frames as were handed over", numFrames);
+	}
+	if(memcmp(canvas, finalCanvas, canvasSize) != 0) {
+		reportFailure(test, formatName, "the rebuilt canvas doesn't match the pixel map", numFrames);
+	}
+
+	free(canvas);
+}
+
+// Reads the finished rainbow's pixels, rescaled the way the exporters rescale them.
+uint8_t* readFinalCanvas(FrameTest* frameTest, RB_Data* data) {
+	RB_Size width = frameTest->test->width;
+	RB_Size height = frameTest->test->height;
+	uint8_t* canvas = (uint8_t*) malloc((size_t) width * height * 3);
+	RB_Color* column = (RB_Color*) malloc(sizeof(RB_Color) * height);
+
+	if(canvas == NULL || column == NULL) {
+		free(canvas);
+		free(column);
+		return NULL;
+	}
+
+	for(RB_Size x = 0; x < width; x++) {
+		RB_readPixelMapColumn(data->pixelMap, x, 0, height, column);
+		for(RB_Size y = 0; y < height; y++) {
+			uint8_t* out = canvas + ((((size_t) y * width) + x) * 3);
+			out[0] = frameTest->rLookup[column[y].r];
+			out[1] = frameTest->gLookup[column[y].g];
+			out[2] = frameTest->bLookup[column[y].b];
+		}
+	}
+
+	free(column);
+	return canvas;
+}
+
+void runFrameTest(const FrameTestCase* test, unsigned int seed) {
+	FrameTest frameTest;
+	memset(&frameTest, 0, sizeof(frameTest));
+	frameTest.test = test;
+	RB_buildChannelLookup(frameTest.rLookup, test->rRes);
+	RB_buildChannelLookup(frameTest.gLookup, test->gRes);
+	RB_buildChannelLookup(frameTest.bLookup, test->bRes);
+
+	RB_Config* config = RB_newConfig();
+	RB_setColorResolution(config, test->rRes, test->gRes, test->bRes);
+	RB_setMapDimensions(config, test->width, test->height);
+	RB_setRandomSeed(config, seed);
+	RB_Data* data = RB_init(config);
+
+	if(data == NULL) {
+		reportFailure(test, "all", "the rainbow could not be initialized", 0);
+		RB_freeConfig(config);
+		return;
+	}
+
+	for(int i = 0; i < RB_NUM_TEST_FORMATS; i++) {
+		ExporterModel* model = &(frameTest.models[i]);
+		model->output = tmpfile();
+		model->exporter = (model->output == NULL)? NULL
+			: RB_attachFrameExporter(data, model->output, testFormats[i], test->pixelsPerFrame);
+
+		if(model->exporter == NULL) {
+			reportFailure(test, testFormatNames[i], "the exporter could not be attached", 0);
+			frameTest.failed = true;
+		}
+	}
+
+	RB_PixelObserver observer = {
+		.onPixelSet = frameTestPixelObserver,
+		.onReset = frameTestResetObserver,
+		.onFree = NULL,
+		.userData = &frameTest
+	};
+
+	if(!frameTest.failed && RB_addPixelObserver(data, observer)) {
+		RB_Size numPixels = test->width * test->height;
+
+		if(test->resetHalfway) {
+			RB_setCoordColor(data, RB_getRandomCoord(data), RB_getRandomColor(data));
+			RB_generatePixels(data, numPixels / 2);
+			RB_reset(data, seed + 1);
+		}
+
+		RB_setCoordColor(data, RB_getRandomCoord(data), RB_getRandomColor(data));
+		RB_generatePixels(data, numPixels);
+
+		// RB_free hands over whatever is left as a last frame, even if it only blacks out the canvas.
+		for(int i = 0; i < RB_NUM_TEST_FORMATS; i++) {
+			ExporterModel* model = &(frameTest.models[i]);
+			if(model->liveStart < frameTest.logLength || model->liveClearsCanvas) {
+				addExpectedFrame(&frameTest, model);
+			}
+		}
+	} else {
+		frameTest.failed = true;
+	}
+
+	uint8_t* finalCanvas = readFinalCanvas(&frameTest, data);
+	// Writes the last frames, and waits for the writers to finish.
+	RB_free(data);
+	RB_freeConfig(config);
+
+	if(frameTest.failed || finalCanvas == NULL) {
+		reportFailure(test, "all", "the test could not be set up", 0);
+	} else {
+		for(int i = 0; i < RB_NUM_TEST_FORMATS; i++) {
+			size_t length;
+			uint8_t* stream = readTestStream(frameTest.models[i].output, &length);
+
+			if(stream == NULL) {
+				reportFailure(test, testFormatNames[i], "the stream could not be read back", 0);
+			} else if(testFormats[i] == RB_FRAME_FORMAT_DELTA) {
+				checkDeltaStream(&frameTest, i, stream, length, finalCanvas);
+			} else {
+				checkCanvasStream(&frameTest, i, stream, length, finalCanvas);
+			}
+
+			free(stream);
+		}
+	}
+
+	for(int i = 0; i < RB_NUM_TEST_FORMATS; i++) {
+		if(frameTest.models[i].output != NULL) {
+			fclose(frameTest.models[i].output);
+		}
+		free(frameTest.models[i].frames);
+	}
+	free(frameTest.log);
+	free(finalCanvas);
+}
+
+int main(int argc, char** argv) {
+	if(argc > 1) {
+		fprintf(stderr, "Usage: %s\n", argv[0]);
+		return 1;
+	}
+
+	for(size_t i = 0; i < RB_NUM_FRAME_TEST_CASES; i++) {
+		const FrameTestCase* test = &(frameTestCases[i]);
+		int failuresBefore = numFailures;
+
+		runFrameTest(test, (unsigned int) (i + 1));
+
+		fprintf(
+			stderr,
+			"%s %d x %d x %d, %ld x %ld, %ld pixels per frame%s\n",
+			(numFailures == failuresBefore)? "ok    " : "FAILED",
+			(int) test->rRes, (int) test->gRes, (int) test->bRes, (long) test->width, (long) test->height,
+			(long) test->pixelsPerFrame, test->resetHalfway? ", reset halfway" : ""
+		);
+	}
+
+	if(numFailures > 0) {
+		fprintf(stderr, "%d checks failed.\n", numFailures);
+		return 1;
+	}
+
+	fprintf(stderr, "Every check passed.\n");
+	return 0;
+}
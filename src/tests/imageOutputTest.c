@@ -0,0 +1,569 @@
+#include "headers/RB_Main.h"
+#include "headers/RB_ImageOutput.h"
+#include "headers/RB_PixelMap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+Writes rainbows as PPMs and PNGs, decodes both files, and checks every pixel against the pixel map. The PNG decoder
+only understands what RB_writePNG is meant to write (unfiltered 8-bit RGB rows, in a zlib stream of stored deflate
+blocks), but it checks everything a real decoder would: every chunk's CRC-32, every stored block's length and its
+complement, and the stream's Adler-32.
+
+The canvases include odd sizes, several bands of rows, several stored blocks, and several IDAT chunks, and the largest
+ones are only partly generated, so that blank pixels are checked too.
+
+Usage: imageOutputTest [output path, without an extension]
+
+Returns 0 if every check passed.
+*/
+
+typedef struct {
+	RB_ColorChannelSize rRes;
+	RB_ColorChannelSize gRes;
+	RB_ColorChannelSize bRes;
+	RB_Size width;
+	RB_Size height;
+	// How many pixels are generated before the images are written, or 0 for all of them.
+	RB_Size numPixels;
+	RB_MapLayout mapLayout;
+} ImageTestCase;
+
+const ImageTestCase imageTestCases[] = {
+	{ 8, 8, 8, 32, 16, 0, RB_MAP_LAYOUT_FLAT },
+	{ 3, 5, 7, 15, 7, 0, RB_MAP_LAYOUT_TILED },
+	{ 16, 16, 16, 64, 64, 0, RB_MAP_LAYOUT_FLAT },
+	{ 32, 32, 32, 256, 128, 0, RB_MAP_LAYOUT_TILED },
+	{ 128, 128, 64, 1024, 1024, 20000, RB_MAP_LAYOUT_FLAT },
+	{ 128, 128, 64, 1024, 1024, 20000, RB_MAP_LAYOUT_TILED }
+};
+#define RB_NUM_IMAGE_TEST_CASES (sizeof(imageTestCases) / sizeof(imageTestCases[0]))
+
+// The longest path the test builds out of the one it was given.
+#define RB_TEST_MAX_PATH 4096
+
+int numFailures = 0;
+
+void reportFailure(const ImageTestCase* test, const char* format, const char* message) {
+	numFailures++;
+	// Anything after the first few failures is almost always the same bug.
+	if(numFailures <= 20) {
+		fprintf(
+			stderr, "FAILED (%d x %d x %d, %ld x %ld, layout %d, %s): %s.\n",
+			(int) test->rRes, (int) test->gRes, (int) test->bRes, (long) test->width, (long) test->height,
+			(int) test->mapLayout, format, message
+		);
+	}
+}
+
+// Reads a whole file into memory. Returns NULL if it can't be read.
+uint8_t* readTestFile(const char* path, size_t* length) {
+	FILE* file = fopen(path, "rb");
+	if(file == NULL) {
+		return NULL;
+	}
+
+	uint8_t* ret = NULL;
+	long fileLength = (fseek(file, 0, SEEK_END) == 0)? ftell(file) : -1;
+
+	if(fileLength >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+		ret = (uint8_t*) malloc((size_t) fileLength + 1);
+		if(ret != NULL && fread(ret, 1, (size_t) fileLength, file) != (size_t) fileLength) {
+			free(ret);
+			ret = NULL;
+		}
+	}
+
+	fclose(file);
+	*length = (size_t) fileLength;
+	return ret;
+}
+
+// Returns the 8-bit RGB pixels the images should hold, row by row, or NULL if they can't be allocated.
+uint8_t* getExpectedImagePixels(RB_Data* data) {
+	RB_Size width = data->config.width;
+	RB_Size height = data->config.height;
+
+	uint8_t rLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint8_t gLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	uint8_t bLookup[RB_MAXIMUM_COLOR_CHANNEL_RESOLUTION];
+	RB_buildChannelLookup(rLookup, data->config.rRes);
+	RB_buildChannelLookup(gLookup, data->config.gRes);
+	RB_buildChannelLookup(bLookup, data->config.bRes);
+
+	uint8_t* ret = (uint8_t*) malloc((size_t) width * height * 3);
+	RB_Color* column = (RB_Color*) malloc(sizeof(RB_Color) * height);
+	RB_PixelStatus* statuses = (RB_PixelStatus*) malloc(sizeof(RB_PixelStatus) * height);
+
+	if(ret == NULL || column == NULL || statuses == NULL) {
+		free(ret);
+		free(column);
+		free(statuses);
+		return NULL;
+	}
+
+	for(RB_Size x = 0; x < width; x++) {
+		RB_readPixelMapColumn(data->pixelMap, x, 0, height, column);
+		RB_readPixelMapColumnStatuses(data->pixelMap, x, 0, height, statuses);
+
+		for(RB_Size y = 0; y < height; y++) {
+			uint8_t* pixel = ret + ((((size_t) y * width) + x) * 3);
+			bool isBlank = statuses[y] == RB_PIXEL_BLANK;
+
+			// Blank pixels are black.
+			pixel[0] = isBlank? 0 : rLookup[column[y].r];
+			pixel[1] = isBlank? 0 : gLookup[column[y].g];
+			pixel[2] = isBlank? 0 : bLookup[column[y].b];
+		}
+	}
+
+	free(column);
+	free(statuses);
+	return ret;
+}
+
+// Checks a decoded image against the expected one.
+void checkDecodedImage(
+	const ImageTestCase* test,
+	const char* format,
+	RB_Size width,
+	RB_Size height,
+	const uint8_t* pixels,
+	const uint8_t* expected
+) {
+	if(width != test->width || height != test->height) {
+		reportFailure(test, format, "the image has the wrong dimensions");
+		return;
+	}
+
+	size_t numBytes = (size_t) width * height * 3;
+	for(size_t i = 0; i < numBytes; i++) {
+		if(pixels[i] != expected[i]) {
+			reportFailure(test, format, "a pixel of the image is wrong");
+			return;
+		}
+	}
+}
+
+// PPM
+
+// Decodes a binary PPM. Returns NULL, and sets error, if the file isn't one. Otherwise, returns its pixels, which are
+// part of the file.
+const uint8_t* decodePPM(uint8_t* file, size_t length, RB_Size* width, RB_Size* height, const char** error) {
+	// The header is short, so the file only needs to be terminated for sscanf.
+	file[length] = '\0';
+
+	long fileWidth;
+	long fileHeight;
+	int maxValue;
+	int headerLength = 0;
+
+	if(
+		sscanf((const char*) file, "P6 %ld %ld %d%n", &fileWidth, &fileHeight, &maxValue, &headerLength) != 3
+		|| fileWidth < 1 || fileHeight < 1 || maxValue != 255
+		|| (size_t) headerLength >= length || file[headerLength] != '\n'
+	) {
+		*error = "the header is invalid";
+		return NULL;
+	}
+
+	// A single whitespace character separates the header from the pixels.
+	headerLength++;
+	if(length - headerLength != (size_t) fileWidth * fileHeight * 3) {
+		*error = "the file has the wrong number of pixels";
+		return NULL;
+	}
+
+	*width = (RB_Size) fileWidth;
+	*height = (RB_Size) fileHeight;
+	return file + headerLength;
+}
+
+// PNG
+
+uint32_t loadBigEndian(const uint8_t* bytes) {
+	return ((uint32_t) bytes[0] << 24) | ((uint32_t) bytes[1] << 16) | ((uint32_t) bytes[2] << 8) | bytes[3];
+}
+
+// A bit at a time, so that it doesn't share a table with the writer.
+uint32_t getTestCRC(const uint8_t* bytes, size_t length) {
+	uint32_t crc = 0xFFFFFFFF;
+
+	for(size_t i = 0; i < length; i++) {
+		crc ^= bytes[i];
+		for(int bit = 0; bit < 8; bit++) {
+			crc = (crc & 1)? (0xEDB88320 ^ (crc >> 1)) : (crc >> 1);
+		}
+	}
+
+	return crc ^ 0xFFFFFFFF;
+}
+
+// A byte at a time, so that it doesn't share the writer's deferred modulo.
+uint32_t getTestAdler(const uint8_t* bytes, size_t length) {
+	uint32_t a = 1;
+	uint32_t b = 0;
+
+	for(size_t i = 0; i < length; i++) {
+		a = (a + bytes[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+
+	return (b << 16) | a;
+}
+
+// Collects the image's zlib stream out of its IDAT chunks, checking every chunk on the way. Returns NULL, and sets
+// error, if the file isn't a PNG that RB_writePNG could have written.
+uint8_t* readPNGChunks(
+	const uint8_t* file,
+	size_t length,
+	RB_Size* width,
+	RB_Size* height,
+	size_t* zlibLength,
+	size_t* numIDATs,
+	const char** error
+) {
+	const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	if(length < 8 || memcmp(file, signature, 8) != 0) {
+		*error = "the signature is invalid";
+		return NULL;
+	}
+
+	uint8_t* zlib = NULL;
+	*zlibLength = 0;
+	*numIDATs = 0;
+	bool hasHeader = false;
+	bool hasEnd = false;
+	size_t position = 8;
+
+	while(!hasEnd) {
+		if(length - position < 12) {
+			*error = "the file ends before its IEND chunk";
+			break;
+		}
+
+		size_t chunkLength = loadBigEndian(file + position);
+		const uint8_t* type = file + position + 4;
+		const uint8_t* chunkData = type + 4;
+
+		if(length - position - 12 < chunkLength) {
+			*error = "a chunk is longer than the rest of the file";
+			break;
+		}
+		if(getTestCRC(type, chunkLength + 4) != loadBigEndian(chunkData + chunkLength)) {
+			*error = "a chunk's CRC is wrong";
+			break;
+		}
+		position += chunkLength + 12;
+
+		if(memcmp(type, "IHDR", 4) == 0) {
+			// 8 bits per channel, truecolor, deflate, no filtering beyond the basic set, and no interlacing.
+			const uint8_t expectedFields[5] = { 8, 2, 0, 0, 0 };
+			if(hasHeader || chunkLength != 13 || memcmp(chunkData + 8, expectedFields, 5) != 0) {
+				*error = "the IHDR chunk is invalid";
+				break;
+			}
+			*width = (RB_Size) loadBigEndian(chunkData);
+			*height = (RB_Size) loadBigEndian(chunkData + 4);
+			hasHeader = true;
+		} else if(!hasHeader) {
+			*error = "the first chunk isn't an IHDR chunk";
+			break;
+		} else if(memcmp(type, "IDAT", 4) == 0) {
+			uint8_t* newZlib = (uint8_t*) realloc(zlib, *zlibLength + chunkLength + 1);
+			if(newZlib == NULL) {
+				*error = "the image data could not be allocated";
+				break;
+			}
+
+			zlib = newZlib;
+			memcpy(zlib + *zlibLength, chunkData, chunkLength);
+			*zlibLength += chunkLength;
+			(*numIDATs)++;
+		} else if(memcmp(type, "IEND", 4) == 0) {
+			if(chunkLength != 0 || position != length) {
+				*error = "the IEND chunk is invalid, or isn't the last one";
+				break;
+			}
+			hasEnd = true;
+		} else {
+			*error = "the file has an unexpected chunk";
+			break;
+		}
+	}
+
+	if(!hasEnd || *numIDATs == 0) {
+		if(hasEnd) {
+			*error = "the file has no IDAT chunks";
+		}
+		free(zlib);
+		return NULL;
+	}
+
+	return zlib;
+}
+
+// Decodes a zlib stream of stored deflate blocks into data, which must hold exactly dataLength bytes. Returns false,
+// and sets error, if it can't. Sets numBlocks to how many blocks there were.
+bool inflateStoredBlocks(
+	const uint8_t* zlib,
+	size_t zlibLength,
+	uint8_t* data,
+	size_t dataLength,
+	size_t* numBlocks,
+	const char** error
+) {
+	// Deflate with any window size, no preset dictionary, and a header that is a multiple of 31.
+	if(zlibLength < 2 || (zlib[0] & 0x0F) != 8 || (zlib[1] & 0x20) != 0 || ((zlib[0] << 8) | zlib[1]) % 31 != 0) {
+		*error = "the zlib header is invalid";
+		return false;
+	}
+
+	size_t position = 2;
+	size_t dataPosition = 0;
+	bool isFinal = false;
+	*numBlocks = 0;
+
+	while(!isFinal) {
+		// Stored blocks start on a byte boundary, so the rest of the block header's byte is padding.
+		if(zlibLength - position < 5) {
+			*error = "the zlib stream ends before its final block";
+			return false;
+		}
+		if(((zlib[position] >> 1) & 3) != 0) {
+			*error = "a deflate block isn't stored";
+			return false;
+		}
+
+		isFinal = (zlib[position] & 1) != 0;
+		size_t blockLength = zlib[position + 1] | ((size_t) zlib[position + 2] << 8);
+		size_t complement = zlib[position + 3] | ((size_t) zlib[position + 4] << 8);
+		position += 5;
+
+		if((blockLength ^ 0xFFFF) != complement) {
+			*error = "a stored block's length doesn't match its complement";
+			return false;
+		}
+		if(zlibLength - position < blockLength || dataLength - dataPosition < blockLength) {
+			*error = "a stored block is longer than the rest of the stream or the image";
+			return false;
+		}
+
+		memcpy(data + dataPosition, zlib + position, blockLength);
+		position += blockLength;
+		dataPosition += blockLength;
+		(*numBlocks)++;
+	}
+
+	if(dataPosition != dataLength) {
+		*error = "the zlib stream holds the wrong amount of data";
+		return false;
+	}
+	if(zlibLength - position != 4) {
+		*error = "the zlib stream doesn't end with just its Adler-32";
+		return false;
+	}
+	if(loadBigEndian(zlib + position) != getTestAdler(data, dataLength)) {
+		*error = "the zlib stream's Adler-32 is wrong";
+		return false;
+	}
+
+	return true;
+}
+
+// Decodes a PNG that RB_writePNG could have written. Returns its pixels, or NULL (setting error) if it can't. Sets
+// numIDATs and numBlocks to how many IDAT chunks and stored blocks it had.
+uint8_t* decodePNG(
+	const uint8_t* file,
+	size_t length,
+	RB_Size* width,
+	RB_Size* height,
+	size_t* numIDATs,
+	size_t* numBlocks,
+	const char** error
+) {
+	size_t zlibLength;
+	uint8_t* zlib = readPNGChunks(file, length, width, height, &zlibLength, numIDATs, error);
+	if(zlib == NULL) {
+		return NULL;
+	}
+
+	// Every row starts with its filter type.
+	size_t rowLength = 1 + ((size_t) *width * 3);
+	size_t dataLength = rowLength * *height;
+	uint8_t* data = (uint8_t*) malloc(dataLength);
+	uint8_t* pixels = (uint8_t*) malloc((size_t) *width * *height * 3);
+
+	bool success = data != NULL && pixels != NULL;
+	if(!success) {
+		*error = "the image could not be allocated";
+	} else {
+		success = inflateStoredBlocks(zlib, zlibLength, data, dataLength, numBlocks, error);
+	}
+
+	for(RB_Size y = 0; success && y < *height; y++) {
+		const uint8_t* row = data + (rowLength * y);
+		if(row[0] != 0) {
+			*error = "a row is filtered";
+			success = false;
+			break;
+		}
+		memcpy(pixels + ((rowLength - 1) * y), row + 1, rowLength - 1);
+	}
+
+	free(zlib);
+	free(data);
+	if(!success) {
+		free(pixels);
+		return NULL;
+	}
+
+	return pixels;
+}
+
+// TESTS
+
+void checkPPM(const ImageTestCase* test, RB_Data* data, const char* path, const uint8_t* expected) {
+	RB_ImageReport report;
+	if(!RB_writePPM(data, path, &report)) {
+		reportFailure(test, "PPM", "the image could not be written");
+		return;
+	}
+
+	size_t length;
+	uint8_t* file = readTestFile(path, &length);
+	if(file == NULL) {
+		reportFailure(test, "PPM", "the image could not be read back");
+		return;
+	}
+
+	if(report.numBytes != length) {
+		reportFailure(test, "PPM", "the report has the wrong number of bytes");
+	}
+
+	RB_Size width;
+	RB_Size height;
+	const char* error = NULL;
+	const uint8_t* pixels = decodePPM(file, length, &width, &height, &error);
+
+	if(pixels == NULL) {
+		reportFailure(test, "PPM", error);
+	} else {
+		checkDecodedImage(test, "PPM", width, height, pixels, expected);
+	}
+
+	free(file);
+}
+
+void checkPNG(const ImageTestCase* test, RB_Data* data, const char* path, const uint8_t* expected) {
+	RB_ImageReport report;
+	if(!RB_writePNG(data, path, &report)) {
+		reportFailure(test, "PNG", "the image could not be written");
+		return;
+	}
+
+	size_t length;
+	uint8_t* file = readTestFile(path, &length);
+	if(file == NULL) {
+		reportFailure(test, "PNG", "the image could not be read back");
+		return;
+	}
+
+	if(report.numBytes != length) {
+		reportFailure(test, "PNG", "the report has the wrong number of bytes");
+	}
+
+	RB_Size width;
+	RB_Size height;
+	size_t numIDATs;
+	size_t numBlocks;
+	const char* error = NULL;
+	uint8_t* pixels = decodePNG(file, length, &width, &height, &numIDATs, &numBlocks, &error);
+
+	if(pixels == NULL) {
+		reportFailure(test, "PNG", error);
+	} else {
+		checkDecodedImage(test, "PNG", width, height, pixels, expected);
+
+		// Every block but the last is as long as a stored block can be.
+		size_t dataLength = (1 + ((size_t) width * 3)) * height;
+		if(numBlocks != (dataLength + 65534) / 65535) {
+			reportFailure(test, "PNG", "the image data is split into the wrong number of stored blocks");
+		}
+	}
+
+	free(pixels);
+	free(file);
+}
+
+void runImageTest(const ImageTestCase* test, const char* basePath, unsigned int seed) {
+	char ppmPath[RB_TEST_MAX_PATH];
+	char pngPath[RB_TEST_MAX_PATH];
+	snprintf(ppmPath, RB_TEST_MAX_PATH, "%s.ppm", basePath);
+	snprintf(pngPath, RB_TEST_MAX_PATH, "%s.png", basePath);
+
+	RB_Config* config = RB_newConfig();
+	RB_setColorResolution(config, test->rRes, test->gRes, test->bRes);
+	RB_setMapDimensions(config, test->width, test->height);
+	RB_setMapLayout(config, test->mapLayout);
+	RB_setRandomSeed(config, seed);
+
+	RB_Data* data = RB_init(config);
+	if(data == NULL) {
+		reportFailure(test, "both", "the rainbow could not be initialized");
+		RB_freeConfig(config);
+		return;
+	}
+
+	RB_Size numPixels = (test->numPixels > 0)? test->numPixels : test->width * test->height;
+	RB_setCoordColor(data, RB_getRandomCoord(data), RB_getRandomColor(data));
+	RB_generatePixels(data, numPixels - 1);
+
+	uint8_t* expected = getExpectedImagePixels(data);
+	if(expected == NULL) {
+		reportFailure(test, "both", "the expected image could not be allocated");
+	} else {
+		checkPPM(test, data, ppmPath, expected);
+		checkPNG(test, data, pngPath, expected);
+	}
+
+	remove(ppmPath);
+	remove(pngPath);
+	free(expected);
+	RB_free(data);
+	RB_freeConfig(config);
+}
+
+int main(int argc, char** argv) {
+	if(argc > 2) {
+		fprintf(stderr, "Usage: %s [output path, without an extension]\n", argv[0]);
+		return 1;
+	}
+
+	const char* basePath = (argc > 1)? argv[1] : "imageOutputTest";
+
+	for(size_t i = 0; i < RB_NUM_IMAGE_TEST_CASES; i++) {
+		const ImageTestCase* test = &(imageTestCases[i]);
+		int failuresBefore = numFailures;
+
+		runImageTest(test, basePath, (unsigned int) (i + 1));
+
+		fprintf(
+			stderr,
+			"%s %d x %d x %d, %ld x %ld, layout %d\n",
+			(numFailures == failuresBefore)? "ok    " : "FAILED",
+			(int) test->rRes, (int) test->gRes, (int) test->bRes, (long) test->width, (long) test->height,
+			(int) test->mapLayout
+		);
+	}
+
+	if(numFailures > 0) {
+		fprintf(stderr, "%d checks failed.\n", numFailures);
+		return 1;
+	}
+
+	fprintf(stderr, "Every check passed.\n");
+	return 0;
+}